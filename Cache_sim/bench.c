@@ -0,0 +1,408 @@
+////////////////////////////////////////////////////////////////////////////////
+// Main File:        bench.c
+// This File:        bench.c
+// Other Files:      cache.c cache.h repl.c repl.h trace.c trace.h
+// Semester:         CS 354 Fall 2018
+//
+// Author:           Yuanhang Wang
+// Email:            wang2243@wisc.edu
+// CS Login:         ywang
+//
+/////////////////////////// OTHER SOURCES OF HELP //////////////////////////////
+//                   fully acknowledge and credit all sources of help,
+//                   other than Instructors and TAs.
+//
+// Persons:          Identify persons by name, relationship to you, and email.
+//                   Describe in detail the the ideas and help they provided.
+//
+// Online sources:   avoid web searches to solve your problems, but if you do
+//                   search, be sure to include Web URLs and description of
+//                   of any information you find.
+//////////////////////////// 80 columns wide ///////////////////////////////////
+
+/*
+ * bench.c - csim-bench measures how fast the simulator runs: simulated
+ *     accesses per second for every replacement policy on synthetic
+ *     workloads, so that performance regressions show up.
+ *
+ * Each workload is generated in memory for a cache of C bytes:
+ *   seq:    8-byte loads walking through 16C bytes
+ *   stride: one load every 4 blocks through 16C bytes
+ *   random: 8-byte loads anywhere in 16C bytes
+ *   chase:  a pointer chase, one block per node, through a random cycle
+ *           over 4C bytes
+ *   mix:    three in four loads sweep a loop of 1.5C bytes, which LRU
+ *           always misses on, the rest are random within 16C
+ * or read from a trace with -t. Only the cache is timed, except for the
+ * "parse" row, which replays the workload from a binary trace file and
+ * so also times the trace reader. OPT's time includes its pass over the
+ * accesses to find next uses.
+ *
+ *     linux>  make bench BENCH_N=1000000
+ *     linux>  ./csim-bench -w seq,chase -p lru,srrip -o /tmp
+ *     linux>  ./csim-bench -s 10 -E 16 -b 6 -t traces/long.trace
+ */
+
+#include <getopt.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include "cache.h"
+#include "repl.h"
+#include "trace.h"
+
+#define LIST_LRU REPL_COUNT   /* policy index of LRU with -L */
+#define PARSE    (REPL_COUNT + 1)  /* LRU on the trace file */
+
+static unsigned long long rng = 0x9E3779B97F4A7C15ULL;
+
+static unsigned long long next_random() {
+  rng ^= rng << 13;
+  rng ^= rng >> 7;
+  rng ^= rng << 17;
+  return rng;
+}
+
+static void gen_seq(mem_addr_t *addrs, size_t n, size_t size, int b) {
+  for (size_t i = 0; i < n; i++)
+    addrs[i] = i * 8 % (16 * size);
+}
+
+static void gen_stride(mem_addr_t *addrs, size_t n, size_t size, int b) {
+  for (size_t i = 0; i < n; i++)
+    addrs[i] = (i << (b + 2)) % (16 * size);
+}
+
+static void gen_random(mem_addr_t *addrs, size_t n, size_t size, int b) {
+  for (size_t i = 0; i < n; i++)
+    addrs[i] = next_random() % (2 * size) * 8;
+}
+
+static void gen_chase(mem_addr_t *addrs, size_t n, size_t size, int b) {
+  size_t nodes = 4 * size >> b;
+  size_t *next = malloc(nodes * sizeof(size_t));
+  if (next == NULL) {
+    fprintf(stderr, "Not enough memory for %zu nodes\n", nodes);
+    exit(1);
+  }
+  // Sattolo's shuffle makes the nodes one cycle
+  for (size_t i = 0; i < nodes; i++)
+    next[i] = i;
+  for (size_t i = nodes - 1; i > 0; i--) {
+    size_t j = next_random() % i;
+    size_t tmp = next[i];
+    next[i] = next[j];
+    next[j] = tmp;
+  }
+  size_t node = 0;
+  for (size_t i = 0; i < n; i++) {
+    addrs[i] = (mem_addr_t) node << b;
+    node = next[node];
+  }
+  free(next);
+}
+
+static void gen_mix(mem_addr_t *addrs, size_t n, size_t size, int b) {
+  size_t loop = size + size / 2, pos = 0;
+  for (size_t i = 0; i < n; i++) {
+    unsigned long long r = next_random();
+    if (r % 4 != 0) {
+      addrs[i] = pos;
+      pos = (pos + ((size_t) 1 << b)) % loop;
+    } else {
+      // Above the loop, so the two parts never share blocks
+      addrs[i] = loop + (r >> 8) % (16 * size);
+    }
+  }
+}
+
+static const struct workload {
+  const char *name;
+  void (*gen)(mem_addr_t *addrs, size_t n, size_t size, int b);
+} workloads[] = {
+  {"seq", gen_seq},
+  {"stride", gen_stride},
+  {"random", gen_random},
+  {"chase", gen_chase},
+  {"mix", gen_mix},
+};
+#define NWORKLOADS (sizeof(workloads) / sizeof(workloads[0]))
+
+/*
+ * print_usage - Print usage info
+ */
+void print_usage(char *argv[]) {
+  printf("Usage: %s [-h] [-s <num>] [-E <num>] [-b <num>] [-n <num>]\n"
+         "       [-w <list>] [-p <list>] [-o <dir>] [-t <file>]\n", argv[0]);
+  printf("Options:\n");
+  printf("  -h         Print this help message.\n");
+  printf("  -s <num>   Number of set index bits (default 6).\n");
+  printf("  -E <num>   Number of lines per set (default 8).\n");
+  printf("  -b <num>   Number of block offset bits (default 6).\n");
+  printf("  -n <num>   Accesses per workload (default 4M).\n");
+  printf("  -w <list>  Workloads: seq,stride,random,chase,mix (default "
+         "all).\n");
+  printf("  -p <list>  Policies, as csim -p, plus lru-L and parse (default "
+         "all).\n");
+  printf("  -o <dir>   Also save the workloads as binary traces in <dir>.\n");
+  printf("  -t <file>  Replay this trace instead, text or binary.\n");
+}
+
+/*
+ * load_trace - read the data accesses of the trace at 'path' into
+ *   *addrs, a modify counting twice
+ *   Returns the number of accesses, exits on failure
+ */
+static size_t load_trace(const char *path, mem_addr_t **addrs) {
+  trace_t trace;
+  int op, status = 0;
+  mem_addr_t addr;
+  unsigned int len;
+  size_t n = 0, size = 1 << 16;
+
+  if (trace_open(&trace, path) != 0) {
+    fprintf(stderr, "%s: %s\n", path, strerror(errno));
+    exit(1);
+  }
+  *addrs = malloc(size * sizeof(mem_addr_t));
+  while (*addrs != NULL
+         && (status = trace_next(&trace, &op, &addr, &len)) > 0) {
+    if (op >= TRACE_I)
+      continue;
+    if (n + 2 > size)
+      *addrs = realloc(*addrs, (size *= 2) * sizeof(mem_addr_t));
+    if (*addrs == NULL)
+      break;
+    (*addrs)[n++] = addr;
+    if (op == TRACE_M)
+      (*addrs)[n++] = addr;
+  }
+  if (*addrs == NULL) {
+    fprintf(stderr, "Not enough memory for %s\n", path);
+    exit(1);
+  }
+  if (status < 0) {
+    fprintf(stderr, "%s: truncated or unreadable trace\n", path);
+    exit(1);
+  }
+  trace_close(&trace);
+  return n;
+}
+
+/*
+ * save_trace - write the 'n' accesses in 'addrs' as loads to a binary
+ *   trace at 'path'
+ *   Returns 0 on success, -1 on failure
+ */
+static int save_trace(const char *path, const mem_addr_t *addrs, size_t n) {
+  FILE *fp = fopen(path, "w");
+  trace_writer_t writer;
+  int status = fp && trace_writer_open(&writer, fp) == 0 ? 0 : -1;
+  for (size_t i = 0; i < n && status == 0; i++)
+    status = trace_write(&writer, TRACE_L, addrs[i], 8);
+  if (fp && fclose(fp) != 0)
+    status = -1;
+  return status;
+}
+
+static double now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * run - time 'policy' (a REPL_* policy, LIST_LRU or PARSE) on the 'n'
+ *   accesses in 'addrs', or on the trace at 'path' for PARSE, and print a
+ *   row
+ */
+static void run(const char *workload, int policy, int s, int E, int b,
+                const mem_addr_t *addrs, size_t n, const char *path) {
+  cache_t cache;
+  unsigned long long counts[3] = {0};
+  unsigned long long *next_use = NULL;
+  int repl = policy == LIST_LRU || policy == PARSE ? REPL_LRU : policy;
+
+  if (cache_init(&cache, s, E, b, policy == LIST_LRU) != 0
+      || cache_set_repl(&cache, repl) != 0) {
+    fprintf(stderr, "Unable to allocate a cache with s=%d E=%d b=%d\n",
+            s, E, b);
+    exit(1);
+  }
+  double start = now();
+  if (policy == PARSE) {
+    trace_t trace;
+    int op, status;
+    mem_addr_t addr;
+    unsigned int len;
+    if (trace_open(&trace, path) != 0) {
+      fprintf(stderr, "%s: %s\n", path, strerror(errno));
+      exit(1);
+    }
+    while ((status = trace_next(&trace, &op, &addr, &len)) > 0)
+      counts[cache_access(&cache, addr)]++;
+    trace_close(&trace);
+  } else {
+    if (repl == REPL_OPT) {
+      next_use = malloc(n * sizeof(unsigned long long));
+      if (next_use == NULL || repl_next_use(addrs, n, b, next_use) != 0) {
+        fprintf(stderr, "Not enough memory to look ahead\n");
+        exit(1);
+      }
+      cache.next_use = next_use;
+    }
+    for (size_t i = 0; i < n; i++)
+      counts[cache_access(&cache, addrs[i])]++;
+  }
+  double elapsed = now() - start;
+
+  printf("%-8s %-8s %10.1fM %9.3f %12llu\n", workload,
+         policy == LIST_LRU ? "lru-L" : policy == PARSE ? "parse"
+                                                        : repl_ops[repl].name,
+         n / elapsed / 1e6,
+         100.0 * (counts[CACHE_MISS] + counts[CACHE_EVICT]) / n,
+         counts[CACHE_EVICT]);
+  free(next_use);
+  cache_free(&cache);
+}
+
+/*
+ * parse_list - set picked[i] for each name in the comma-separated 'list'
+ *   that 'lookup' maps to i
+ *   Returns 0 on success, -1 if a name is unknown
+ */
+static int parse_list(const char *list, int (*lookup)(const char *),
+                      int *picked) {
+  char *copy = strdup(list);
+  int status = copy ? 0 : -1;
+  for (char *name = strtok(copy, ","); name && status == 0;
+       name = strtok(NULL, ",")) {
+    int i = lookup(name);
+    if (i < 0)
+      status = -1;
+    else
+      picked[i] = 1;
+  }
+  free(copy);
+  return status;
+}
+
+static int lookup_workload(const char *name) {
+  for (size_t i = 0; i < NWORKLOADS; i++)
+    if (strcmp(name, workloads[i].name) == 0)
+      return i;
+  return -1;
+}
+
+static int lookup_policy(const char *name) {
+  if (strcmp(name, "lru-L") == 0)
+    return LIST_LRU;
+  if (strcmp(name, "parse") == 0)
+    return PARSE;
+  return repl_parse(name);
+}
+
+int main(int argc, char *argv[]) {
+  int s = 6, E = 8, b = 6;
+  size_t n = 1 << 22;
+  char *trace_fn = NULL, *out_dir = NULL;
+  int picked_workloads[NWORKLOADS] = {0}, picked_policies[PARSE + 1] = {0};
+  int any_workload = 0, any_policy = 0;
+  int c;
+
+  while ((c = getopt(argc, argv, "s:E:b:n:w:p:o:t:h")) != -1) {
+    switch (c) {
+      case 's':s = atoi(optarg);
+        break;
+      case 'E':E = atoi(optarg);
+        break;
+      case 'b':b = atoi(optarg);
+        break;
+      case 'n':n = strtoull(optarg, NULL, 10);
+        break;
+      case 'w':if (parse_list(optarg, lookup_workload,
+                              picked_workloads) != 0) {
+          print_usage(argv);
+          exit(1);
+        }
+        any_workload = 1;
+        break;
+      case 'p':if (parse_list(optarg, lookup_policy, picked_policies) != 0) {
+          print_usage(argv);
+          exit(1);
+        }
+        any_policy = 1;
+        break;
+      case 'o':out_dir = optarg;
+        break;
+      case 't':trace_fn = optarg;
+        break;
+      case 'h':print_usage(argv);
+        exit(0);
+      default:print_usage(argv);
+        exit(1);
+    }
+  }
+  if (s < 0 || s > 30 || E < 1 || b < 1 || s + b > 40 || n == 0) {
+    print_usage(argv);
+    exit(1);
+  }
+  for (size_t i = 0; i < NWORKLOADS; i++)
+    picked_workloads[i] |= !any_workload;
+  for (int i = 0; i <= PARSE; i++)
+    picked_policies[i] |= !any_policy;
+
+  mem_addr_t *addrs = NULL;
+  if (trace_fn) {
+    n = load_trace(trace_fn, &addrs);
+    if (n == 0) {
+      fprintf(stderr, "%s: no data accesses\n", trace_fn);
+      exit(1);
+    }
+  } else if ((addrs = malloc(n * sizeof(mem_addr_t))) == NULL) {
+    fprintf(stderr, "Not enough memory for %zu accesses\n", n);
+    exit(1);
+  }
+
+  printf("s=%d E=%d b=%d, %zu accesses per workload\n", s, E, b, n);
+  printf("%-8s %-8s %11s %9s %12s\n", "workload", "policy", "accesses/s",
+         "miss%", "evictions");
+  for (size_t w = 0; w < NWORKLOADS; w++) {
+    const char *name = trace_fn ? "trace" : workloads[w].name;
+    if (!trace_fn && !picked_workloads[w])
+      continue;
+    if (!trace_fn)
+      workloads[w].gen(addrs, n, (size_t) E << (s + b), b);
+
+    // The parse row replays a binary trace, in -o's directory if given
+    char path[4096] = "";
+    if (out_dir || picked_policies[PARSE]) {
+      int fd = -1;
+      if (out_dir) {
+        snprintf(path, sizeof(path), "%s/%s.bin", out_dir, name);
+      } else {
+        snprintf(path, sizeof(path), "/tmp/csim-bench-XXXXXX");
+        fd = mkstemp(path);
+      }
+      if ((!out_dir && fd < 0) || save_trace(path, addrs, n) != 0) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        exit(1);
+      }
+      if (fd >= 0)
+        close(fd);
+    }
+
+    for (int p = 0; p <= PARSE; p++)
+      if (picked_policies[p])
+        run(name, p, s, E, b, addrs, n, path);
+    if (path[0] && !out_dir)
+      unlink(path);
+    if (trace_fn)
+      break;
+  }
+  free(addrs);
+  return 0;
+}
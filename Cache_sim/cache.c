@@ -0,0 +1,500 @@
+////////////////////////////////////////////////////////////////////////////////
+// Main File:        csim.c
+// This File:        cache.c
+// Other Files:      csim.c cache.h repl.c repl.h
+// Semester:         CS 354 Fall 2018
+//
+// Author:           Yuanhang Wang
+// Email:            wang2243@wisc.edu
+// CS Login:         ywang
+//
+/////////////////////////// OTHER SOURCES OF HELP //////////////////////////////
+//                   fully acknowledge and credit all sources of help,
+//                   other than Instructors and TAs.
+//
+// Persons:          Identify persons by name, relationship to you, and email.
+//                   Describe in detail the the ideas and help they provided.
+//
+// Online sources:   avoid web searches to solve your problems, but if you do
+//                   search, be sure to include Web URLs and description of
+//                   of any information you find.
+//////////////////////////// 80 columns wide ///////////////////////////////////
+
+/*
+ * cache.c - The simulated cache: a set-associative LRU cache kept in flat,
+ *     cache-line-aligned arrays (see cache.h). Other replacement policies
+ *     plug in through repl.c.
+ *
+ * cache_access is all a single cache needs. A level of a hierarchy is
+ * driven through cache_lookup, cache_insert, cache_mark_dirty and
+ * cache_invalidate instead, which also track dirty lines and report
+ * victims.
+ *
+ * The tags of a set are compared four at a time with SSE2, or with AVX2
+ * when the compiler targets it (e.g. make CFLAGS+=-mavx2).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <emmintrin.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#include "cache.h"
+#include "repl.h"
+
+#define LANES 4           /* tags compared per step, ways is a multiple */
+#define NIL   UINT_MAX    /* end of a recency list */
+
+/*
+ * alloc_lines - allocate 'bytes' bytes aligned to a 64-byte cache line
+ */
+static void *alloc_lines(size_t bytes) {
+  void *ptr;
+  if (posix_memalign(&ptr, 64, bytes) != 0)
+    return NULL;
+  return ptr;
+}
+
+/*
+ * find_way - return the way of 'set_tags' holding 'tag', or -1 if none
+ *   'set_tags' is 32-byte aligned and 'ways' a multiple of LANES
+ */
+static inline int find_way(const mem_addr_t *set_tags, int ways,
+                           mem_addr_t tag) {
+#ifdef __AVX2__
+  __m256i key = _mm256_set1_epi64x(tag);
+  for (int i = 0; i < ways; i += LANES) {
+    __m256i v = _mm256_load_si256((const __m256i *) (set_tags + i));
+    int mask = _mm256_movemask_pd(
+        _mm256_castsi256_pd(_mm256_cmpeq_epi64(v, key)));
+    if (mask)
+      return i + __builtin_ctz(mask);
+  }
+#else
+  // SSE2 has no 64-bit compare: a 64-bit lane is equal when both of its
+  // 32-bit halves are
+  __m128i key = _mm_set1_epi64x(tag);
+  for (int i = 0; i < ways; i += LANES) {
+    __m128i lo = _mm_cmpeq_epi32(
+        _mm_load_si128((const __m128i *) (set_tags + i)), key);
+    __m128i hi = _mm_cmpeq_epi32(
+        _mm_load_si128((const __m128i *) (set_tags + i + 2)), key);
+    lo = _mm_and_si128(lo, _mm_shuffle_epi32(lo, _MM_SHUFFLE(2, 3, 0, 1)));
+    hi = _mm_and_si128(hi, _mm_shuffle_epi32(hi, _MM_SHUFFLE(2, 3, 0, 1)));
+    int mask = _mm_movemask_pd(_mm_castsi128_pd(lo))
+               | _mm_movemask_pd(_mm_castsi128_pd(hi)) << 2;
+    if (mask)
+      return i + __builtin_ctz(mask);
+  }
+#endif
+  return -1;
+}
+
+/*
+ * hash_line - hash table slot where the search for ('set', 'tag') starts
+ */
+static inline unsigned long long hash_line(const cache_t *cache,
+                                           mem_addr_t set, mem_addr_t tag) {
+  // Mix twice: the low slot bits must depend on both the set and the tag
+  unsigned long long h = (tag * 0x9E3779B97F4A7C15ULL ^ set)
+                         * 0xBF58476D1CE4E5B9ULL;
+  return (h ^ h >> 31) & cache->table_mask;
+}
+
+/*
+ * find_slot - return the hash table slot of the line of set 'set' (whose
+ *   first line is 'base') that holds 'tag', or -1 if the set does not
+ */
+static inline long long find_slot(const cache_t *cache, mem_addr_t set,
+                                  size_t base, mem_addr_t tag) {
+  unsigned long long slot = hash_line(cache, set, tag);
+  unsigned int entry;
+  while ((entry = cache->table[slot]) != 0) {
+    unsigned int line = entry - 1;
+    if (cache->tags[line] == tag && line - base < (size_t) cache->ways)
+      return slot;
+    slot = (slot + 1) & cache->table_mask;
+  }
+  return -1;
+}
+
+/*
+ * table_remove - empty hash table slot 'slot'
+ *   Later entries of the probe sequence move back into the hole so that
+ *   no search stops early
+ */
+static void table_remove(cache_t *cache, unsigned long long slot) {
+  unsigned long long mask = cache->table_mask;
+  unsigned long long hole = slot;
+  for (;;) {
+    slot = (slot + 1) & mask;
+    unsigned int entry = cache->table[slot];
+    if (entry == 0)
+      break;
+    unsigned int line = entry - 1;
+    unsigned long long home = hash_line(cache, line / cache->ways,
+                                        cache->tags[line]);
+    // The entry may fill the hole if the hole is not before its home
+    if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+      cache->table[hole] = entry;
+      hole = slot;
+    }
+  }
+  cache->table[hole] = 0;
+}
+
+static inline void list_unlink(cache_t *cache, mem_addr_t set,
+                               unsigned int line) {
+  unsigned int prev = cache->prev[line];
+  unsigned int next = cache->next[line];
+  if (prev != NIL)
+    cache->next[prev] = next;
+  else
+    cache->mru[set] = next;
+  if (next != NIL)
+    cache->prev[next] = prev;
+  else
+    cache->lru[set] = prev;
+}
+
+static inline void list_push(cache_t *cache, mem_addr_t set,
+                             unsigned int line) {
+  unsigned int head = cache->mru[set];
+  cache->prev[line] = NIL;
+  cache->next[line] = head;
+  if (head != NIL)
+    cache->prev[head] = line;
+  else
+    cache->lru[set] = line;
+  cache->mru[set] = line;
+}
+
+static inline void list_append(cache_t *cache, mem_addr_t set,
+                               unsigned int line) {
+  unsigned int tail = cache->lru[set];
+  cache->prev[line] = tail;
+  cache->next[line] = NIL;
+  if (tail != NIL)
+    cache->next[tail] = line;
+  else
+    cache->mru[set] = line;
+  cache->lru[set] = line;
+}
+
+/*
+ * find_line - return the line of set 'set' that holds 'tag', or -1
+ */
+static inline long long find_line(const cache_t *cache, mem_addr_t set,
+                                  mem_addr_t tag) {
+  size_t base = set * cache->ways;
+  if (cache->list_lru) {
+    long long slot = find_slot(cache, set, base, tag);
+    return slot < 0 ? -1 : (long long) cache->table[slot] - 1;
+  }
+  int way = find_way(cache->tags + base, cache->ways, tag);
+  return way < 0 ? -1 : (long long) (base + way);
+}
+
+/*
+ * touch - make 'line' the most recently used line of set 'set'
+ */
+static inline void touch(cache_t *cache, mem_addr_t set, size_t line) {
+  if (!cache->list_lru) {
+    if (cache->repl == REPL_LRU)
+      cache->stamps[line] = ++cache->clock;
+    else
+      repl_ops[cache->repl].hit(cache, set, line - set * cache->ways);
+  } else if (cache->mru[set] != line) {
+    list_unlink(cache, set, line);
+    list_push(cache, set, line);
+  }
+}
+
+/*
+ * replace - put 'tag' into the least recently used line of set 'set', or
+ *   an empty one, and make it the most recently used, or into the line
+ *   the replacement policy picks
+ *   Sets *line to the line and, on an eviction, *old_tag to the tag that
+ *   was there
+ *   Returns CACHE_MISS or CACHE_EVICT
+ */
+static inline int replace(cache_t *cache, mem_addr_t set, mem_addr_t tag,
+                          size_t *line, mem_addr_t *old_tag) {
+  size_t base = set * cache->ways;
+  int result;
+  if (cache->list_lru) {
+    unsigned int victim;
+    if (cache->fill[set] < (unsigned int) cache->E) {
+      victim = base + cache->fill[set]++;
+      result = CACHE_MISS;
+    } else {
+      // Invalidated lines wait at the LRU end
+      victim = cache->lru[set];
+      list_unlink(cache, set, victim);
+      *old_tag = cache->tags[victim];
+      result = CACHE_MISS;
+      if (*old_tag != TAG_INVALID) {
+        table_remove(cache, find_slot(cache, set, base, *old_tag));
+        result = CACHE_EVICT;
+      }
+    }
+    cache->tags[victim] = tag;
+    unsigned long long slot = hash_line(cache, set, tag);
+    while (cache->table[slot] != 0)
+      slot = (slot + 1) & cache->table_mask;
+    cache->table[slot] = victim + 1;
+    list_push(cache, set, victim);
+    *line = victim;
+    return result;
+  }
+
+  if (cache->repl != REPL_LRU) {
+    const repl_ops_t *ops = &repl_ops[cache->repl];
+    // Padding lanes are invalid too, but come after every real way
+    int victim = find_way(cache->tags + base, cache->ways, TAG_INVALID);
+    result = CACHE_MISS;
+    if (victim < 0 || victim >= cache->E) {
+      victim = ops->victim(cache, set);
+      result = CACHE_EVICT;
+    }
+    *old_tag = cache->tags[base + victim];
+    cache->tags[base + victim] = tag;
+    ops->fill(cache, set, victim);
+    *line = base + victim;
+    return result;
+  }
+
+  // The victim is the least recently used line, or an empty one
+  unsigned long long *stamps = cache->stamps + base;
+  int victim = 0;
+  for (int i = 1; i < cache->E; i++)
+    if (stamps[i] < stamps[victim])
+      victim = i;
+  result = stamps[victim] != 0 ? CACHE_EVICT : CACHE_MISS;
+  *old_tag = cache->tags[base + victim];
+  cache->tags[base + victim] = tag;
+  stamps[victim] = ++cache->clock;
+  *line = base + victim;
+  return result;
+}
+
+/*
+ * cache_access - access the block holding 'addr'
+ *   Returns CACHE_HIT, or CACHE_MISS or CACHE_EVICT after bringing the
+ *   block in, evicting the least recently used line of its set (or the
+ *   policy's victim) if need be
+ */
+int cache_access(cache_t *cache, mem_addr_t addr) {
+  mem_addr_t set = (addr >> cache->b) & (cache->S - 1);
+  mem_addr_t tag = addr >> (cache->b + cache->s);
+  long long line = find_line(cache, set, tag);
+  if (line >= 0) {
+    touch(cache, set, line);
+    return CACHE_HIT;
+  }
+  size_t new_line;
+  mem_addr_t old_tag;
+  return replace(cache, set, tag, &new_line, &old_tag);
+}
+
+/*
+ * cache_lookup - look for the block holding 'addr' and, if it is there,
+ *   make it the most recently used and mark it dirty if 'write' is set
+ *   Returns 1 on a hit, 0 on a miss, which changes nothing
+ */
+int cache_lookup(cache_t *cache, mem_addr_t addr, int write) {
+  mem_addr_t set = (addr >> cache->b) & (cache->S - 1);
+  long long line = find_line(cache, set, addr >> (cache->b + cache->s));
+  if (line < 0)
+    return 0;
+  touch(cache, set, line);
+  if (write)
+    cache->dirty[line] = 1;
+  return 1;
+}
+
+/*
+ * cache_use - look for the block holding 'addr' and, if it is there,
+ *   make it the most recently used
+ *   Returns its line, counted from the first line of the cache, or -1 on
+ *   a miss, which changes nothing
+ */
+long long cache_use(cache_t *cache, mem_addr_t addr) {
+  mem_addr_t set = (addr >> cache->b) & (cache->S - 1);
+  long long line = find_line(cache, set, addr >> (cache->b + cache->s));
+  if (line >= 0)
+    touch(cache, set, line);
+  return line;
+}
+
+/*
+ * cache_probe - return the line that holds the block of 'addr', counted
+ *   from the first line of the cache, or -1 if it is not there
+ *   Changes nothing, not even recency
+ */
+long long cache_probe(const cache_t *cache, mem_addr_t addr) {
+  mem_addr_t set = (addr >> cache->b) & (cache->S - 1);
+  return find_line(cache, set, addr >> (cache->b + cache->s));
+}
+
+/*
+ * cache_mark_dirty - mark the block holding 'addr' dirty if it is there,
+ *   without changing its recency
+ *   Returns 1 if it was there, 0 otherwise
+ */
+int cache_mark_dirty(cache_t *cache, mem_addr_t addr) {
+  mem_addr_t set = (addr >> cache->b) & (cache->S - 1);
+  long long line = find_line(cache, set, addr >> (cache->b + cache->s));
+  if (line < 0)
+    return 0;
+  cache->dirty[line] = 1;
+  return 1;
+}
+
+/*
+ * cache_insert - bring in the block holding 'addr', which must not be in
+ *   the cache, dirty if 'dirty' is set
+ *   On an eviction *victim is set to the address of the evicted block and
+ *   *victim_dirty to whether it was dirty
+ *   Returns CACHE_MISS or CACHE_EVICT
+ */
+int cache_insert(cache_t *cache, mem_addr_t addr, int dirty,
+                 mem_addr_t *victim, int *victim_dirty) {
+  mem_addr_t set = (addr >> cache->b) & (cache->S - 1);
+  size_t line;
+  mem_addr_t old_tag;
+  int result = replace(cache, set, addr >> (cache->b + cache->s), &line,
+                       &old_tag);
+  if (result == CACHE_EVICT) {
+    *victim = (old_tag << cache->s | set) << cache->b;
+    *victim_dirty = cache->dirty[line];
+  }
+  cache->dirty[line] = dirty;
+  return result;
+}
+
+/*
+ * cache_invalidate - drop the block holding 'addr' if it is there
+ *   Returns -1 if it was not, else 1 if it was dirty and 0 if clean
+ */
+int cache_invalidate(cache_t *cache, mem_addr_t addr) {
+  mem_addr_t set = (addr >> cache->b) & (cache->S - 1);
+  mem_addr_t tag = addr >> (cache->b + cache->s);
+  long long line = find_line(cache, set, tag);
+  if (line < 0)
+    return -1;
+  int dirty = cache->dirty[line];
+  cache->dirty[line] = 0;
+  if (cache->list_lru) {
+    table_remove(cache, find_slot(cache, set, set * cache->ways, tag));
+    list_unlink(cache, set, line);
+    list_append(cache, set, line);
+  } else if (cache->repl == REPL_LRU) {
+    cache->stamps[line] = 0;
+  }
+  cache->tags[line] = TAG_INVALID;
+  return dirty;
+}
+
+/*
+ * cache_init - set up an empty cache with 2^s sets of E lines of 2^b bytes
+ *   Returns 0 on success, -1 if the geometry is invalid or memory runs out
+ */
+int cache_init(cache_t *cache, int s, int E, int b, int list_lru) {
+  memset(cache, 0, sizeof(cache_t));
+  if (s < 0 || b < 1 || E < 1 || s > 30 || s + b > 63)
+    return -1;
+  cache->s = s;
+  cache->E = E;
+  cache->b = b;
+  cache->S = 1 << s;
+  cache->ways = (E + LANES - 1) / LANES * LANES;
+  cache->list_lru = list_lru;
+
+  size_t lines = (size_t) cache->S * cache->ways;
+  if (list_lru && lines >= NIL / 2)
+    return -1;
+  cache->tags = alloc_lines(lines * sizeof(mem_addr_t));
+  cache->dirty = alloc_lines(lines);
+  if (cache->tags == NULL || cache->dirty == NULL)
+    goto fail;
+  for (size_t i = 0; i < lines; i++)
+    cache->tags[i] = TAG_INVALID;
+  memset(cache->dirty, 0, lines);
+
+  if (!list_lru) {
+    cache->stamps = alloc_lines(lines * sizeof(unsigned long long));
+    if (cache->stamps == NULL)
+      goto fail;
+    memset(cache->stamps, 0, lines * sizeof(unsigned long long));
+    return 0;
+  }
+
+  // A table with at least twice as many slots as lines keeps probes short
+  size_t slots = 1;
+  while (slots < 2 * (size_t) cache->S * E)
+    slots <<= 1;
+  cache->table_mask = slots - 1;
+  cache->prev = alloc_lines(lines * sizeof(unsigned int));
+  cache->next = alloc_lines(lines * sizeof(unsigned int));
+  cache->mru = alloc_lines(cache->S * sizeof(unsigned int));
+  cache->lru = alloc_lines(cache->S * sizeof(unsigned int));
+  cache->fill = alloc_lines(cache->S * sizeof(unsigned int));
+  cache->table = alloc_lines(slots * sizeof(unsigned int));
+  if (!cache->prev || !cache->next || !cache->mru || !cache->lru
+      || !cache->fill || !cache->table)
+    goto fail;
+  memset(cache->mru, 0xff, cache->S * sizeof(unsigned int));
+  memset(cache->lru, 0xff, cache->S * sizeof(unsigned int));
+  memset(cache->fill, 0, cache->S * sizeof(unsigned int));
+  memset(cache->table, 0, slots * sizeof(unsigned int));
+  return 0;
+
+fail:
+  cache_free(cache);
+  return -1;
+}
+
+/*
+ * cache_set_repl - make 'repl' the replacement policy of 'cache', which
+ *   must still be empty
+ *   Returns 0 on success, -1 if the cache uses list LRU, which is LRU only,
+ *   or memory runs out
+ */
+int cache_set_repl(cache_t *cache, int repl) {
+  if (repl == REPL_LRU)
+    return 0;
+  if (cache->list_lru || repl < 0 || repl >= REPL_COUNT)
+    return -1;
+  size_t stride = repl_ops[repl].meta_bytes(cache->E);
+  if (stride > 0) {
+    cache->meta = alloc_lines(cache->S * stride);
+    if (cache->meta == NULL)
+      return -1;
+    memset(cache->meta, 0, cache->S * stride);
+  }
+  cache->meta_stride = stride;
+  cache->repl = repl;
+  free(cache->stamps);
+  cache->stamps = NULL;
+  return 0;
+}
+
+/*
+ * cache_free - free the memory cache_init allocated
+ */
+void cache_free(cache_t *cache) {
+  free(cache->tags);
+  free(cache->dirty);
+  free(cache->stamps);
+  free(cache->prev);
+  free(cache->next);
+  free(cache->mru);
+  free(cache->lru);
+  free(cache->fill);
+  free(cache->table);
+  free(cache->meta);
+  memset(cache, 0, sizeof(cache_t));
+}
@@ -0,0 +1,108 @@
+////////////////////////////////////////////////////////////////////////////////
+// Main File:        csim.c
+// This File:        cache.h
+// Other Files:      csim.c cache.c repl.c repl.h
+// Semester:         CS 354 Fall 2018
+//
+// Author:           Yuanhang Wang
+// Email:            wang2243@wisc.edu
+// CS Login:         ywang
+//
+/////////////////////////// OTHER SOURCES OF HELP //////////////////////////////
+//                   fully acknowledge and credit all sources of help,
+//                   other than Instructors and TAs.
+//
+// Persons:          Identify persons by name, relationship to you, and email.
+//                   Describe in detail the the ideas and help they provided.
+//
+// Online sources:   avoid web searches to solve your problems, but if you do
+//                   search, be sure to include Web URLs and description of
+//                   of any information you find.
+//////////////////////////// 80 columns wide ///////////////////////////////////
+
+#ifndef __cache_h__
+#define __cache_h__
+
+#include <stddef.h>
+
+/* Type: Memory address
+ * Use this type whenever dealing with addresses or address masks
+ */
+typedef unsigned long long int mem_addr_t;
+
+/* Tag of a line that holds no block. A real tag is addr >> (b + s) with
+ * b >= 1, so it never has the top bit set.
+ */
+#define TAG_INVALID (~0ULL)
+
+/* Results of cache_access */
+#define CACHE_HIT   0
+#define CACHE_MISS  1  /* Miss that filled an empty line */
+#define CACHE_EVICT 2  /* Miss that evicted a valid line */
+
+/* Type: Cache
+ * The lines of all sets live in flat arrays indexed by
+ * set * ways + way, a structure of arrays rather than an array of line
+ * structs, so the tag compare of a set reads contiguous memory. 'ways' is E
+ * rounded up to the SIMD width; the padding lanes hold TAG_INVALID and are
+ * never used. The arrays are aligned to 64-byte cache lines.
+ *
+ * Recency is a 64-bit stamp from a clock that ticks once per access, so it
+ * cannot wrap. A line is most recently used when its stamp is the largest
+ * of its set, and a miss evicts the line with the smallest stamp. An empty
+ * line has stamp 0 and is therefore always taken before a valid one.
+ *
+ * With list_lru set the stamps are replaced by a doubly linked recency list
+ * per set plus a hash table from (set, tag) to line, so hits and misses
+ * take O(1) time however large E is. Lines fill in order, and a line that
+ * is invalidated moves to the LRU end of the list.
+ *
+ * Any other replacement policy (see repl.h) drops the stamps for a few
+ * bytes of state per set in 'meta'. Such a cache fills empty lines first,
+ * lowest way first, and asks the policy for a victim only when the set
+ * is full.
+ */
+typedef struct cache {
+  int s;                      /* set index bits */
+  int E;                      /* associativity */
+  int b;                      /* block offset bits */
+  int S;                      /* number of sets */
+  int ways;                   /* E rounded up to the SIMD width */
+  int list_lru;               /* nonzero => O(1) list LRU */
+  int repl;                   /* replacement policy, one of REPL_* */
+  mem_addr_t *tags;           /* S * ways tags */
+  unsigned char *dirty;       /* S * ways dirty flags */
+  unsigned long long *stamps; /* S * ways recency stamps */
+  unsigned long long clock;   /* stamp of the latest access */
+
+  /* list_lru only */
+  unsigned int *prev;         /* S * ways, toward the MRU end */
+  unsigned int *next;         /* S * ways, toward the LRU end */
+  unsigned int *mru;          /* S heads */
+  unsigned int *lru;          /* S tails */
+  unsigned int *fill;         /* S counts of lines in use */
+  unsigned int *table;        /* hash slots holding line + 1, 0 => empty */
+  unsigned long long table_mask;
+
+  /* policies other than LRU only */
+  unsigned char *meta;        /* S * meta_stride bytes of policy state */
+  size_t meta_stride;
+  unsigned long long rng;     /* random number state */
+  int psel;                   /* DRRIP selector, > 0 => BRRIP */
+  const unsigned long long *next_use; /* OPT: next use of each access */
+  unsigned long long tick;    /* OPT: index of the current access */
+} cache_t;
+
+int cache_init(cache_t *cache, int s, int E, int b, int list_lru);
+int cache_set_repl(cache_t *cache, int repl);
+void cache_free(cache_t *cache);
+int cache_access(cache_t *cache, mem_addr_t addr);
+int cache_lookup(cache_t *cache, mem_addr_t addr, int write);
+long long cache_use(cache_t *cache, mem_addr_t addr);
+long long cache_probe(const cache_t *cache, mem_addr_t addr);
+int cache_mark_dirty(cache_t *cache, mem_addr_t addr);
+int cache_insert(cache_t *cache, mem_addr_t addr, int dirty,
+                 mem_addr_t *victim, int *victim_dirty);
+int cache_invalidate(cache_t *cache, mem_addr_t addr);
+
+#endif // __cache_h__
@@ -0,0 +1,336 @@
+////////////////////////////////////////////////////////////////////////////////
+// Main File:        csim.c
+// This File:        classify.c
+// Other Files:      csim.c classify.h cache.c cache.h
+// Semester:         CS 354 Fall 2018
+//
+// Author:           Yuanhang Wang
+// Email:            wang2243@wisc.edu
+// CS Login:         ywang
+//
+/////////////////////////// OTHER SOURCES OF HELP //////////////////////////////
+//                   fully acknowledge and credit all sources of help,
+//                   other than Instructors and TAs.
+//
+// Persons:          Identify persons by name, relationship to you, and email.
+//                   Describe in detail the the ideas and help they provided.
+//
+// Online sources:   avoid web searches to solve your problems, but if you do
+//                   search, be sure to include Web URLs and description of
+//                   of any information you find.
+//////////////////////////// 80 columns wide ///////////////////////////////////
+
+/*
+ * classify.c - Sorts the misses of a cache into the three Cs and
+ *     attributes accesses and misses to address regions and to PCs (see
+ *     classify.h).
+ *
+ * A miss is
+ *   compulsory if its block was never accessed before,
+ *   capacity   otherwise if the shadow fully associative LRU cache of
+ *              the same size missed too,
+ *   conflict   otherwise.
+ * The shadow is a cache_t with one set in list LRU mode, so it costs O(1)
+ * per access however many lines it has. A shadow hit cannot be a first
+ * access, so only shadow misses look up the seen blocks, which are kept
+ * as bitmaps of 64 consecutive blocks to make dense data take little
+ * room. Those and the attribution tables are open-addressing hash tables
+ * that double when half full; consecutive accesses usually share a
+ * region and a PC, so the slot of the latest key is tried first. Reports
+ * select the top entries with a heap instead of sorting every entry.
+ *
+ * The PC of a data access is the address of the instruction record
+ * before it, as Valgrind writes the data accesses of an instruction
+ * right after it.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "classify.h"
+
+static inline size_t hash_key(mem_addr_t key, size_t size) {
+  unsigned long long h = key * 0x9E3779B97F4A7C15ULL;
+  return (h ^ h >> 31) & (size - 1);
+}
+
+static int map_init(attr_map_t *map) {
+  map->size = 1024;
+  map->used = 0;
+  map->last = 0;
+  map->slots = malloc(map->size * sizeof(attr_t));
+  if (map->slots == NULL)
+    return -1;
+  for (size_t i = 0; i < map->size; i++)
+    map->slots[i].key = TAG_INVALID;
+  return 0;
+}
+
+/*
+ * map_get - return the entry of 'key', adding it if need be
+ *   Returns NULL if memory runs out
+ */
+static attr_t *map_get(attr_map_t *map, mem_addr_t key) {
+  if (map->slots[map->last].key == key)
+    return &map->slots[map->last];
+  if (2 * (map->used + 1) > map->size) {
+    size_t size = 2 * map->size;
+    attr_t *slots = malloc(size * sizeof(attr_t));
+    if (slots == NULL)
+      return NULL;
+    for (size_t i = 0; i < size; i++)
+      slots[i].key = TAG_INVALID;
+    for (size_t i = 0; i < map->size; i++) {
+      if (map->slots[i].key == TAG_INVALID)
+        continue;
+      size_t k = hash_key(map->slots[i].key, size);
+      while (slots[k].key != TAG_INVALID)
+        k = (k + 1) & (size - 1);
+      slots[k] = map->slots[i];
+    }
+    free(map->slots);
+    map->slots = slots;
+    map->size = size;
+  }
+  size_t k = hash_key(key, map->size);
+  while (map->slots[k].key != key && map->slots[k].key != TAG_INVALID)
+    k = (k + 1) & (map->size - 1);
+  if (map->slots[k].key == TAG_INVALID) {
+    memset(&map->slots[k], 0, sizeof(attr_t));
+    map->slots[k].key = key;
+    map->used++;
+  }
+  map->last = k;
+  return &map->slots[k];
+}
+
+/*
+ * see - add 'block' to the seen blocks
+ *   Returns 1 if it is new, 0 if not, -1 if memory runs out
+ */
+static int see(classify_t *classify, mem_addr_t block) {
+  if (2 * (classify->seen_used + 1) > classify->seen_size) {
+    size_t size = 2 * classify->seen_size;
+    seen_chunk_t *seen = malloc(size * sizeof(seen_chunk_t));
+    if (seen == NULL)
+      return -1;
+    for (size_t i = 0; i < size; i++)
+      seen[i].chunk = TAG_INVALID;
+    for (size_t i = 0; i < classify->seen_size; i++) {
+      if (classify->seen[i].chunk == TAG_INVALID)
+        continue;
+      size_t k = hash_key(classify->seen[i].chunk, size);
+      while (seen[k].chunk != TAG_INVALID)
+        k = (k + 1) & (size - 1);
+      seen[k] = classify->seen[i];
+    }
+    free(classify->seen);
+    classify->seen = seen;
+    classify->seen_size = size;
+  }
+  mem_addr_t chunk = block >> 6;
+  unsigned long long bit = 1ULL << (block & 63);
+  size_t k = hash_key(chunk, classify->seen_size);
+  while (classify->seen[k].chunk != chunk) {
+    if (classify->seen[k].chunk == TAG_INVALID) {
+      classify->seen[k].chunk = chunk;
+      classify->seen[k].mask = 0;
+      classify->seen_used++;
+      break;
+    }
+    k = (k + 1) & (classify->seen_size - 1);
+  }
+  if (classify->seen[k].mask & bit)
+    return 0;
+  classify->seen[k].mask |= bit;
+  return 1;
+}
+
+/*
+ * classify_init - set up the classification of a cache with 2^s sets of
+ *   E lines of 2^b bytes, attributing to regions of 2^region_bits bytes
+ *   Returns 0 on success, -1 if memory runs out
+ */
+int classify_init(classify_t *classify, int s, int E, int b,
+                  int region_bits) {
+  memset(classify, 0, sizeof(classify_t));
+  classify->b = b;
+  classify->region_bits = region_bits;
+  classify->seen_size = 1024;
+  classify->seen = malloc(classify->seen_size * sizeof(seen_chunk_t));
+  if (classify->seen == NULL
+      || cache_init(&classify->shadow, 0, E << s, b, 1) != 0
+      || map_init(&classify->regions) != 0 || map_init(&classify->pcs) != 0) {
+    classify_free(classify);
+    return -1;
+  }
+  for (size_t i = 0; i < classify->seen_size; i++)
+    classify->seen[i].chunk = TAG_INVALID;
+  return 0;
+}
+
+/*
+ * classify_access - account for an access to 'addr' by the instruction at
+ *   'pc' (TAG_INVALID if unknown) that had 'result' in the real cache
+ *   Returns 0 on success, -1 if memory runs out
+ */
+int classify_access(classify_t *classify, mem_addr_t addr, mem_addr_t pc,
+                    int result) {
+  // A block the shadow holds has been seen, so only its misses need to
+  // look in the set
+  int shadow_hit = cache_access(&classify->shadow, addr) == CACHE_HIT;
+  int first = shadow_hit ? 0 : see(classify, addr >> classify->b);
+  int class = first ? MISS_COMPULSORY : shadow_hit ? MISS_CONFLICT
+                                                   : MISS_CAPACITY;
+  int miss = result != CACHE_HIT;
+  if (first < 0)
+    return -1;
+  classify->misses[class] += miss;
+
+  attr_t *region = map_get(&classify->regions, addr >> classify->region_bits);
+  if (region == NULL)
+    return -1;
+  region->accesses++;
+  region->misses[class] += miss;
+  if (pc != TAG_INVALID) {
+    attr_t *inst = map_get(&classify->pcs, pc);
+    if (inst == NULL)
+      return -1;
+    inst->accesses++;
+    inst->misses[class] += miss;
+  }
+  return 0;
+}
+
+static inline unsigned long long total(const attr_t *attr) {
+  return attr->misses[0] + attr->misses[1] + attr->misses[2];
+}
+
+/*
+ * before - whether 'x' ranks before 'y': more misses, then a lower key
+ */
+static inline int before(const attr_t *x, const attr_t *y) {
+  unsigned long long mx = total(x), my = total(y);
+  return mx != my ? mx > my : x->key < y->key;
+}
+
+/*
+ * sift_down - restore the heap order of 'heap', whose root ranks last,
+ *   after its root was replaced
+ */
+static void sift_down(const attr_t **heap, size_t n) {
+  size_t i = 0;
+  for (;;) {
+    size_t low = i, l = 2 * i + 1, r = l + 1;
+    if (l < n && before(heap[low], heap[l]))
+      low = l;
+    if (r < n && before(heap[low], heap[r]))
+      low = r;
+    if (low == i)
+      return;
+    const attr_t *tmp = heap[i];
+    heap[i] = heap[low];
+    heap[low] = tmp;
+    i = low;
+  }
+}
+
+/*
+ * print_top - print the 'top' entries of 'map' with the most misses
+ *   A heap of the best 'top' so far, worst at the root, takes
+ *   O(entries * log top) time
+ */
+static void print_top(const attr_map_t *map, const char *what, int shift,
+                      int top, FILE *fp) {
+  if (top < 1)
+    return;
+  const attr_t **sorted = malloc(top * sizeof(attr_t *));
+  size_t n = 0;
+  if (sorted == NULL)
+    return;
+  for (size_t i = 0; i < map->size; i++) {
+    const attr_t *attr = &map->slots[i];
+    if (attr->key == TAG_INVALID || total(attr) == 0)
+      continue;
+    if (n < (size_t) top) {
+      // Sift up
+      size_t k = n++;
+      while (k > 0 && before(sorted[(k - 1) / 2], attr)) {
+        sorted[k] = sorted[(k - 1) / 2];
+        k = (k - 1) / 2;
+      }
+      sorted[k] = attr;
+    } else if (before(attr, sorted[0])) {
+      sorted[0] = attr;
+      sift_down(sorted, n);
+    }
+  }
+  // Pop the worst to the end until the heap is sorted best first
+  for (size_t k = n; k > 1; k--) {
+    const attr_t *worst = sorted[0];
+    sorted[0] = sorted[k - 1];
+    sorted[k - 1] = worst;
+    sift_down(sorted, k - 1);
+  }
+
+  fprintf(fp, "%-18s %12s %12s %8s %12s %12s %12s\n", what, "accesses",
+          "misses", "miss%", "compulsory", "capacity", "conflict");
+  for (size_t i = 0; i < n; i++) {
+    const attr_t *attr = sorted[i];
+    fprintf(fp, "0x%-16llx %12llu %12llu %8.3f %12llu %12llu %12llu\n",
+            attr->key << shift, attr->accesses, total(attr),
+            100.0 * total(attr) / attr->accesses,
+            attr->misses[MISS_COMPULSORY], attr->misses[MISS_CAPACITY],
+            attr->misses[MISS_CONFLICT]);
+  }
+  free(sorted);
+}
+
+/*
+ * classify_print - print the miss classes and the 'top' regions and PCs
+ *   with the most misses
+ */
+void classify_print(const classify_t *classify, int top, FILE *fp) {
+  fprintf(fp, "compulsory:%llu capacity:%llu conflict:%llu\n",
+          classify->misses[MISS_COMPULSORY], classify->misses[MISS_CAPACITY],
+          classify->misses[MISS_CONFLICT]);
+  fprintf(fp, "\nTop %d regions of %d bytes by misses:\n", top,
+          1 << classify->region_bits);
+  print_top(&classify->regions, "region", classify->region_bits, top, fp);
+  if (classify->pcs.used) {
+    fprintf(fp, "\nTop %d PCs by misses:\n", top);
+    print_top(&classify->pcs, "pc", 0, top, fp);
+  }
+  fprintf(fp, "\n");
+}
+
+static void csv_rows(const attr_map_t *map, const char *kind, int shift,
+                     FILE *fp) {
+  for (size_t i = 0; i < map->size; i++) {
+    const attr_t *attr = &map->slots[i];
+    if (attr->key != TAG_INVALID)
+      fprintf(fp, "%s,0x%llx,%llu,%llu,%llu,%llu,%llu\n", kind,
+              attr->key << shift, attr->accesses, total(attr),
+              attr->misses[MISS_COMPULSORY], attr->misses[MISS_CAPACITY],
+              attr->misses[MISS_CONFLICT]);
+  }
+}
+
+/*
+ * classify_csv - write every region and PC as CSV, in no particular order
+ */
+void classify_csv(const classify_t *classify, FILE *fp) {
+  fprintf(fp, "kind,key,accesses,misses,compulsory,capacity,conflict\n");
+  csv_rows(&classify->regions, "region", classify->region_bits, fp);
+  csv_rows(&classify->pcs, "pc", 0, fp);
+}
+
+/*
+ * classify_free - free the shadow cache and the tables
+ */
+void classify_free(classify_t *classify) {
+  cache_free(&classify->shadow);
+  free(classify->seen);
+  free(classify->regions.slots);
+  free(classify->pcs.slots);
+  memset(classify, 0, sizeof(classify_t));
+}
@@ -0,0 +1,79 @@
+////////////////////////////////////////////////////////////////////////////////
+// Main File:        csim.c
+// This File:        classify.h
+// Other Files:      csim.c classify.c cache.c cache.h
+// Semester:         CS 354 Fall 2018
+//
+// Author:           Yuanhang Wang
+// Email:            wang2243@wisc.edu
+// CS Login:         ywang
+//
+/////////////////////////// OTHER SOURCES OF HELP //////////////////////////////
+//                   fully acknowledge and credit all sources of help,
+//                   other than Instructors and TAs.
+//
+// Persons:          Identify persons by name, relationship to you, and email.
+//                   Describe in detail the the ideas and help they provided.
+//
+// Online sources:   avoid web searches to solve your problems, but if you do
+//                   search, be sure to include Web URLs and description of
+//                   of any information you find.
+//////////////////////////// 80 columns wide ///////////////////////////////////
+
+#ifndef __classify_h__
+#define __classify_h__
+
+#include <stdio.h>
+#include "cache.h"
+
+/* Miss classes */
+#define MISS_COMPULSORY 0  /* first access to the block */
+#define MISS_CAPACITY   1  /* a fully associative cache would miss too */
+#define MISS_CONFLICT   2  /* only the set mapping made it miss */
+
+/* Type: Accesses and misses attributed to one region or PC */
+typedef struct attr {
+  mem_addr_t key;             /* region number or PC, TAG_INVALID => free */
+  unsigned long long accesses;
+  unsigned long long misses[3];  /* indexed by MISS_* */
+} attr_t;
+
+/* Type: Hash table of attr_t by key */
+typedef struct attr_map {
+  attr_t *slots;
+  size_t size;                /* a power of two */
+  size_t used;
+  size_t last;                /* slot of the latest key looked up */
+} attr_map_t;
+
+/* Type: The seen blocks among 64 consecutive ones */
+typedef struct seen_chunk {
+  mem_addr_t chunk;           /* block number / 64, TAG_INVALID => free */
+  unsigned long long mask;    /* bit i => block chunk * 64 + i seen */
+} seen_chunk_t;
+
+/* Type: Miss classification of a cache
+ * Every access also goes to 'shadow', a fully associative LRU cache with
+ * as many lines, and every block is remembered in 'seen'.
+ */
+typedef struct classify {
+  cache_t shadow;
+  int b;
+  int region_bits;            /* regions are 2^region_bits bytes */
+  seen_chunk_t *seen;         /* hash table of chunks */
+  size_t seen_size;
+  size_t seen_used;
+  unsigned long long misses[3];
+  attr_map_t regions;
+  attr_map_t pcs;
+} classify_t;
+
+int classify_init(classify_t *classify, int s, int E, int b,
+                  int region_bits);
+int classify_access(classify_t *classify, mem_addr_t addr, mem_addr_t pc,
+                    int result);
+void classify_print(const classify_t *classify, int top, FILE *fp);
+void classify_csv(const classify_t *classify, FILE *fp);
+void classify_free(classify_t *classify);
+
+#endif // __classify_h__
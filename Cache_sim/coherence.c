@@ -0,0 +1,628 @@
+////////////////////////////////////////////////////////////////////////////////
+// Main File:        csim.c
+// This File:        coherence.c
+// Other Files:      csim.c libcsim.c libcsim.h coherence.h cache.c cache.h
+//                   ring.h
+// Semester:         CS 354 Fall 2018
+//
+// Author:           Yuanhang Wang
+// Email:            wang2243@wisc.edu
+// CS Login:         ywang
+//
+/////////////////////////// OTHER SOURCES OF HELP //////////////////////////////
+//                   fully acknowledge and credit all sources of help,
+//                   other than Instructors and TAs.
+//
+// Persons:          Identify persons by name, relationship to you, and email.
+//                   Describe in detail the the ideas and help they provided.
+//
+// Online sources:   avoid web searches to solve your problems, but if you do
+//                   search, be sure to include Web URLs and description of
+//                   of any information you find.
+//////////////////////////// 80 columns wide ///////////////////////////////////
+
+/*
+ * coherence.c - Private caches of several cores kept coherent with the
+ *     MESI or MOESI protocol (see coherence.h).
+ *
+ * Every core has a cache of the same geometry, each line of which has a
+ * state besides its tag. A read hits in any valid state and a write in E
+ * or M. Anything else goes out to the other caches:
+ *
+ *   - a read miss takes the line from the cache holding it dirty (M or
+ *     O), if any, which counts as a cache-to-cache transfer. Under MESI
+ *     that cache writes the line back and keeps it in S, under MOESI it
+ *     keeps it in O and memory stays stale. The line comes in E if no
+ *     other cache has it, else in S, demoting an E copy to S.
+ *   - a write miss does the same, then invalidates every other copy.
+ *   - a write to an S or O line upgrades it, invalidating the others.
+ *   - evicting an M or O line writes it back.
+ *
+ * Snooping and directory protocols go through the same states and only
+ * differ in the messages they take, which coherence_print counts: a
+ * snooping bus shows every request to every other cache, a full-map
+ * directory forwards it to the owner and the sharers alone, and hears of
+ * clean evictions to keep the map exact.
+ *
+ * A line gets a sharing entry once a write invalidates a copy of it. The
+ * entry remembers, for each core that lost its copy, the bytes written
+ * since. When the core misses on the line again, the miss is true sharing
+ * if it accesses any of those bytes and false sharing otherwise, when
+ * only the line being shared cost the miss.
+ *
+ * The state of a line only ever depends on the accesses to its block, and
+ * replacement only on those to its set, so the sets split into parts that
+ * share nothing, and the parts can run in threads of their own like the
+ * engine of parallel.c.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include "coherence.h"
+#include "repl.h"
+
+#define RING_SIZE (1 << 16)  /* ring entries per part */
+
+static const char *protocol_names[] = {"MESI", "MOESI"};
+
+static inline size_t hash_block(mem_addr_t block, size_t size) {
+  unsigned long long h = block * 0x9E3779B97F4A7C15ULL;
+  return (h ^ h >> 31) & (size - 1);
+}
+
+/*
+ * find_entry - return the sharing entry of 'block', NULL if it has none
+ */
+static coh_line_t *find_entry(coh_part_t *part, mem_addr_t block) {
+  size_t k = hash_block(block, part->size);
+  while (part->lines[k].block != block) {
+    if (part->lines[k].block == TAG_INVALID)
+      return NULL;
+    k = (k + 1) & (part->size - 1);
+  }
+  return &part->lines[k];
+}
+
+/*
+ * add_entry - add a sharing entry for 'block', which has none
+ *   Returns it, or NULL if memory runs out
+ */
+static coh_line_t *add_entry(coh_part_t *part, mem_addr_t block) {
+  size_t ncores = part->coh->ncores;
+  if (part->masks_used + ncores > part->masks_size) {
+    size_t size = 2 * part->masks_size + 1024 * ncores;
+    unsigned long long *masks = realloc(part->masks,
+                                        size * sizeof(unsigned long long));
+    if (masks == NULL)
+      return NULL;
+    part->masks = masks;
+    part->masks_size = size;
+  }
+  if (2 * (part->used + 1) > part->size) {
+    size_t size = 2 * part->size;
+    coh_line_t *lines = malloc(size * sizeof(coh_line_t));
+    if (lines == NULL)
+      return NULL;
+    for (size_t i = 0; i < size; i++)
+      lines[i].block = TAG_INVALID;
+    for (size_t i = 0; i < part->size; i++) {
+      if (part->lines[i].block == TAG_INVALID)
+        continue;
+      size_t k = hash_block(part->lines[i].block, size);
+      while (lines[k].block != TAG_INVALID)
+        k = (k + 1) & (size - 1);
+      lines[k] = part->lines[i];
+    }
+    free(part->lines);
+    part->lines = lines;
+    part->size = size;
+  }
+  size_t k = hash_block(block, part->size);
+  while (part->lines[k].block != TAG_INVALID)
+    k = (k + 1) & (part->size - 1);
+  coh_line_t *entry = &part->lines[k];
+  memset(entry, 0, sizeof(coh_line_t));
+  entry->block = block;
+  entry->written = part->masks_used;
+  memset(part->masks + part->masks_used, 0,
+         ncores * sizeof(unsigned long long));
+  part->masks_used += ncores;
+  part->used++;
+  return entry;
+}
+
+/*
+ * byte_mask - the bits of the mask of a line that 'len' bytes at 'addr'
+ *   cover, cut at the end of the line
+ */
+static inline unsigned long long byte_mask(const coherence_t *coh,
+                                           mem_addr_t addr,
+                                           unsigned int len) {
+  int g = coh->b > 6 ? coh->b - 6 : 0;
+  mem_addr_t line_mask = ((mem_addr_t) 1 << coh->b) - 1;
+  mem_addr_t first = addr & line_mask;
+  mem_addr_t last = first + (len ? len - 1 : 0);
+  if (last > line_mask)
+    last = line_mask;
+  int lo = first >> g, hi = last >> g;
+  return (hi == 63 ? ~0ULL : (1ULL << (hi + 1)) - 1) & ~((1ULL << lo) - 1);
+}
+
+/*
+ * note_write - add the bytes 'core' writes to the masks of the cores that
+ *   lost the line of 'entry'
+ */
+static inline void note_write(coh_part_t *part, coh_line_t *entry, int core,
+                              unsigned long long bytes) {
+  unsigned long long others = entry->lost & ~(1ULL << core);
+  entry->cores |= 1ULL << core;
+  while (others) {
+    int k = __builtin_ctzll(others);
+    others &= others - 1;
+    part->masks[entry->written + k] |= bytes;
+  }
+}
+
+/*
+ * step - simulate a load ('write' clear) or store ('write' set) of 'len'
+ *   bytes at 'addr' by 'core' in the sets of 'part'
+ *   Returns the outcome in the core's cache: CACHE_HIT, CACHE_MISS or
+ *   CACHE_EVICT, an upgrade being a hit
+ */
+static int step(coh_part_t *part, int core, mem_addr_t addr,
+                unsigned int len, int write) {
+  coherence_t *coh = part->coh;
+  cache_t *cache = &part->caches[core];
+  unsigned char *state = coh->states[core];
+  coh_stats_t *stats = &part->stats[core];
+  unsigned long long me = 1ULL << core;
+  long long line = cache_use(cache, addr);
+  int st = line >= 0 ? state[line] & COH_STATE : COH_I;
+  coh_line_t *entry;
+
+  // Hits that need no other cache
+  if (st != COH_I && (!write || st == COH_E || st == COH_M)) {
+    if (write) {
+      state[line] = COH_M | (state[line] & COH_TRACKED);
+      if ((state[line] & COH_TRACKED)
+          && (entry = find_entry(part, addr >> coh->b)) != NULL)
+        note_write(part, entry, core, byte_mask(coh, addr, len));
+    }
+    stats->counts[CACHE_HIT]++;
+    return CACHE_HIT;
+  }
+
+  // Find the other copies, as a snoop or the directory would
+  long long lines[COH_CORES];
+  unsigned long long sharers = 0;
+  int owner = -1;
+  for (int k = 0; k < coh->ncores; k++) {
+    if (k == core || (lines[k] = cache_probe(&part->caches[k], addr)) < 0)
+      continue;
+    sharers |= 1ULL << k;
+    int sk = coh->states[k][lines[k]] & COH_STATE;
+    if (sk == COH_M || sk == COH_O)
+      owner = k;
+  }
+  part->transactions++;
+  mem_addr_t block = addr >> coh->b;
+  unsigned long long bytes = byte_mask(coh, addr, len);
+  entry = find_entry(part, block);
+
+  int result = CACHE_HIT;
+  if (st == COH_I) {
+    mem_addr_t victim;
+    int victim_dirty;
+    result = cache_insert(cache, addr, 0, &victim, &victim_dirty);
+    line = cache_probe(cache, addr);
+    if (result == CACHE_EVICT) {
+      int old = state[line] & COH_STATE;
+      if (old == COH_M || old == COH_O)
+        stats->writebacks++;
+      else if (coh->directory)
+        part->notices++;
+    }
+    if (entry && (entry->lost & me)) {
+      unsigned long long *written = &part->masks[entry->written + core];
+      if (*written & bytes) {
+        stats->true_sharing++;
+        entry->true_sharing++;
+      } else {
+        stats->false_sharing++;
+        entry->false_sharing++;
+      }
+      *written = 0;
+      entry->lost &= ~me;
+    }
+    if (owner >= 0) {
+      stats->transfers++;
+      if (entry)
+        entry->transfers++;
+    }
+  } else {
+    stats->upgrades++;
+  }
+
+  if (write) {
+    // Invalidate every other copy, remembering who lost one
+    if (sharers && entry == NULL && (entry = add_entry(part, block)) == NULL)
+      part->failed = 1;
+    for (unsigned long long left = sharers; left; left &= left - 1) {
+      int k = __builtin_ctzll(left);
+      cache_invalidate(&part->caches[k], addr);
+      coh->states[k][lines[k]] = COH_I;
+      part->stats[k].invalidations++;
+      if (entry) {
+        entry->invalidations++;
+        entry->lost |= 1ULL << k;
+        part->masks[entry->written + k] = 0;
+      }
+    }
+    state[line] = COH_M;
+  } else if (owner >= 0) {
+    unsigned char *so = &coh->states[owner][lines[owner]];
+    if ((*so & COH_STATE) == COH_M) {
+      if (coh->protocol == COH_MOESI) {
+        *so = COH_O | (*so & COH_TRACKED);
+      } else {
+        *so = COH_S | (*so & COH_TRACKED);
+        part->stats[owner].writebacks++;
+      }
+    }
+    state[line] = COH_S;
+  } else {
+    for (unsigned long long left = sharers; left; left &= left - 1) {
+      int k = __builtin_ctzll(left);
+      unsigned char *sk = &coh->states[k][lines[k]];
+      if ((*sk & COH_STATE) == COH_E)
+        *sk = COH_S | (*sk & COH_TRACKED);
+    }
+    state[line] = sharers ? COH_S : COH_E;
+  }
+
+  // Writes to a line others lost are remembered until they miss on it
+  if (entry) {
+    entry->cores |= me | sharers;
+    if (entry->lost & ~me)
+      state[line] |= COH_TRACKED;
+    if (write)
+      note_write(part, entry, core, bytes);
+  }
+  stats->counts[result]++;
+  return result;
+}
+
+static void *part_main(void *arg) {
+  coh_part_t *part = arg;
+  mem_addr_t batch[COH_BATCH];
+  for (;;) {
+    size_t n = ring_pop(&part->ring, batch, COH_BATCH);
+    if (n == 0) {
+      if (__atomic_load_n(&part->ring.done, __ATOMIC_ACQUIRE)
+          && (n = ring_pop(&part->ring, batch, COH_BATCH)) == 0)
+        break;
+      if (n == 0) {
+        sched_yield();
+        continue;
+      }
+    }
+    // Pushes and pops are all of even counts, so accesses never straddle
+    // two of them (see coherence_submit)
+    for (size_t i = 0; i < n; i += 2)
+      step(part, batch[i + 1] & 0xff, batch[i], batch[i + 1] >> 16,
+           (batch[i + 1] >> 8) & 1);
+  }
+  return NULL;
+}
+
+/*
+ * flush - push the staged entries of 'part' into its ring, waiting for
+ *   room if its thread is behind
+ */
+static void flush(coh_part_t *part) {
+  size_t done = 0;
+  while (done < (size_t) part->batched) {
+    done += ring_push(&part->ring, part->batch + done,
+                      part->batched - done);
+    if (done < (size_t) part->batched)
+      sched_yield();
+  }
+  part->batched = 0;
+}
+
+/*
+ * init_part - set up 'part' of 'coh', starting its thread if threaded
+ *   Returns 0 on success, -1 on failure, freeing what it allocated
+ */
+static int init_part(coherence_t *coh, coh_part_t *part) {
+  memset(part, 0, sizeof(coh_part_t));
+  part->coh = coh;
+  part->caches = malloc(coh->ncores * sizeof(cache_t));
+  part->stats = calloc(coh->ncores, sizeof(coh_stats_t));
+  part->size = 1024;
+  part->lines = malloc(part->size * sizeof(coh_line_t));
+  if (part->caches && part->stats && part->lines) {
+    for (int k = 0; k < coh->ncores; k++)
+      part->caches[k] = coh->caches[k];
+    for (size_t i = 0; i < part->size; i++)
+      part->lines[i].block = TAG_INVALID;
+    if (!coh->threaded)
+      return 0;
+    part->ring.slots = malloc(RING_SIZE * sizeof(mem_addr_t));
+    part->ring.mask = RING_SIZE - 1;
+    if (part->ring.slots
+        && pthread_create(&part->tid, NULL, part_main, part) == 0)
+      return 0;
+  }
+  free(part->caches);
+  free(part->stats);
+  free(part->lines);
+  free(part->ring.slots);
+  return -1;
+}
+
+/*
+ * coherence_init - set up 'ncores' caches of 2^s sets of E lines of 2^b
+ *   bytes under replacement policy 'repl', kept coherent by 'protocol'
+ *   through a directory if 'directory' is set, else by snooping, split
+ *   among 'nthreads' threads if above 1 (fewer if there are fewer sets)
+ *   Returns 0 on success, -1 if a parameter is invalid or on failure
+ */
+int coherence_init(coherence_t *coh, int ncores, int s, int E, int b,
+                   int repl, int protocol, int directory, int nthreads) {
+  memset(coh, 0, sizeof(coherence_t));
+  if (ncores < 1 || ncores > COH_CORES
+      || (protocol != COH_MESI && protocol != COH_MOESI))
+    return -1;
+  coh->protocol = protocol;
+  coh->directory = directory;
+  coh->s = s;
+  coh->b = b;
+  coh->caches = calloc(ncores, sizeof(cache_t));
+  coh->states = calloc(ncores, sizeof(unsigned char *));
+  if (coh->caches == NULL || coh->states == NULL)
+    goto fail;
+  for (; coh->ncores < ncores; coh->ncores++) {
+    cache_t *cache = &coh->caches[coh->ncores];
+    if (cache_init(cache, s, E, b, 0) != 0)
+      goto fail;
+    coh->states[coh->ncores] = calloc((size_t) cache->S * cache->ways, 1);
+    if (coh->states[coh->ncores] == NULL
+        || cache_set_repl(cache, repl) != 0) {
+      cache_free(cache);
+      free(coh->states[coh->ncores]);
+      goto fail;
+    }
+  }
+
+  int nparts = nthreads > 1 ? nthreads : 1;
+  if (nparts > coh->caches[0].S)
+    nparts = coh->caches[0].S;
+  coh->threaded = nthreads > 1;
+  coh->running = coh->threaded;
+  coh->parts = calloc(nparts, sizeof(coh_part_t));
+  if (coh->parts == NULL)
+    goto fail;
+  for (; coh->nparts < nparts; coh->nparts++)
+    if (init_part(coh, &coh->parts[coh->nparts]) != 0)
+      goto fail;
+  return 0;
+
+fail:
+  coherence_free(coh);
+  return -1;
+}
+
+/*
+ * coherence_access - simulate a load ('write' clear) or store ('write'
+ *   set) of 'len' bytes at 'addr' by 'core', without threads
+ *   Returns the outcome in the core's cache: CACHE_HIT, CACHE_MISS or
+ *   CACHE_EVICT
+ */
+int coherence_access(coherence_t *coh, int core, mem_addr_t addr,
+                     unsigned int len, int write) {
+  return step(&coh->parts[0], core, addr, len, write);
+}
+
+/*
+ * coherence_submit - hand a load or store, as coherence_access takes
+ *   them, to the thread of the part owning its set
+ *   Every access takes two ring entries and rings fill and drain in
+ *   batches of an even count, so they only ever hold whole accesses.
+ */
+void coherence_submit(coherence_t *coh, int core, mem_addr_t addr,
+                      unsigned int len, int write) {
+  mem_addr_t set = (addr >> coh->b) & (((mem_addr_t) 1 << coh->s) - 1);
+  coh_part_t *part = &coh->parts[(set * coh->nparts) >> coh->s];
+  part->batch[part->batched++] = addr;
+  part->batch[part->batched++] = core | (mem_addr_t) write << 8
+                                 | (mem_addr_t) len << 16;
+  if (part->batched == COH_BATCH)
+    flush(part);
+}
+
+/*
+ * stop - wait for the threads to drain their rings and join them
+ */
+static void stop(coherence_t *coh) {
+  if (!coh->running)
+    return;
+  for (int p = 0; p < coh->nparts; p++) {
+    flush(&coh->parts[p]);
+    __atomic_store_n(&coh->parts[p].ring.done, 1, __ATOMIC_RELEASE);
+  }
+  for (int p = 0; p < coh->nparts; p++)
+    pthread_join(coh->parts[p].tid, NULL);
+  coh->running = 0;
+}
+
+/*
+ * coherence_finish - with threads, wait for them to simulate every
+ *   access submitted and add up the outcomes into 'counts' (indexed by
+ *   CACHE_HIT/MISS/EVICT)
+ *   Returns 0 on success, -1 if memory ran out for the sharing entries
+ */
+int coherence_finish(coherence_t *coh, unsigned long long counts[3]) {
+  int status = 0;
+  if (coh->running) {
+    stop(coh);
+    for (int p = 0; p < coh->nparts; p++)
+      for (int k = 0; k < coh->ncores; k++)
+        for (int i = 0; i < 3; i++)
+          counts[i] += coh->parts[p].stats[k].counts[i];
+  }
+  for (int p = 0; p < coh->nparts; p++)
+    if (coh->parts[p].failed)
+      status = -1;
+  return status;
+}
+
+/*
+ * print_stats - print a row of the per core table
+ */
+static void print_stats(const char *name, const coh_stats_t *stats,
+                        FILE *fp) {
+  fprintf(fp, "%-5s %12llu %12llu %12llu %10llu %10llu %10llu %10llu\n",
+          name, stats->counts[CACHE_HIT],
+          stats->counts[CACHE_MISS] + stats->counts[CACHE_EVICT],
+          stats->counts[CACHE_EVICT], stats->upgrades, stats->invalidations,
+          stats->transfers, stats->writebacks);
+}
+
+/*
+ * by_false_sharing - qsort order of lines: more false sharing misses,
+ *   then a lower block
+ */
+static int by_false_sharing(const void *x, const void *y) {
+  const coh_line_t *a = *(const coh_line_t **) x;
+  const coh_line_t *b = *(const coh_line_t **) y;
+  if (a->false_sharing != b->false_sharing)
+    return a->false_sharing > b->false_sharing ? -1 : 1;
+  return a->block < b->block ? -1 : a->block > b->block;
+}
+
+/*
+ * print_top - print the 'top' lines with the most false sharing misses
+ */
+static void print_top(const coherence_t *coh, int top, FILE *fp) {
+  size_t n = 0;
+  for (int p = 0; p < coh->nparts; p++)
+    n += coh->parts[p].used;
+  const coh_line_t **sorted = malloc((n ? n : 1) * sizeof(coh_line_t *));
+  if (sorted == NULL || top < 1) {
+    free(sorted);
+    return;
+  }
+  n = 0;
+  for (int p = 0; p < coh->nparts; p++)
+    for (size_t i = 0; i < coh->parts[p].size; i++) {
+      const coh_line_t *line = &coh->parts[p].lines[i];
+      if (line->block != TAG_INVALID && line->false_sharing > 0)
+        sorted[n++] = line;
+    }
+  qsort(sorted, n, sizeof(coh_line_t *), by_false_sharing);
+
+  fprintf(fp, "\nTop %d falsely shared lines:\n", top);
+  fprintf(fp, "%-18s %12s %12s %12s %12s %5s\n", "line", "false", "true",
+          "invals", "transfers", "cores");
+  for (size_t i = 0; i < n && i < (size_t) top; i++) {
+    const coh_line_t *line = sorted[i];
+    fprintf(fp, "0x%-16llx %12llu %12llu %12llu %12llu %5d\n",
+            line->block << coh->b, line->false_sharing, line->true_sharing,
+            line->invalidations, line->transfers,
+            __builtin_popcountll(line->cores));
+  }
+  free(sorted);
+}
+
+/*
+ * coherence_print - print what happened to every core's cache, the
+ *   messages the protocol took and the 'top' lines with the most false
+ *   sharing misses
+ *   A snoop is a lookup of a request in another cache. Through the
+ *   directory every request is a message, each transfer a forward to the
+ *   owner, each invalidation a message and its acknowledgement, and each
+ *   eviction a notice or a writeback.
+ */
+void coherence_print(const coherence_t *coh, int top, FILE *fp) {
+  coh_stats_t all;
+  unsigned long long transactions = 0, notices = 0;
+  char name[12];
+
+  memset(&all, 0, sizeof(coh_stats_t));
+  fprintf(fp, "coherence: %s, %s, %d cores\n",
+          protocol_names[coh->protocol],
+          coh->directory ? "directory" : "snooping", coh->ncores);
+  fprintf(fp, "%-5s %12s %12s %12s %10s %10s %10s %10s\n", "core", "hits",
+          "misses", "evictions", "upgrades", "invals", "transfers",
+          "writebacks");
+  for (int k = 0; k < coh->ncores; k++) {
+    coh_stats_t core;
+    memset(&core, 0, sizeof(coh_stats_t));
+    for (int p = 0; p < coh->nparts; p++) {
+      const coh_stats_t *stats = &coh->parts[p].stats[k];
+      for (int i = 0; i < 3; i++)
+        core.counts[i] += stats->counts[i];
+      core.upgrades += stats->upgrades;
+      core.invalidations += stats->invalidations;
+      core.transfers += stats->transfers;
+      core.writebacks += stats->writebacks;
+      core.true_sharing += stats->true_sharing;
+      core.false_sharing += stats->false_sharing;
+    }
+    snprintf(name, sizeof(name), "%d", k);
+    print_stats(name, &core, fp);
+    for (int i = 0; i < 3; i++)
+      all.counts[i] += core.counts[i];
+    all.upgrades += core.upgrades;
+    all.invalidations += core.invalidations;
+    all.transfers += core.transfers;
+    all.writebacks += core.writebacks;
+    all.true_sharing += core.true_sharing;
+    all.false_sharing += core.false_sharing;
+  }
+  print_stats("all", &all, fp);
+  for (int p = 0; p < coh->nparts; p++) {
+    transactions += coh->parts[p].transactions;
+    notices += coh->parts[p].notices;
+  }
+
+  if (coh->directory)
+    fprintf(fp, "directory messages:%llu (requests:%llu forwards:%llu "
+            "invalidations:%llu acks:%llu notices:%llu writebacks:%llu)\n",
+            transactions + all.transfers + 2 * all.invalidations + notices
+            + all.writebacks, transactions, all.transfers,
+            all.invalidations, all.invalidations, notices, all.writebacks);
+  else
+    fprintf(fp, "bus transactions:%llu snoops:%llu\n", transactions,
+            transactions * (coh->ncores - 1));
+  fprintf(fp, "sharing misses:%llu (true:%llu false:%llu)\n",
+          all.true_sharing + all.false_sharing, all.true_sharing,
+          all.false_sharing);
+  print_top(coh, top, fp);
+}
+
+/*
+ * coherence_free - stop the threads if coherence_finish did not and free
+ *   everything coherence_init allocated
+ */
+void coherence_free(coherence_t *coh) {
+  stop(coh);
+  for (int p = 0; p < coh->nparts; p++) {
+    coh_part_t *part = &coh->parts[p];
+    free(part->caches);
+    free(part->stats);
+    free(part->lines);
+    free(part->masks);
+    free(part->ring.slots);
+  }
+  for (int k = 0; k < coh->ncores; k++) {
+    cache_free(&coh->caches[k]);
+    free(coh->states[k]);
+  }
+  free(coh->parts);
+  free(coh->caches);
+  free(coh->states);
+  memset(coh, 0, sizeof(coherence_t));
+}
@@ -0,0 +1,129 @@
+////////////////////////////////////////////////////////////////////////////////
+// Main File:        csim.c
+// This File:        coherence.h
+// Other Files:      csim.c libcsim.c libcsim.h coherence.c cache.c cache.h
+//                   ring.h
+// Semester:         CS 354 Fall 2018
+//
+// Author:           Yuanhang Wang
+// Email:            wang2243@wisc.edu
+// CS Login:         ywang
+//
+/////////////////////////// OTHER SOURCES OF HELP //////////////////////////////
+//                   fully acknowledge and credit all sources of help,
+//                   other than Instructors and TAs.
+//
+// Persons:          Identify persons by name, relationship to you, and email.
+//                   Describe in detail the the ideas and help they provided.
+//
+// Online sources:   avoid web searches to solve your problems, but if you do
+//                   search, be sure to include Web URLs and description of
+//                   of any information you find.
+//////////////////////////// 80 columns wide ///////////////////////////////////
+
+#ifndef __coherence_h__
+#define __coherence_h__
+
+#include <stdio.h>
+#include <pthread.h>
+#include "cache.h"
+#include "ring.h"
+
+#define COH_CORES 64      /* at most, so that a set of cores fits a word */
+#define COH_BATCH 256     /* ring entries staged per part, two per access */
+
+/* Protocols */
+#define COH_MESI  0
+#define COH_MOESI 1
+
+/* Line states, in the low bits of a state byte */
+#define COH_I 0           /* invalid */
+#define COH_S 1           /* shared */
+#define COH_E 2           /* exclusive and clean */
+#define COH_O 3           /* owned: dirty, maybe shared, MOESI only */
+#define COH_M 4           /* modified: dirty and the only copy */
+#define COH_STATE   0x07
+#define COH_TRACKED 0x80  /* writes to the line update its sharing entry */
+
+/* Type: What happened to one core's cache */
+typedef struct coh_stats {
+  unsigned long long counts[3];     /* indexed by CACHE_HIT/MISS/EVICT */
+  unsigned long long upgrades;      /* writes to lines held shared or owned */
+  unsigned long long invalidations; /* copies lost to other cores' writes */
+  unsigned long long transfers;     /* misses another cache supplied */
+  unsigned long long writebacks;    /* dirty lines written to memory */
+  unsigned long long true_sharing;  /* misses on lost lines, for bytes
+                                       written since */
+  unsigned long long false_sharing; /* misses on lost lines, for other
+                                       bytes */
+} coh_stats_t;
+
+/* Type: Sharing history of a line some write invalidated copies of
+ * A bit of a mask covers 1/64 of the line.
+ */
+typedef struct coh_line {
+  mem_addr_t block;           /* block number, TAG_INVALID => free */
+  unsigned long long cores;   /* that accessed it since */
+  unsigned long long lost;    /* whose copy was invalidated, until they
+                                 miss on it again */
+  size_t written;             /* index of its per core masks of the bytes
+                                 written since they lost it */
+  unsigned long long invalidations;
+  unsigned long long transfers;
+  unsigned long long true_sharing;
+  unsigned long long false_sharing;
+} coh_line_t;
+
+/* Type: A range of the sets of every core's cache, with what happened to
+ * them
+ * Parts share no line, so each can run in a thread of its own.
+ */
+typedef struct coh_part {
+  struct coherence *coh;
+  cache_t *caches;            /* per core, sharing the arrays of the
+                                 cores' caches with a clock of their own */
+  coh_stats_t *stats;         /* per core */
+  unsigned long long transactions;  /* misses and upgrades sent out */
+  unsigned long long notices;       /* clean evictions, directory only */
+  coh_line_t *lines;          /* hash table of lines by block */
+  size_t size;                /* a power of two */
+  size_t used;
+  unsigned long long *masks;  /* 'ncores' per line */
+  size_t masks_used, masks_size;
+  int failed;                 /* nonzero => memory ran out */
+  pthread_t tid;
+  ring_t ring;                /* addresses, then core | write << 8 |
+                                 len << 16 */
+  mem_addr_t batch[COH_BATCH];
+  int batched;
+} coh_part_t;
+
+/* Type: Private caches of 'ncores' cores kept coherent
+ * With several parts, the thread calling coherence_submit routes every
+ * access to the part owning its set, which sees the accesses to its sets
+ * in order, so the outcome does not depend on the number of parts.
+ */
+typedef struct coherence {
+  int protocol;               /* one of COH_MESI and COH_MOESI */
+  int directory;              /* nonzero => directory, else snooping */
+  int ncores;
+  int nparts;
+  int threaded;               /* nonzero => each part has a thread */
+  int running;                /* nonzero => the threads are not joined */
+  int s, b;
+  cache_t *caches;            /* per core */
+  unsigned char **states;     /* per core, per line */
+  coh_part_t *parts;
+} coherence_t;
+
+int coherence_init(coherence_t *coh, int ncores, int s, int E, int b,
+                   int repl, int protocol, int directory, int nthreads);
+int coherence_access(coherence_t *coh, int core, mem_addr_t addr,
+                     unsigned int len, int write);
+void coherence_submit(coherence_t *coh, int core, mem_addr_t addr,
+                      unsigned int len, int write);
+int coherence_finish(coherence_t *coh, unsigned long long counts[3]);
+void coherence_print(const coherence_t *coh, int top, FILE *fp);
+void coherence_free(coherence_t *coh);
+
+#endif // __coherence_h__
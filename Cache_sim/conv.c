@@ -0,0 +1,137 @@
+////////////////////////////////////////////////////////////////////////////////
+// Main File:        conv.c
+// This File:        conv.c
+// Other Files:      trace.c trace.h series.c series.h cache.h
+// Semester:         CS 354 Fall 2018
+//
+// Author:           Yuanhang Wang
+// Email:            wang2243@wisc.edu
+// CS Login:         ywang
+//
+/////////////////////////// OTHER SOURCES OF HELP //////////////////////////////
+//                   fully acknowledge and credit all sources of help,
+//                   other than Instructors and TAs.
+//
+// Persons:          Identify persons by name, relationship to you, and email.
+//                   Describe in detail the the ideas and help they provided.
+//
+// Online sources:   avoid web searches to solve your problems, but if you do
+//                   search, be sure to include Web URLs and description of
+//                   of any information you find.
+//////////////////////////// 80 columns wide ///////////////////////////////////
+
+/*
+ * conv.c - csim-conv converts a Valgrind text trace to the binary trace
+ *     format of trace.h, or a binary trace back to text.  It also prints
+ *     the time series files of csim -o as CSV.
+ *
+ *     linux>  valgrind --tool=lackey --trace-mem=yes ls 2>&1 \
+ *                 | ./csim-conv > ls.bin
+ *     linux>  zstd -dc big.bin.zst | ./csim -s 8 -E 4 -b 6 -t -
+ *     linux>  ./csim-conv long.ser > long.csv
+ */
+
+#include <getopt.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include "trace.h"
+#include "series.h"
+
+/*
+ * print_usage - Print usage info
+ */
+void print_usage(char *argv[]) {
+  printf("Usage: %s [-h] [-o <file>] [<file>]\n", argv[0]);
+  printf("Options:\n");
+  printf("  -h         Print this help message.\n");
+  printf("  -o <file>  Output file (default: stdout).\n");
+  printf("  <file>     Input trace, text or binary (default: stdin), or\n");
+  printf("             time series file.\n");
+  printf("\nA text trace is converted to binary and a binary one to text.\n");
+  printf("A time series file of csim -o is printed as CSV.\n");
+}
+
+int main(int argc, char *argv[]) {
+  char *in_fn = "-";
+  char *out_fn = NULL;
+  int c;
+
+  while ((c = getopt(argc, argv, "o:h")) != -1) {
+    switch (c) {
+      case 'o':out_fn = optarg;
+        break;
+      case 'h':print_usage(argv);
+        exit(0);
+      default:print_usage(argv);
+        exit(1);
+    }
+  }
+  if (optind < argc)
+    in_fn = argv[optind];
+
+  // Time series files are told by their magic, so they cannot be stdin
+  FILE *in_fp = strcmp(in_fn, "-") != 0 ? fopen(in_fn, "rb") : NULL;
+  char magic[sizeof(SERIES_MAGIC) - 1];
+  if (in_fp && fread(magic, 1, sizeof(magic), in_fp) == sizeof(magic)
+      && memcmp(magic, SERIES_MAGIC, sizeof(magic)) == 0) {
+    FILE *out_fp = out_fn ? fopen(out_fn, "w") : stdout;
+    if (!out_fp) {
+      fprintf(stderr, "%s: %s\n", out_fn, strerror(errno));
+      exit(1);
+    }
+    rewind(in_fp);
+    if (series_csv(in_fp, out_fp) != 0) {
+      fprintf(stderr, "%s: truncated or unreadable time series\n", in_fn);
+      exit(1);
+    }
+    if (fclose(out_fp) != 0) {
+      fprintf(stderr, "%s: %s\n", out_fn ? out_fn : "stdout",
+              strerror(errno));
+      exit(1);
+    }
+    fclose(in_fp);
+    return 0;
+  }
+  if (in_fp)
+    fclose(in_fp);
+
+  trace_t trace;
+  if (trace_open(&trace, in_fn) != 0) {
+    fprintf(stderr, "%s: %s\n", in_fn, strerror(errno));
+    exit(1);
+  }
+  FILE *out_fp = out_fn ? fopen(out_fn, "w") : stdout;
+  if (!out_fp) {
+    fprintf(stderr, "%s: %s\n", out_fn, strerror(errno));
+    exit(1);
+  }
+
+  trace_writer_t writer;
+  int to_binary = !trace.binary;
+  int failed = to_binary && trace_writer_open(&writer, out_fp) != 0;
+  int op, status = 0;
+  mem_addr_t addr;
+  unsigned int len;
+  while (!failed && (status = trace_next(&trace, &op, &addr, &len)) > 0) {
+    if (to_binary)
+      failed = trace_write(&writer, op, addr, len) != 0;
+    else if (op == TRACE_T)
+      failed = fprintf(out_fp, "T %llu\n", addr) < 0;
+    else if (op == TRACE_I)
+      failed = fprintf(out_fp, "I  %08llx,%u\n", addr, len) < 0;
+    else
+      failed = fprintf(out_fp, " %c %08llx,%u\n", "LSM"[op], addr, len) < 0;
+  }
+  if (!failed && status < 0) {
+    fprintf(stderr, "%s: truncated or unreadable trace\n", in_fn);
+    exit(1);
+  }
+  if (failed || fclose(out_fp) != 0) {
+    fprintf(stderr, "%s: %s\n", out_fn ? out_fn : "stdout", strerror(errno));
+    exit(1);
+  }
+  trace_close(&trace);
+  return 0;
+}
@@ -1,7 +1,12 @@
 ////////////////////////////////////////////////////////////////////////////////
 // Main File:        csim.c
 // This File:        csim.c
-// Other Files:      (name of all other files if any)
+// Other Files:      libcsim.c libcsim.h cache.c cache.h trace.c trace.h
+//                   sweep.c sweep.h parallel.c parallel.h ring.h hier.c
+//                   hier.h repl.c repl.h prefetch.c prefetch.h
+//                   classify.c classify.h sample.c sample.h event.c
+//                   event.h tlb.c tlb.h coherence.c coherence.h series.c
+//                   series.h
 // Semester:         CS 354 Fall 2018
 //
 // Author:           Yuanhang Wang
@@ -25,10 +30,29 @@
  *
  * csim.c - A cache simulator that can replay traces from Valgrind
  *     and output statistics such as number of hits, misses, and
- *     evictions.  The replacement policy is LRU.
+ *     evictions.  The replacement policy is LRU unless -p picks
+ *     another (see repl.c).  The simulator itself is a library, see
+ *     libcsim.c, and this file only turns the options into its
+ *     configuration and feeds it the trace.  Given ranges for s, E and
+ *     b it simulates every combination in one pass instead (see
+ *     sweep.c).  With -j the sets are split among worker threads (see
+ *     parallel.c).  With -H the cache is the L1 of a hierarchy (see
+ *     hier.c).  With -P prefetchers bring in blocks ahead of the misses
+ *     (see prefetch.c).  With -C misses are sorted into the three Cs and
+ *     attributed to regions and PCs (see classify.c).  With -k or -i
+ *     only a sample of the trace is simulated, and the counts are
+ *     estimates (see sample.c).  With -T the addresses are translated by
+ *     TLBs first, and with -X the page walks load their entries through
+ *     the cache (see tlb.c).  With -m every core has a cache of its own,
+ *     kept coherent with the others (see coherence.c), and each -t gives
+ *     the trace of one thread.  With -r the counts are also kept per
+ *     interval of the trace and the intervals grouped into phases (see
+ *     series.c).
  *
  * Implementation and assumptions:
  *  1. Each load/store can cause at most one cache miss plus a possible eviction.
+ *  With -S (or -V) it is instead split into every block its size covers,
+ *  each of which can miss.
  *  2. Instruction loads (I) are ignored.
  *  3. Data modify (M) is treated as a load followed by a store to the same
  *  address. Hence, an M operation can result in two cache hits, or a miss and a
@@ -49,6 +73,9 @@
 #include <string.h>
 #include <errno.h>
 #include <stdbool.h>
+#include "libcsim.h"
+#include "repl.h"
+#include "event.h"
 
 /****************************************************************************/
 /***** DO NOT MODIFY THESE VARIABLE NAMES ***********************************/
@@ -65,60 +92,54 @@ int B; /* block size (bytes) B = 2^b */
 int S; /* number of sets S = 2^s In C, you can use the left shift operator */
 
 /* Counters used to record cache statistics */
-int hit_cnt = 0;
-int miss_cnt = 0;
-int evict_cnt = 0;
+unsigned long long hit_cnt = 0;
+unsigned long long miss_cnt = 0;
+unsigned long long evict_cnt = 0;
 /*****************************************************************************/
 
 
-/* Type: Memory address 
- * Use this type whenever dealing with addresses or address masks
- */
-typedef unsigned long long int mem_addr_t;
-
-/* Type: Cache line
- * TODO 
- * 
- * NOTE: 
- * You might (not necessarily though) want to add an extra field to this struct
- * depending on your implementation
- * 
- * For example, to use a linked list based LRU,
- * you might want to have a field "struct cache_line * next" in the struct 
- */
-typedef struct cache_line {
-  char valid;
-  mem_addr_t tag;
-  int count;
-} cache_line_t;
+/* Options beyond the lab's, see libcsim.h */
+csim_config_t config;
+char *csv_file = NULL; /* every region and PC as CSV if set */
+char *series_file = NULL; /* intervals of the time series if set */
+char *event_file = NULL; /* event log if set, see event.h */
+int event_depth = EV_ACCESS; /* level of the events logged */
+
+/* The simulation, see libcsim.h */
+csim_t csim;
+
+/* Traces of the threads, trace_file being the first */
+char *trace_files[COH_CORES];
+int ntraces = 0;
+int coherent = 0; /* nonzero => a coherent cache per core */
+int ncores = 0; /* cores if set, else one per trace */
+int quantum = 1; /* data records a thread runs before the next one */
+unsigned long long interleave_seed = 0; /* nonzero => random turns */
 
-typedef cache_line_t *cache_set_t;
-typedef cache_set_t *cache_t;
+/* Records handed to the library at a time */
+#define REPLAY_BATCH 4096
 
-/* The cache we are simulating */
-cache_t cache;
+/* Records staged for the library */
+static mem_addr_t addrs[REPLAY_BATCH];
+static unsigned char ops[REPLAY_BATCH];
+static unsigned int lens[REPLAY_BATCH];
+static size_t staged = 0;
 
 /* TODO - COMPLETE THIS FUNCTION
  * init_cache - 
  * Allocate data structures to hold info regrading the sets and cache lines
- * use struct "cache_line_t" here
- * Initialize valid and tag field with 0s.
+ * Every line starts out invalid.
  * use S (= 2^s) and E while allocating the data structures here
  */
 void init_cache() {
-  // Initialize the cache with S sets
   S = 1 << s;
-  cache = malloc(sizeof(cache_set_t) * S);
-  for (int i = 0; i < S; i++) {
-    // For each cache initialize E lines
-    *(cache + i) = malloc(sizeof(cache_line_t) * E);
-
-    for (int j = 0; j < E; j++) {
-      // For each line initialize the v-bit and t-bit to zero
-      (*(cache + i) + j)->valid = '0';
-      (*(cache + i) + j)->tag = 0L;
-      (*(cache + i) + j)->count = 0;
-    }
+  B = 1 << b;
+  config.s = s;
+  config.E = E;
+  config.b = b;
+  if (csim_init(&csim, &config) != 0) {
+    fprintf(stderr, "%s\n", csim.error);
+    exit(1);
   }
 }
 
@@ -127,142 +148,228 @@ void init_cache() {
  * inside init_cache() function
  */
 void free_cache() {
-  for (int i = 0; i < S; i++) {
-    free(*(cache + i));
-    *(cache + i) = NULL;
-  }
-  free(cache);
-  cache = NULL;
+  csim_free(&csim);
 }
 
-/* TODO - COMPLETE THIS FUNCTION 
- * access_data - Access data at memory address addr.
- *   If it is already in cache, increase hit_cnt
- *   If it is not in cache, bring it in cache, increase miss count.
- *   Also increase evict_cnt if a line is evicted.
- *   you will manipulate data structures allocated in init_cache() here
+/*
+ * print_result - with -v, print the outcome 'result' of each access
  */
-void access_data(mem_addr_t addr) {
-  mem_addr_t t_bit;      // t-bit
-  mem_addr_t s_bit;      // s-bit
-
-  s_bit = (addr >> b) & (S - 1);
-  t_bit = (addr >> (b + s));
-
-  // Find the set: *(cache + s)
-  int emptyLine = 0;        // indicator for emptyline (cold miss)
-  int emptyLineIndex = 0;   // index of the emptyline
-  int min_count = (*(cache + s_bit))->count;  // minimum count
-  int min_count_index = 0;  // index of the line with minimun count
-  int max_count = 0;        // the max count of the lines
-
-  // look for highest count
-  for (int i = 0; i < E; i++) {
-    if ((*(cache + s_bit) + i)->count > max_count)
-      max_count = (*(cache + s_bit) + i)->count;
-  }
-  printf("s_bit: %llu \n", s_bit);
-  printf("t_bit: %llu \n", t_bit);
-  // Check tags for miss/hit
-  for (int i = 0; i < E; i++) {
-    // Means hit
-    if ((*(cache + s_bit) + i)->tag == t_bit &&
-        (*(cache + s_bit) + i)->valid != '0') {
-      printf("hit\n");
-      hit_cnt++;
-      (*(cache + s_bit) + i)->count = max_count + 1;
-      return;
-    }
-    // Look for emptyline
-    if ((*(cache + s_bit) + i)->valid == '0') {
-      emptyLine = 1;
-      emptyLineIndex = i;
-    }
-    // look for line with lowest count
-    if ((*(cache + s_bit) + i)->count < min_count) {
-      min_count_index = i;
-      min_count = (*(cache + s_bit) + i)->count;
-    }
+static void print_result(void *arg, mem_addr_t addr, int result) {
+  printf("%s ", result == CACHE_HIT ? "hit"
+                : result == CACHE_MISS ? "miss" : "miss eviction");
+}
+
+/*
+ * flush_batch - simulate the records staged
+ */
+static void flush_batch() {
+  if (csim_access_sized(&csim, addrs, ops, lens, staged) != 0) {
+    fprintf(stderr, "%s\n", csim.error);
+    exit(1);
   }
-  miss_cnt++;
-
-  // Cold miss.
-  if (emptyLine) {
-    (*(cache + s_bit) + emptyLineIndex)->valid = '1';
-    (*(cache + s_bit) + emptyLineIndex)->tag = t_bit;
-    (*(cache + s_bit) + emptyLineIndex)->count = max_count + 1;
-    // there is a conflict miss
-    // evict the line with least count (least recent used)
-  } else {
-    evict_cnt++;
-    (*(cache + s_bit) + min_count_index)->tag = t_bit;
-    (*(cache + s_bit) + min_count_index)->valid = '1';
-    (*(cache + s_bit) + min_count_index)->count = max_count + 1;
+  staged = 0;
+}
+
+/*
+ * stage - stage a record, simulating the records staged once there are
+ *   REPLAY_BATCH of them, or at every data record with -v so that each
+ *   line has the outcomes of its own accesses
+ */
+static void stage(int op, mem_addr_t addr, unsigned int len) {
+  addrs[staged] = addr;
+  ops[staged] = op;
+  lens[staged++] = len;
+  if (verbosity && op <= TRACE_M) {
+    printf("%c %llx,%u ", "LSM"[op], addr, len);
+    flush_batch();
+    printf("\n");
+  } else if (staged == REPLAY_BATCH) {
+    flush_batch();
   }
 }
 
 /* TODO - FILL IN THE MISSING CODE
  * replay_trace - replays the given trace file against the cache 
- * reads the input trace file line by line
+ * reads the input trace access by access, see trace.c; the file can be
+ * a Valgrind text trace or a binary one, and "-" reads stdin
  * extracts the type of each memory access : L/S/M
  * YOU MUST TRANSLATE one "L" as a load i.e. 1 memory access
  * YOU MUST TRANSLATE one "S" as a store i.e. 1 memory access
  * YOU MUST TRANSLATE one "M" as a load followed by a store i.e. 2 memory accesses 
+ * The records go to the library in batches, see stage().
+ * Instruction records are left out unless -C attributes misses to PCs.
+ * Between batches, records the sampling skips are not parsed at all.
  */
 void replay_trace(char *trace_fn) {
-  char buf[1000];
+  trace_t trace;
+  int op;
   mem_addr_t addr = 0;
   unsigned int len = 0;
-  FILE *trace_fp = fopen(trace_fn, "r");
+  size_t skip;
+  unsigned long long skipped;
+  int status;
 
-  if (!trace_fp) {
+  if (trace_open(&trace, trace_fn) != 0) {
     fprintf(stderr, "%s: %s\n", trace_fn, strerror(errno));
     exit(1);
   }
 
-  while (fgets(buf, 1000, trace_fp) != NULL) {
-    if (buf[1] == 'S' || buf[1] == 'L' || buf[1] == 'M') {
-      sscanf(buf + 3, "%llx,%u", &addr, &len);
+  while ((status = trace_next(&trace, &op, &addr, &len)) > 0) {
+    if (op == TRACE_I && !config.classify)
+      continue;
+    stage(op, addr, len);
+    // Records interval sampling has no use for are skipped unparsed
+    if (staged == 0 && (skip = csim_skippable(&csim)) > 0) {
+      skipped = 0;
+      skip = trace_skip(&trace, skip, &skipped);
+      csim_skip(&csim, skip, skipped);
+    }
+  }
+  flush_batch();
+  if (status < 0) {
+    fprintf(stderr, "%s: truncated or unreadable trace\n", trace_fn);
+    exit(1);
+  }
 
-      if (verbosity)
-        printf("%c %llx,%u ", buf[1], addr, len);
+  trace_close(&trace);
+}
 
-      // TODO - MISSING CODE
-      // now you have:
-      // 1. address accessed in variable - addr
-      // 2. type of access(S/L/M)  in variable - buf[1]
-      // call access_data function here depending on type of access
+/*
+ * replay_threads - replays the traces of 'n' threads, thread i being the
+ * i-th trace, interleaved: each thread in turn runs 'quantum' data
+ * records, the turns going round in order or, given a seed, to a random
+ * thread each time, the same for the same seed
+ * A thread whose trace ends drops out of the turns. Instructions and
+ * thread switches within the traces are left out.
+ */
+void replay_threads(char **trace_fns, int n) {
+  static trace_t traces[COH_CORES];
+  int done[COH_CORES] = {0};
+  int op, status, left = n, t = n - 1;
+  mem_addr_t addr;
+  unsigned int len;
+  unsigned long long rng = interleave_seed;
+
+  for (int i = 0; i < n; i++)
+    if (trace_open(&traces[i], trace_fns[i]) != 0) {
+      fprintf(stderr, "%s: %s\n", trace_fns[i], strerror(errno));
+      exit(1);
+    }
 
-      // access memory once for all operations
-      access_data(addr);
-      // if it is a modify operation, access twice
-      if (buf[1] == 'M') {
-        access_data(addr);
+  while (left > 0) {
+    // The next thread still running, in order or at random
+    int pick = 0;
+    if (interleave_seed) {
+      rng ^= rng << 13;
+      rng ^= rng >> 7;
+      rng ^= rng << 17;
+      pick = rng % left;
+    }
+    do
+      t = (t + 1) % n;
+    while (done[t] || pick-- > 0);
+
+    stage(TRACE_T, t, 0);
+    for (int run = 0; run < quantum; ) {
+      if ((status = trace_next(&traces[t], &op, &addr, &len)) <= 0) {
+        if (status < 0) {
+          fprintf(stderr, "%s: truncated or unreadable trace\n",
+                  trace_fns[t]);
+          exit(1);
+        }
+        trace_close(&traces[t]);
+        done[t] = 1;
+        left--;
+        break;
+      }
+      if (op <= TRACE_M) {
+        stage(op, addr, len);
+        run++;
       }
-
-      if (verbosity)
-        printf("\n");
     }
   }
-
-  fclose(trace_fp);
+  flush_batch();
 }
 
 /*
  * print_usage - Print usage info
  */
 void print_usage(char *argv[]) {
-  printf("Usage: %s [-hv] -s <num> -E <num> -b <num> -t <file>\n", argv[0]);
+  printf("Usage: %s [-hvL] [-p <pol>] -s <num> -E <num> -b <num> "
+         "-t <file>\n",
+         argv[0]);
   printf("Options:\n");
   printf("  -h         Print this help message.\n");
   printf("  -v         Optional verbose flag.\n");
+  printf("  -L         O(1) list LRU, faster for very large E.\n");
+  printf("  -p <pol>   Replacement policy: lru (default), plru, srrip,\n");
+  printf("             brrip, drrip, fifo, random or opt (Belady's).\n");
+  printf("  -j <num>   Worker threads, each simulating a range of sets.\n");
+  printf("  -H <list>  Levels below the L1, comma separated, each\n");
+  printf("             <s>:<E>:<b>:<latency>[:wt] (default write-back).\n");
+  printf("  -l <num>   L1 latency in cycles (default 4).\n");
+  printf("  -w         Write-through L1.\n");
+  printf("  -M <num>   Memory latency in cycles (default 200).\n");
+  printf("  -I <pol>   Inclusion: nine (default), inclusive or exclusive.\n");
+  printf("  -P <list>  Prefetchers, comma separated, each\n");
+  printf("             next|stride|stream[:<degree>[:<distance>]].\n");
+  printf("  -D <num>   Accesses a prefetch takes to arrive (default 20).\n");
+  printf("  -S         Split accesses into every block their size covers.\n");
+  printf("  -V <num>   Vector mode: -S with every access at least <num>\n");
+  printf("             bytes wide, a power of two up to 4096 (e.g. 32).\n");
+  printf("  -C         Classify misses (compulsory, capacity, conflict) and\n");
+  printf("             report the regions and PCs with the most.\n");
+  printf("  -n <num>   Regions and PCs reported by -C (default 10).\n");
+  printf("  -R <num>   Region bits for -C (default 12, 4 KiB pages).\n");
+  printf("  -c <file>  With -C, write every region and PC as CSV.\n");
+  printf("  -k <num>   Simulate 1 in <num> sets and estimate the rest.\n");
+  printf("  -i <spec>  Simulate <detail> of every <period> data records,\n");
+  printf("             after <warm> (default all the others) of warm-up:\n");
+  printf("             <period>:<detail>[:<warm>].\n");
+  printf("  -T <list>  L1 TLB, then optionally L2 TLB, comma separated,\n");
+  printf("             each <entries>:<ways> (e.g. 64:4,1536:12).\n");
+  printf("  -G <size>  Page size for -T: 4k (default), 2m or 1g.\n");
+  printf("  -W <num>   Page-walk cache entries per level (default 32).\n");
+  printf("  -X         Page walks load their entries through the cache.\n");
+  printf("  -m <prot>  Coherent caches, one per core: mesi or moesi.\n");
+  printf("  -N <num>   Cores for -m (default one per -t), thread t\n");
+  printf("             running on core t %% <num>.\n");
+  printf("  -d         Directory instead of snooping for -m.\n");
+  printf("  -q <spec>  Interleaving of the -t traces, <num> data records\n");
+  printf("             per turn (default 1), random turns given a seed:\n");
+  printf("             <num>[:<seed>].\n");
+  printf("  -r <spec>  Time series of every <num> accesses, grouped into\n");
+  printf("             phases, a new one past a signature distance <dist>\n");
+  printf("             (default 0.1): <num>[:<dist>].\n");
+  printf("  -o <file>  Write the intervals of -r to <file>, column by\n");
+  printf("             column (csim-conv prints it as CSV).\n");
+  printf("  -e <file>  Log events to <file> (builds with make EVENTS=1).\n");
+  printf("  -g <num>   Event level: 1 misses, 2 (default) and hits,\n");
+  printf("             3 and prefetches, writebacks, invalidations.\n");
   printf("  -s <num>   Number of set index bits.\n");
   printf("  -E <num>   Number of lines per set.\n");
   printf("  -b <num>   Number of block offset bits.\n");
-  printf("  -t <file>  Trace file.\n");
+  printf("             Any of the three can be a range <lo>-<hi>, which\n");
+  printf("             prints a table for every combination instead.\n");
+  printf("  -t <file>  Trace file, text or binary, - for stdin. With -m,\n");
+  printf("             one per thread, or one with T lines of threads.\n");
   printf("\nExamples:\n");
   printf("  linux>  %s -s 4 -E 1 -b 4 -t traces/yi.trace\n", argv[0]);
   printf("  linux>  %s -v -s 8 -E 2 -b 4 -t traces/yi.trace\n", argv[0]);
+  printf("  linux>  %s -s 0-10 -E 1-16 -b 4-6 -t traces/yi.trace\n",
+         argv[0]);
+  printf("  linux>  %s -s 6 -E 8 -b 6 -H 10:8:6:12,13:16:6:40 -I inclusive"
+         " -t traces/yi.trace\n", argv[0]);
+  printf("  linux>  %s -s 6 -E 8 -b 6 -P stride:2:4,stream:2:8"
+         " -t traces/yi.trace\n", argv[0]);
+  printf("  linux>  %s -s 12 -E 8 -b 6 -i 1000000:10000:100000"
+         " -t traces/long.bin\n", argv[0]);
+  printf("  linux>  %s -s 6 -E 8 -b 6 -T 64:4,1536:12 -X"
+         " -t traces/yi.trace\n", argv[0]);
+  printf("  linux>  %s -s 6 -E 8 -b 6 -m moesi -t t0.trace -t t1.trace\n",
+         argv[0]);
+  printf("  linux>  %s -s 12 -E 8 -b 6 -r 100000 -o long.ser"
+         " -t traces/long.bin\n", argv[0]);
   exit(0);
 }
 
@@ -270,42 +377,302 @@ void print_usage(char *argv[]) {
  * print_summary - Summarize the cache simulation statistics. Student cache simulators
  *                must call this function in order to be properly autograded.
  */
-void print_summary(int hits, int misses, int evictions) {
-  printf("hits:%d misses:%d evictions:%d\n", hits, misses, evictions);
+void print_summary(unsigned long long hits, unsigned long long misses,
+                   unsigned long long evictions) {
+  printf("hits:%llu misses:%llu evictions:%llu\n", hits, misses, evictions);
   FILE *output_fp = fopen(".csim_results", "w");
   assert(output_fp);
-  fprintf(output_fp, "%d %d %d\n", hits, misses, evictions);
+  fprintf(output_fp, "%llu %llu %llu\n", hits, misses, evictions);
   fclose(output_fp);
 }
 
+/*
+ * finish_events - write out the rest of the event log, if any
+ */
+void finish_events() {
+  if (event_file && event_close() != 0) {
+    fprintf(stderr, "%s: %s\n", event_file, strerror(errno));
+    exit(1);
+  }
+}
+
+/*
+ * parse_range - parse "<num>" or "<lo>-<hi>" into *lo and *hi
+ *   Returns 0 on success, -1 if 'arg' is neither
+ */
+static int parse_range(const char *arg, int *lo, int *hi) {
+  char *end;
+  *lo = *hi = strtol(arg, &end, 10);
+  if (end != arg && *end == '-')
+    *hi = strtol(arg = end + 1, &end, 10);
+  return end == arg || *end != '\0' ? -1 : 0;
+}
+
+/*
+ * parse_intervals - parse "<period>:<detail>[:<warm>]" into the interval
+ *   sampling of the configuration
+ *   Returns 0 on success, -1 if 'spec' is malformed
+ */
+static int parse_intervals(const char *spec) {
+  char *end;
+  config.sample_period = strtoull(spec, &end, 10);
+  if (*end != ':')
+    return -1;
+  config.sample_detail = strtoull(end + 1, &end, 10);
+  if (*end == ':')
+    config.sample_warm = strtoll(end + 1, &end, 10);
+  return *end != '\0' || config.sample_period == 0
+         || config.sample_detail == 0 || config.sample_warm < -1 ? -1 : 0;
+}
+
+/*
+ * parse_tlbs - parse "<entries>:<ways>[,<entries>:<ways>]" into the L1
+ *   and L2 TLBs of the configuration
+ *   Returns 0 on success, -1 if 'spec' is malformed
+ */
+static int parse_tlbs(const char *spec) {
+  int len = 0;
+  config.tlb_entries[1] = config.tlb_ways[1] = 0;
+  int n = sscanf(spec, "%d:%d%n,%d:%d%n", &config.tlb_entries[0],
+                 &config.tlb_ways[0], &len, &config.tlb_entries[1],
+                 &config.tlb_ways[1], &len);
+  return (n != 2 && n != 4) || spec[len] != '\0'
+         || config.tlb_entries[0] < 1 || config.tlb_entries[1] < 0 ? -1 : 0;
+}
+
+/*
+ * parse_quantum - parse "<num>[:<seed>]" into the interleaving
+ *   Returns 0 on success, -1 if 'spec' is malformed
+ */
+static int parse_quantum(const char *spec) {
+  char *end;
+  quantum = strtol(spec, &end, 10);
+  if (*end == ':')
+    interleave_seed = strtoull(end + 1, &end, 10);
+  return *end != '\0' || quantum < 1 ? -1 : 0;
+}
+
+/*
+ * parse_series - parse "<num>[:<dist>]" into the time series of the
+ *   configuration
+ *   Returns 0 on success, -1 if 'spec' is malformed
+ */
+static int parse_series(const char *spec) {
+  char *end;
+  config.series_length = strtoull(spec, &end, 10);
+  if (*end == ':')
+    config.phase_threshold = strtod(end + 1, &end);
+  return *end != '\0' || config.series_length == 0
+         || config.phase_threshold < 0 ? -1 : 0;
+}
+
 /*
  * main - Main routine 
  */
 int main(int argc, char *argv[]) {
   char c;
+  csim_stats_t stats;
 
+  csim_config_default(&config);
   // Parse the command line arguments: -h, -v, -s, -E, -b, -t
-  while ((c = getopt(argc, argv, "s:E:b:t:vh")) != -1) {
+  while ((c = getopt(argc, argv, "s:E:b:t:vhLj:H:l:wM:I:p:P:D:SV:Cn:R:c:e:g:k:i:T:G:W:Xm:N:dq:r:o:")) != -1) {
     switch (c) {
-      case 'b':b = atoi(optarg);
+      case 'b':if (parse_range(optarg, &b, &config.b_hi) != 0) {
+          print_usage(argv);
+          exit(1);
+        }
         break;
-      case 'E':E = atoi(optarg);
+      case 'E':if (parse_range(optarg, &E, &config.E_hi) != 0) {
+          print_usage(argv);
+          exit(1);
+        }
         break;
       case 'h':print_usage(argv);
         exit(0);
-      case 's':s = atoi(optarg);
+      case 's':if (parse_range(optarg, &s, &config.s_hi) != 0) {
+          print_usage(argv);
+          exit(1);
+        }
         break;
       case 't':trace_file = optarg;
+        if (ntraces == COH_CORES) {
+          printf("%s: at most %d traces\n", argv[0], COH_CORES);
+          exit(1);
+        }
+        trace_files[ntraces++] = optarg;
         break;
       case 'v':verbosity = 1;
         break;
+      case 'L':config.list_lru = 1;
+        break;
+      case 'j':config.nthreads = atoi(optarg);
+        break;
+      case 'H':config.levels = optarg;
+        break;
+      case 'l':config.l1_latency = atoi(optarg);
+        break;
+      case 'w':config.l1_write_through = 1;
+        break;
+      case 'M':config.mem_latency = atoi(optarg);
+        break;
+      case 'I':if (strcmp(optarg, "nine") == 0)
+          config.inclusion = HIER_NINE;
+        else if (strcmp(optarg, "inclusive") == 0)
+          config.inclusion = HIER_INCLUSIVE;
+        else if (strcmp(optarg, "exclusive") == 0)
+          config.inclusion = HIER_EXCLUSIVE;
+        else {
+          print_usage(argv);
+          exit(1);
+        }
+        break;
+      case 'k':config.sample_sets = atoi(optarg);
+        if (config.sample_sets < 1) {
+          print_usage(argv);
+          exit(1);
+        }
+        break;
+      case 'i':if (parse_intervals(optarg) != 0) {
+          print_usage(argv);
+          exit(1);
+        }
+        break;
+      case 'T':if (parse_tlbs(optarg) != 0) {
+          print_usage(argv);
+          exit(1);
+        }
+        break;
+      case 'G':if ((config.page_bits = tlb_page_bits(optarg)) < 0) {
+          print_usage(argv);
+          exit(1);
+        }
+        break;
+      case 'W':config.walk_entries = atoi(optarg);
+        break;
+      case 'X':config.inject_walks = 1;
+        break;
+      case 'm':if (strcmp(optarg, "mesi") == 0)
+          config.protocol = COH_MESI;
+        else if (strcmp(optarg, "moesi") == 0)
+          config.protocol = COH_MOESI;
+        else {
+          print_usage(argv);
+          exit(1);
+        }
+        coherent = 1;
+        break;
+      case 'N':ncores = atoi(optarg);
+        if (ncores < 1) {
+          print_usage(argv);
+          exit(1);
+        }
+        break;
+      case 'd':config.directory = 1;
+        break;
+      case 'q':if (parse_quantum(optarg) != 0) {
+          print_usage(argv);
+          exit(1);
+        }
+        break;
+      case 'r':if (parse_series(optarg) != 0) {
+          print_usage(argv);
+          exit(1);
+        }
+        break;
+      case 'o':series_file = optarg;
+        break;
+      case 'e':event_file = optarg;
+        break;
+      case 'g':event_depth = atoi(optarg);
+        break;
+      case 'C':config.classify = 1;
+        break;
+      case 'n':config.top = atoi(optarg);
+        break;
+      case 'R':config.region_bits = atoi(optarg);
+        if (config.region_bits < 0 || config.region_bits > 63) {
+          print_usage(argv);
+          exit(1);
+        }
+        break;
+      case 'c':csv_file = optarg;
+        config.classify = 1;
+        break;
+      case 'S':config.split = 1;
+        break;
+      case 'V':config.vector_bytes = atoi(optarg);
+        config.split = 1;
+        if (config.vector_bytes == 0 || config.vector_bytes > 4096
+            || (config.vector_bytes & (config.vector_bytes - 1)) != 0) {
+          print_usage(argv);
+          exit(1);
+        }
+        break;
+      case 'P':config.prefetchers = optarg;
+        break;
+      case 'D':config.prefetch_latency = atoi(optarg);
+        break;
+      case 'p':if ((config.repl = repl_parse(optarg)) < 0) {
+          print_usage(argv);
+          exit(1);
+        }
+        break;
       default:print_usage(argv);
         exit(1);
     }
   }
 
-  /* Make sure that all required command line args were specified */
-  if (s == 0 || E == 0 || b == 0 || trace_file == NULL) {
+  /* The library checks the combinations of options, except for those of
+   * the output: OPT only simulates once the whole trace is in, and the
+   * event log is not thread safe */
+  if (verbosity && config.repl == REPL_OPT) {
+    printf("%s: -v does not apply to -p opt\n", argv[0]);
+    exit(1);
+  }
+  if (verbosity)
+    config.observer = print_result;
+  if (event_file) {
+#ifdef CSIM_EVENTS
+    if (config.nthreads > 1 || event_depth < EV_MISS
+        || event_depth > EV_DETAIL) {
+      printf("%s: -e needs one thread and a level from 1 to 3\n",
+             argv[0]);
+      exit(1);
+    }
+    if (event_open(event_file, event_depth) != 0) {
+      fprintf(stderr, "%s: %s\n", event_file, strerror(errno));
+      exit(1);
+    }
+#else
+    printf("%s: built without events, rebuild with make EVENTS=1\n",
+           argv[0]);
+    exit(1);
+#endif
+  }
+
+  /* The series file holds the intervals of -r, which it defaults */
+  if (series_file && config.series_length == 0)
+    config.series_length = 100000;
+
+  /* Several traces are the threads of a coherent run, each on a core of
+   * its own unless -N says otherwise */
+  if (ntraces > 1 && !coherent) {
+    printf("%s: several traces need -m\n", argv[0]);
+    exit(1);
+  }
+  if (coherent) {
+    if (ncores == 0 && ntraces < 2) {
+      printf("%s: -m with a single trace needs -N\n", argv[0]);
+      exit(1);
+    }
+    config.cores = ncores ? ncores : ntraces;
+  }
+
+  /* Make sure that all required command line args were specified, a
+   * sweep may include s = 0, a fully associative cache */
+  int sweeping = s != config.s_hi || E != config.E_hi || b != config.b_hi;
+  if ((sweeping ? config.s_hi < 0 : s == 0) || E == 0 || b == 0
+      || trace_file == NULL) {
     printf("%s: Missing required command line argument\n", argv[0]);
     print_usage(argv);
     exit(1);
@@ -314,12 +681,44 @@ int main(int argc, char *argv[]) {
   /* Initialize cache */
   init_cache();
 
-  replay_trace(trace_file);
+  if (ntraces > 1)
+    replay_threads(trace_files, ntraces);
+  else
+    replay_trace(trace_file);
+  if (csim_finish(&csim) != 0) {
+    fprintf(stderr, "%s\n", csim.error);
+    exit(1);
+  }
+  csim_print(&csim, stdout);
+  if (csv_file) {
+    FILE *csv_fp = fopen(csv_file, "w");
+    if (!csv_fp) {
+      fprintf(stderr, "%s: %s\n", csv_file, strerror(errno));
+      exit(1);
+    }
+    classify_csv(&csim.classify, csv_fp);
+    fclose(csv_fp);
+  }
+  if (series_file) {
+    FILE *series_fp = fopen(series_file, "wb");
+    if (!series_fp || series_write(&csim.series, series_fp) != 0
+        || fclose(series_fp) != 0) {
+      fprintf(stderr, "%s: %s\n", series_file, strerror(errno));
+      exit(1);
+    }
+  }
+  csim_stats(&csim, &stats);
+  hit_cnt = stats.hits;
+  miss_cnt = stats.misses;
+  evict_cnt = stats.evictions;
+  int summary = csim.mode != CSIM_SWEEP;
 
   /* Free allocated memory */
   free_cache();
 
   /* Output the hit and miss statistics for the autograder */
-  print_summary(hit_cnt, miss_cnt, evict_cnt);
+  finish_events();
+  if (summary)
+    print_summary(hit_cnt, miss_cnt, evict_cnt);
   return 0;
 }
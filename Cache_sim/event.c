@@ -0,0 +1,93 @@
+////////////////////////////////////////////////////////////////////////////////
+// Main File:        csim.c
+// This File:        event.c
+// Other Files:      csim.c event.h
+// Semester:         CS 354 Fall 2018
+//
+// Author:           Yuanhang Wang
+// Email:            wang2243@wisc.edu
+// CS Login:         ywang
+//
+/////////////////////////// OTHER SOURCES OF HELP //////////////////////////////
+//                   fully acknowledge and credit all sources of help,
+//                   other than Instructors and TAs.
+//
+// Persons:          Identify persons by name, relationship to you, and email.
+//                   Describe in detail the the ideas and help they provided.
+//
+// Online sources:   avoid web searches to solve your problems, but if you do
+//                   search, be sure to include Web URLs and description of
+//                   of any information you find.
+//////////////////////////// 80 columns wide ///////////////////////////////////
+
+/*
+ * event.c - The event log (see event.h): one short line per event,
+ *     formatted by hand into a 64 KiB buffer that is written out whole.
+ */
+
+#include <stdio.h>
+#include "event.h"
+
+#define EVENT_BUF (1 << 16)
+#define EVENT_MAX 20  /* longest event: kind, space, 16 digits, newline */
+
+int event_level = 0;
+
+static FILE *event_fp = NULL;
+static char event_buf[EVENT_BUF];
+static size_t event_used = 0;
+static int event_failed = 0;  /* a write failed */
+
+static void flush(void) {
+  if (fwrite(event_buf, 1, event_used, event_fp) != event_used)
+    event_failed = 1;
+  event_used = 0;
+}
+
+/*
+ * event_open - log the events up to 'level' to the file at 'path'
+ *   Returns 0 on success, -1 if it cannot be created
+ */
+int event_open(const char *path, int level) {
+  event_fp = fopen(path, "w");
+  if (event_fp == NULL)
+    return -1;
+  event_level = level;
+  return 0;
+}
+
+/*
+ * event_emit - log event 'kind' at 'addr', use EVENT instead
+ */
+void event_emit(char kind, mem_addr_t addr) {
+  static const char digits[] = "0123456789abcdef";
+  char hex[16];
+  int n = 0;
+  if (event_used > EVENT_BUF - EVENT_MAX)
+    flush();
+  event_buf[event_used++] = kind;
+  event_buf[event_used++] = ' ';
+  do {
+    hex[n++] = digits[addr & 15];
+    addr >>= 4;
+  } while (addr != 0);
+  while (n > 0)
+    event_buf[event_used++] = hex[--n];
+  event_buf[event_used++] = '\n';
+}
+
+/*
+ * event_close - write out what is buffered and close the log
+ *   The log is closed even after a failed write.
+ *   Returns 0 on success, -1 if a write or the close failed
+ */
+int event_close(void) {
+  if (event_fp == NULL)
+    return 0;
+  flush();
+  int status = fclose(event_fp) != 0 || event_failed ? -1 : 0;
+  event_fp = NULL;
+  event_level = 0;
+  event_failed = 0;
+  return status;
+}
@@ -0,0 +1,54 @@
+////////////////////////////////////////////////////////////////////////////////
+// Main File:        csim.c
+// This File:        event.h
+// Other Files:      csim.c event.c
+// Semester:         CS 354 Fall 2018
+//
+// Author:           Yuanhang Wang
+// Email:            wang2243@wisc.edu
+// CS Login:         ywang
+//
+/////////////////////////// OTHER SOURCES OF HELP //////////////////////////////
+//                   fully acknowledge and credit all sources of help,
+//                   other than Instructors and TAs.
+//
+// Persons:          Identify persons by name, relationship to you, and email.
+//                   Describe in detail the the ideas and help they provided.
+//
+// Online sources:   avoid web searches to solve your problems, but if you do
+//                   search, be sure to include Web URLs and description of
+//                   of any information you find.
+//////////////////////////// 80 columns wide ///////////////////////////////////
+
+#ifndef __event_h__
+#define __event_h__
+
+#include "cache.h"
+
+/* Event levels, each logs everything the ones below it do */
+#define EV_MISS   1  /* misses (m) and misses that evicted (e) */
+#define EV_ACCESS 2  /* and hits (h) */
+#define EV_DETAIL 3  /* and prefetches (p), writebacks (w) and
+                        invalidations (i) */
+
+/* EVENT(level, kind, addr) logs "<kind> <addr in hex>\n" if the event log
+ * is at 'level' or above. Builds without CSIM_EVENTS (make EVENTS=1)
+ * compile every EVENT to nothing.
+ */
+#ifdef CSIM_EVENTS
+#define EVENT(level, kind, addr) \
+  do { \
+    if ((level) <= event_level) \
+      event_emit((kind), (addr)); \
+  } while (0)
+#else
+#define EVENT(level, kind, addr) ((void) 0)
+#endif
+
+extern int event_level;       /* 0 => no log */
+
+int event_open(const char *path, int level);
+void event_emit(char kind, mem_addr_t addr);
+int event_close(void);
+
+#endif // __event_h__
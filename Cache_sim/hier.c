@@ -0,0 +1,238 @@
+////////////////////////////////////////////////////////////////////////////////
+// Main File:        csim.c
+// This File:        hier.c
+// Other Files:      csim.c hier.h cache.c cache.h event.h
+// Semester:         CS 354 Fall 2018
+//
+// Author:           Yuanhang Wang
+// Email:            wang2243@wisc.edu
+// CS Login:         ywang
+//
+/////////////////////////// OTHER SOURCES OF HELP //////////////////////////////
+//                   fully acknowledge and credit all sources of help,
+//                   other than Instructors and TAs.
+//
+// Persons:          Identify persons by name, relationship to you, and email.
+//                   Describe in detail the the ideas and help they provided.
+//
+// Online sources:   avoid web searches to solve your problems, but if you do
+//                   search, be sure to include Web URLs and description of
+//                   of any information you find.
+//////////////////////////// 80 columns wide ///////////////////////////////////
+
+/*
+ * hier.c - A multi-level cache hierarchy (see hier.h).
+ *
+ * A load or store looks up the L1. On a miss the block is fetched from the
+ * first level below that has it, or from memory, and on the way back:
+ *   NINE:      every level that missed gets a copy
+ *   inclusive: likewise, and a level that evicts a block also drops it
+ *              from every level above, so those always stay subsets
+ *   exclusive: only the L1 gets the block, a lower level that had it gives
+ *              it up, and every victim moves one level down
+ * Stores allocate in the L1. A write-back level marks the line dirty and
+ * writes it to the level below when it is evicted. A write-through level
+ * sends every store down at once and never holds dirty lines. A write
+ * that reaches a level that does not have the block goes further down
+ * without allocating.
+ *
+ * Levels may have larger blocks than the levels above them, except in an
+ * exclusive hierarchy where the moves between levels need equal blocks.
+ */
+
+#include <string.h>
+#include "hier.h"
+#include "event.h"
+
+/*
+ * hier_init - set up an empty hierarchy, levels are added with
+ *   hier_add_level starting with the L1
+ */
+void hier_init(hier_t *hier, int policy, int mem_latency) {
+  memset(hier, 0, sizeof(hier_t));
+  hier->policy = policy;
+  hier->mem_latency = mem_latency;
+}
+
+/*
+ * hier_add_level - add a level with 2^s sets of E lines of 2^b bytes below
+ *   the existing ones
+ *   Returns 0 on success, -1 if there are too many levels, the block size
+ *   does not fit the policy or the cache cannot be set up
+ */
+int hier_add_level(hier_t *hier, int s, int E, int b, int latency,
+                   int write_through, int list_lru) {
+  if (hier->nlevels == HIER_LEVELS)
+    return -1;
+  if (hier->nlevels > 0) {
+    int b_above = hier->levels[hier->nlevels - 1].cache.b;
+    if (b < b_above || (hier->policy == HIER_EXCLUSIVE && b != b_above))
+      return -1;
+  }
+  level_t *level = &hier->levels[hier->nlevels];
+  memset(level, 0, sizeof(level_t));
+  if (cache_init(&level->cache, s, E, b, list_lru) != 0)
+    return -1;
+  level->latency = latency;
+  level->write_through = write_through;
+  hier->nlevels++;
+  return 0;
+}
+
+/*
+ * write_down - level 'from' sends a write of the block at 'addr' down
+ *   The first write-back level below that has the block takes it,
+ *   otherwise it goes on to memory
+ */
+static void write_down(hier_t *hier, int from, mem_addr_t addr) {
+  for (int i = from; ; i++) {
+    hier->levels[i].writebacks++;
+    EVENT(EV_DETAIL, 'w', addr);
+    if (i + 1 == hier->nlevels) {
+      hier->mem_writes++;
+      return;
+    }
+    level_t *below = &hier->levels[i + 1];
+    if (!below->write_through && cache_mark_dirty(&below->cache, addr))
+      return;
+  }
+}
+
+/*
+ * drop_block - drop the 2^b-byte block at 'addr' from level 'i', which
+ *   may hold it as several smaller blocks
+ *   Returns 1 if any of them was dirty, 0 otherwise
+ */
+static int drop_block(hier_t *hier, int i, mem_addr_t addr, int b) {
+  level_t *level = &hier->levels[i];
+  int dirty = 0;
+  mem_addr_t step = (mem_addr_t) 1 << level->cache.b;
+  for (mem_addr_t a = addr; a < addr + ((mem_addr_t) 1 << b); a += step) {
+    int was = cache_invalidate(&level->cache, a);
+    if (was >= 0) {
+      level->invalidations++;
+      EVENT(EV_DETAIL, 'i', a);
+      dirty |= was;
+    }
+  }
+  return dirty;
+}
+
+/*
+ * install - bring the block at 'addr' into level 'i' and deal with the
+ *   block it evicts
+ *   Returns CACHE_MISS or CACHE_EVICT
+ */
+static int install(hier_t *hier, int i, mem_addr_t addr, int dirty) {
+  level_t *level = &hier->levels[i];
+  mem_addr_t victim;
+  int victim_dirty;
+  int result = cache_insert(&level->cache, addr,
+                            dirty && !level->write_through, &victim,
+                            &victim_dirty);
+  if (dirty && level->write_through)
+    write_down(hier, i, addr);  // Exclusive: a dirty block moved up
+  if (result != CACHE_EVICT)
+    return result;
+
+  level->evictions++;
+  if (hier->policy == HIER_INCLUSIVE)
+    for (int j = 0; j < i; j++)
+      victim_dirty |= drop_block(hier, j, victim, level->cache.b);
+  if (hier->policy == HIER_EXCLUSIVE && i + 1 < hier->nlevels)
+    install(hier, i + 1, victim, victim_dirty);
+  else if (victim_dirty)
+    write_down(hier, i, victim);
+  return result;
+}
+
+/*
+ * fetch - read the block at 'addr' from level 'i' or below for the level
+ *   above
+ *   Returns 1 if an exclusive level handed over a dirty block, else 0
+ */
+static int fetch(hier_t *hier, int i, mem_addr_t addr) {
+  if (i == hier->nlevels) {
+    hier->mem_reads++;
+    return 0;
+  }
+  level_t *level = &hier->levels[i];
+  if (hier->policy == HIER_EXCLUSIVE) {
+    int dirty = cache_invalidate(&level->cache, addr);
+    if (dirty >= 0) {
+      level->hits++;
+      return dirty;
+    }
+    level->misses++;
+    return fetch(hier, i + 1, addr);
+  }
+  if (cache_lookup(&level->cache, addr, 0)) {
+    level->hits++;
+    return 0;
+  }
+  level->misses++;
+  fetch(hier, i + 1, addr);
+  install(hier, i, addr, 0);
+  return 0;
+}
+
+/*
+ * hier_access - load ('write' clear) or store ('write' set) at 'addr'
+ *   Returns the outcome in the L1: CACHE_HIT, CACHE_MISS or CACHE_EVICT
+ */
+int hier_access(hier_t *hier, mem_addr_t addr, int write) {
+  level_t *l1 = &hier->levels[0];
+  int dirty = write && !l1->write_through;
+  int result = CACHE_HIT;
+  if (cache_lookup(&l1->cache, addr, dirty)) {
+    l1->hits++;
+  } else {
+    l1->misses++;
+    dirty |= fetch(hier, 1, addr);
+    result = install(hier, 0, addr, dirty);
+  }
+  if (write && l1->write_through)
+    write_down(hier, 0, addr);
+  return result;
+}
+
+/*
+ * hier_print - print the counts of every level and the average memory
+ *   access time
+ *   Every lookup costs the latency of its level and every memory read the
+ *   memory latency; writes are assumed to be buffered and cost nothing
+ */
+void hier_print(const hier_t *hier, FILE *fp) {
+  static const char *policies[] = {"nine", "inclusive", "exclusive"};
+  double cycles = (double) hier->mem_reads * hier->mem_latency;
+
+  fprintf(fp, "%-5s %3s %5s %3s %4s %2s %12s %12s %12s %12s %12s %8s\n",
+          "level", "s", "E", "b", "lat", "wp", "hits", "misses",
+          "evictions", "writebacks", "invals", "miss%");
+  for (int i = 0; i < hier->nlevels; i++) {
+    const level_t *level = &hier->levels[i];
+    unsigned long long lookups = level->hits + level->misses;
+    cycles += (double) lookups * level->latency;
+    fprintf(fp, "L%-4d %3d %5d %3d %4d %2s %12llu %12llu %12llu %12llu "
+            "%12llu %8.3f\n", i + 1, level->cache.s, level->cache.E,
+            level->cache.b, level->latency,
+            level->write_through ? "wt" : "wb", level->hits, level->misses,
+            level->evictions, level->writebacks, level->invalidations,
+            lookups ? 100.0 * level->misses / lookups : 0.0);
+  }
+  unsigned long long accesses = hier->levels[0].hits
+                                + hier->levels[0].misses;
+  fprintf(fp, "memory reads:%llu writes:%llu (%s, %d cycles)\n",
+          hier->mem_reads, hier->mem_writes, policies[hier->policy],
+          hier->mem_latency);
+  fprintf(fp, "AMAT: %.2f cycles\n", accesses ? cycles / accesses : 0.0);
+}
+
+/*
+ * hier_free - free the caches of every level
+ */
+void hier_free(hier_t *hier) {
+  for (int i = 0; i < hier->nlevels; i++)
+    cache_free(&hier->levels[i].cache);
+  hier->nlevels = 0;
+}
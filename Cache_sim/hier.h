@@ -0,0 +1,65 @@
+////////////////////////////////////////////////////////////////////////////////
+// Main File:        csim.c
+// This File:        hier.h
+// Other Files:      csim.c hier.c cache.c cache.h
+// Semester:         CS 354 Fall 2018
+//
+// Author:           Yuanhang Wang
+// Email:            wang2243@wisc.edu
+// CS Login:         ywang
+//
+/////////////////////////// OTHER SOURCES OF HELP //////////////////////////////
+//                   fully acknowledge and credit all sources of help,
+//                   other than Instructors and TAs.
+//
+// Persons:          Identify persons by name, relationship to you, and email.
+//                   Describe in detail the the ideas and help they provided.
+//
+// Online sources:   avoid web searches to solve your problems, but if you do
+//                   search, be sure to include Web URLs and description of
+//                   of any information you find.
+//////////////////////////// 80 columns wide ///////////////////////////////////
+
+#ifndef __hier_h__
+#define __hier_h__
+
+#include <stdio.h>
+#include "cache.h"
+
+#define HIER_LEVELS 4   /* L1 and up to three levels below it */
+
+/* Inclusion policies */
+#define HIER_NINE      0  /* neither inclusive nor exclusive */
+#define HIER_INCLUSIVE 1  /* lower levels hold everything above them */
+#define HIER_EXCLUSIVE 2  /* a block is in at most one level */
+
+/* Type: One level of the hierarchy */
+typedef struct level {
+  cache_t cache;
+  int latency;                      /* cycles per lookup */
+  int write_through;                /* nonzero => no dirty lines */
+  unsigned long long hits;          /* lookups that found the block */
+  unsigned long long misses;
+  unsigned long long evictions;     /* valid lines replaced */
+  unsigned long long writebacks;    /* writes sent to the level below */
+  unsigned long long invalidations; /* lines dropped to keep inclusion */
+} level_t;
+
+/* Type: Cache hierarchy, level 0 is the L1 */
+typedef struct hier {
+  int nlevels;
+  int policy;                       /* one of HIER_* */
+  int mem_latency;                  /* cycles per memory read */
+  level_t levels[HIER_LEVELS];
+  unsigned long long mem_reads;
+  unsigned long long mem_writes;
+} hier_t;
+
+void hier_init(hier_t *hier, int policy, int mem_latency);
+int hier_add_level(hier_t *hier, int s, int E, int b, int latency,
+                   int write_through, int list_lru);
+int hier_access(hier_t *hier, mem_addr_t addr, int write);
+void hier_print(const hier_t *hier, FILE *fp);
+void hier_free(hier_t *hier);
+
+#endif // __hier_h__
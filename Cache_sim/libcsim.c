@@ -0,0 +1,883 @@
+////////////////////////////////////////////////////////////////////////////////
+// Main File:        csim.c
+// This File:        libcsim.c
+// Other Files:      csim.c libcsim.h cache.c cache.h sweep.c sweep.h
+//                   parallel.c parallel.h hier.c hier.h prefetch.c
+//                   prefetch.h classify.c classify.h sample.c sample.h
+//                   tlb.c tlb.h coherence.c coherence.h series.c series.h
+// Semester:         CS 354 Fall 2018
+//
+// Author:           Yuanhang Wang
+// Email:            wang2243@wisc.edu
+// CS Login:         ywang
+//
+/////////////////////////// OTHER SOURCES OF HELP //////////////////////////////
+//                   fully acknowledge and credit all sources of help,
+//                   other than Instructors and TAs.
+//
+// Persons:          Identify persons by name, relationship to you, and email.
+//                   Describe in detail the the ideas and help they provided.
+//
+// Online sources:   avoid web searches to solve your problems, but if you do
+//                   search, be sure to include Web URLs and description of
+//                   of any information you find.
+//////////////////////////// 80 columns wide ///////////////////////////////////
+
+/*
+ * libcsim.c - The simulator as a library, libcsim.a, for feeding it
+ *     accesses straight from a program instead of through a trace.
+ *
+ * A csim_t holds everything one simulation needs, so a program can run
+ * several side by side. Accesses go in in batches:
+ *
+ *     csim_config_t config;
+ *     csim_t csim;
+ *     csim_config_default(&config);
+ *     config.s = 6, config.E = 8, config.b = 6;
+ *     if (csim_init(&csim, &config) != 0)
+ *       fprintf(stderr, "%s\n", csim.error);
+ *     csim_access_batch(&csim, addrs, ops, n);   // ops[i] is a TRACE_*
+ *     ...
+ *     csim_finish(&csim);
+ *     csim_stats(&csim, &stats);
+ *     csim_free(&csim);
+ *
+ * The only state shared between instances is the event log of
+ * event.c, a debugging aid of builds with EVENTS=1.
+ */
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libcsim.h"
+#include "repl.h"
+#include "event.h"
+
+/*
+ * csim_config_default - set 'config' to csim's defaults, with no geometry
+ */
+void csim_config_default(csim_config_t *config) {
+  memset(config, 0, sizeof(csim_config_t));
+  config->s_hi = config->E_hi = config->b_hi = -1;
+  config->repl = REPL_LRU;
+  config->nthreads = 1;
+  config->l1_latency = 4;
+  config->mem_latency = 200;
+  config->inclusion = HIER_NINE;
+  config->prefetch_latency = 20;
+  config->region_bits = 12;
+  config->top = 10;
+  config->sample_warm = -1;
+  config->page_bits = 12;
+  config->walk_entries = 32;
+  config->phase_threshold = 0.1;
+}
+
+/*
+ * fail - record why the current call failed
+ *   Returns -1, for the caller to return
+ */
+static int fail(csim_t *csim, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  vsnprintf(csim->error, sizeof(csim->error), format, args);
+  va_end(args);
+  return -1;
+}
+
+/*
+ * check_config - reject combinations the simulator does not support
+ *   Returns 0 if 'config' is supported, -1 otherwise
+ */
+static int check_config(csim_t *csim, const csim_config_t *config,
+                        int sweeping) {
+  /* list LRU is an implementation of LRU, and threads split the sets,
+   * which needs a policy that keeps all its state per set */
+  if (config->repl < 0 || config->repl >= REPL_COUNT)
+    return fail(csim, "unknown replacement policy %d", config->repl);
+  if (config->list_lru && config->repl != REPL_LRU)
+    return fail(csim, "list LRU is LRU only");
+  if (config->nthreads > 1 && !repl_ops[config->repl].per_set)
+    return fail(csim, "threads need a policy without shared state (lru, "
+                "plru, srrip or fifo)");
+  if (config->levels && config->repl == REPL_OPT)
+    return fail(csim, "OPT does not apply to a hierarchy");
+  if (config->levels && config->nthreads > 1)
+    return fail(csim, "threads do not apply to a hierarchy");
+  if (config->cores > COH_CORES)
+    return fail(csim, "at most %d cores", COH_CORES);
+  if (config->cores > 0
+      && (config->levels || config->prefetchers || config->classify
+          || config->repl == REPL_OPT || config->list_lru
+          || config->sample_sets > 0 || config->sample_period > 0
+          || config->tlb_entries[0] > 0 || sweeping))
+    return fail(csim, "coherence does not apply to a hierarchy, ranges, "
+                "prefetchers, classification, OPT, list LRU, sampling or "
+                "TLBs");
+  if (config->prefetchers && (config->nthreads > 1 || config->levels
+                              || config->repl == REPL_OPT))
+    return fail(csim, "prefetchers do not apply to threads, a hierarchy "
+                "or OPT");
+  if (config->classify && (config->nthreads > 1 || config->levels
+                           || config->repl == REPL_OPT
+                           || config->prefetchers))
+    return fail(csim, "classification does not apply to threads, a "
+                "hierarchy, prefetchers or OPT");
+  if (config->region_bits < 0 || config->region_bits > 63)
+    return fail(csim, "region bits must be from 0 to 63");
+  if (config->vector_bytes > 4096
+      || (config->vector_bytes & (config->vector_bytes - 1)) != 0)
+    return fail(csim, "vector size must be a power of two up to 4096");
+  if ((config->sample_sets > 0 || config->sample_period > 0)
+      && (config->nthreads > 1 || config->levels || config->prefetchers
+          || config->classify || config->repl == REPL_OPT || config->split
+          || sweeping))
+    return fail(csim, "sampling applies to a single cache, not to threads, "
+                "a hierarchy, ranges, prefetchers, classification, OPT "
+                "or splits");
+  if (config->sample_sets > 0 && config->sample_period > 0)
+    return fail(csim, "sampling is either of sets or of intervals");
+  if (config->sample_period > 0
+      && (config->sample_detail == 0
+          || config->sample_detail > config->sample_period
+          || (config->sample_warm >= 0
+              && (unsigned long long) config->sample_warm
+                 > config->sample_period - config->sample_detail)))
+    return fail(csim, "sampling intervals must be shorter than their "
+                "period, with the warm-up");
+  if (config->tlb_entries[0] > 0
+      && (config->sample_sets > 0 || config->sample_period > 0))
+    return fail(csim, "TLBs do not apply to sampling");
+  if (config->series_length > 0
+      && (config->nthreads > 1 || config->sample_sets > 0
+          || config->sample_period > 0 || sweeping))
+    return fail(csim, "time series need the accesses simulated in order, "
+                "not by threads, sampled or over ranges");
+  if (sweeping && (config->nthreads > 1 || config->levels
+                   || config->repl != REPL_LRU || config->prefetchers
+                   || config->split || config->classify))
+    return fail(csim, "threads, a hierarchy, other policies, prefetchers, "
+                "splits and classification do not apply to ranges");
+  return 0;
+}
+
+/*
+ * add_levels - add the L1 and the levels of 'spec' to the hierarchy
+ *   Returns 0 on success, -1 if 'spec' is malformed or a level is invalid
+ */
+static int add_levels(csim_t *csim, const char *spec) {
+  const csim_config_t *config = &csim->config;
+  hier_t *hier = &csim->hier;
+
+  hier_init(hier, config->inclusion, config->mem_latency);
+  if (hier_add_level(hier, config->s, config->E, config->b,
+                     config->l1_latency, config->l1_write_through,
+                     config->list_lru) != 0
+      || cache_set_repl(&hier->levels[0].cache, config->repl) != 0)
+    return -1;
+  while (*spec != '\0') {
+    int ls, lE, lb, latency, len = 0;
+    if (sscanf(spec, "%d:%d:%d:%d%n", &ls, &lE, &lb, &latency, &len) != 4)
+      return -1;
+    spec += len;
+    int write_through = strncmp(spec, ":wt", 3) == 0;
+    if (write_through)
+      spec += 3;
+    if (*spec == ',')
+      spec++;
+    else if (*spec != '\0')
+      return -1;
+    if (hier_add_level(hier, ls, lE, lb, latency, write_through, 0) != 0
+        || cache_set_repl(&hier->levels[hier->nlevels - 1].cache,
+                          config->repl) != 0)
+      return -1;
+  }
+  return 0;
+}
+
+/*
+ * add_prefetchers - add the prefetchers of 'spec' to the cache, degree
+ *   and distance defaulting to 1
+ *   Returns 0 on success, -1 if 'spec' is malformed or has too many
+ */
+static int add_prefetchers(csim_t *csim, const char *spec) {
+  char *copy = strdup(spec);
+  int status = copy ? 0 : -1;
+  for (char *item = strtok(copy, ","); item && status == 0;
+       item = strtok(NULL, ",")) {
+    int degree = 1, distance = 1;
+    char *args = strchr(item, ':');
+    if (args) {
+      char *end;
+      *args++ = '\0';
+      degree = strtol(args, &end, 10);
+      if (*end == ':')
+        distance = strtol(end + 1, &end, 10);
+      if (*end != '\0')
+        status = -1;
+    }
+    if (status == 0)
+      status = prefetch_add(&csim->prefetch, prefetch_parse(item), degree,
+                            distance);
+  }
+  free(copy);
+  return status;
+}
+
+/*
+ * init_cache - allocate the cache of the single cache modes
+ *   Returns 0 on success, -1 on failure
+ */
+static int init_cache(csim_t *csim) {
+  const csim_config_t *config = &csim->config;
+  if (cache_init(&csim->cache, config->s, config->E, config->b,
+                 config->list_lru) != 0)
+    return fail(csim, "Unable to allocate a cache with s=%d E=%d b=%d",
+                config->s, config->E, config->b);
+  if (cache_set_repl(&csim->cache, config->repl) != 0) {
+    cache_free(&csim->cache);
+    return fail(csim, "Unable to set up the %s policy",
+                repl_ops[config->repl].name);
+  }
+  return 0;
+}
+
+/*
+ * init_mode - pick the mode of 'csim' and set it up
+ *   Returns 0 on success, -1 with the reason in csim->error on failure
+ */
+static int init_mode(csim_t *csim, int sweeping) {
+  const csim_config_t *config = &csim->config;
+  if (sweeping) {
+    csim->mode = CSIM_SWEEP;
+    if (sweep_init(&csim->sweep, config->s, config->s_hi, config->E,
+                   config->E_hi, config->b, config->b_hi) != 0)
+      return fail(csim, "Invalid ranges or not enough memory for the "
+                  "sweep");
+    return 0;
+  }
+
+  if (config->cores > 0) {
+    csim->mode = CSIM_COHERENT;
+    if (coherence_init(&csim->coherence, config->cores, config->s,
+                       config->E, config->b, config->repl, config->protocol,
+                       config->directory, config->nthreads) != 0)
+      return fail(csim, "Unable to set up %d cores with s=%d E=%d b=%d "
+                  "and %d threads", config->cores, config->s, config->E,
+                  config->b, config->nthreads);
+    return 0;
+  }
+
+  if (config->levels) {
+    csim->mode = CSIM_HIER;
+    if (add_levels(csim, config->levels) != 0) {
+      hier_free(&csim->hier);
+      return fail(csim, "Invalid hierarchy: %s (block sizes may not "
+                  "shrink going down, nor differ if exclusive)",
+                  config->levels);
+    }
+    return 0;
+  }
+
+  if (init_cache(csim) != 0)
+    return -1;
+  if (config->nthreads > 1) {
+    csim->mode = CSIM_ENGINE;
+    if (engine_start(&csim->engine, &csim->cache, config->nthreads) != 0) {
+      cache_free(&csim->cache);
+      return fail(csim, "Unable to start %d worker threads",
+                  config->nthreads);
+    }
+  } else if (config->prefetchers) {
+    csim->mode = CSIM_PREFETCH;
+    if (prefetch_init(&csim->prefetch, &csim->cache,
+                      config->prefetch_latency) != 0) {
+      cache_free(&csim->cache);
+      return fail(csim, "Not enough memory for the prefetchers");
+    }
+    if (add_prefetchers(csim, config->prefetchers) != 0) {
+      prefetch_free(&csim->prefetch);
+      cache_free(&csim->cache);
+      return fail(csim, "Invalid prefetchers: %s (at most %d)",
+                  config->prefetchers, PF_MAX);
+    }
+  } else if (config->sample_sets > 0) {
+    csim->mode = CSIM_SETS;
+    if (sample_init_sets(&csim->sample, config->s, config->b,
+                         config->sample_sets) != 0) {
+      cache_free(&csim->cache);
+      return fail(csim, "Not enough memory to sample sets");
+    }
+  } else if (config->sample_period > 0) {
+    csim->mode = CSIM_INTERVALS;
+    unsigned long long gap = config->sample_period - config->sample_detail;
+    sample_init_intervals(&csim->sample, config->sample_period,
+                          config->sample_detail, config->sample_warm < 0
+                          ? gap : (unsigned long long) config->sample_warm);
+  } else if (config->classify) {
+    csim->mode = CSIM_CLASSIFY;
+    if (classify_init(&csim->classify, config->s, config->E, config->b,
+                      config->region_bits) != 0) {
+      cache_free(&csim->cache);
+      return fail(csim, "Not enough memory to classify misses");
+    }
+  } else {
+    csim->mode = config->repl == REPL_OPT ? CSIM_OPT : CSIM_CACHE;
+  }
+  return 0;
+}
+
+/*
+ * csim_init - set up 'csim' to simulate 'config'
+ *   Returns 0 on success, -1 with the reason in csim->error on failure
+ */
+int csim_init(csim_t *csim, const csim_config_t *config) {
+  memset(csim, 0, sizeof(csim_t));
+  csim->config = *config;
+  csim->last_pc = TAG_INVALID;
+  if (config->s_hi < 0)
+    csim->config.s_hi = config->s;
+  if (config->E_hi < 0)
+    csim->config.E_hi = config->E;
+  if (config->b_hi < 0)
+    csim->config.b_hi = config->b;
+  config = &csim->config;
+
+  int sweeping = config->s != config->s_hi || config->E != config->E_hi
+                 || config->b != config->b_hi;
+  if (check_config(csim, config, sweeping) != 0)
+    return -1;
+  if (config->tlb_entries[0] > 0
+      && tlb_init(&csim->tlb, config->tlb_entries, config->tlb_ways,
+                  config->page_bits, config->walk_entries) != 0)
+    return fail(csim, "Invalid TLBs (entries must be the ways times a "
+                "power of two) or page size");
+  if (init_mode(csim, sweeping) != 0) {
+    tlb_free(&csim->tlb);
+    return -1;
+  }
+  if (config->series_length > 0)
+    series_init(&csim->series, config->series_length,
+                config->phase_threshold, config->b);
+  return 0;
+}
+
+/*
+ * close_interval - end the interval of the time series, 'counts' being
+ *   counted on top of csim->counts
+ */
+static void close_interval(csim_t *csim, const unsigned long long *counts) {
+  unsigned long long totals[3];
+  for (int k = 0; k < 3; k++)
+    totals[k] = csim->counts[k] + counts[k];
+  series_close(&csim->series, totals);
+}
+
+/*
+ * tally - count the outcome 'result' of an access to 'addr', log it, add
+ *   it to the time series and tell the observer
+ */
+static inline void tally(csim_t *csim, unsigned long long *counts,
+                         int result, mem_addr_t addr) {
+  counts[result]++;
+  switch (result) {
+    case CACHE_HIT:
+      EVENT(EV_ACCESS, 'h', addr);
+      break;
+    case CACHE_EVICT:
+      EVENT(EV_MISS, 'e', addr);
+      break;
+    default:
+      EVENT(EV_MISS, 'm', addr);
+  }
+  if (csim->series.length && series_note(&csim->series, addr))
+    close_interval(csim, counts);
+  if (csim->config.observer)
+    csim->config.observer(csim->config.observer_arg, addr, result);
+}
+
+/*
+ * record_access - buffer an access until all are known, which OPT needs
+ *   to tell when each block is used next
+ *   Returns 0 on success, -1 if out of memory
+ */
+static int record_access(csim_t *csim, mem_addr_t addr) {
+  if (csim->opt_count == csim->opt_size) {
+    size_t size = csim->opt_size ? 2 * csim->opt_size : 1 << 16;
+    mem_addr_t *addrs = realloc(csim->opt_addrs, size * sizeof(mem_addr_t));
+    if (addrs == NULL)
+      return fail(csim, "Not enough memory to buffer the accesses for OPT");
+    csim->opt_addrs = addrs;
+    csim->opt_size = size;
+  }
+  csim->opt_addrs[csim->opt_count++] = addr;
+  return 0;
+}
+
+/* Forced inline, so that each mode gets a batch loop of its own */
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+
+/*
+ * simulate - run one access of 'len' bytes through 'mode', the mode of
+ *   'csim', 'write' is set for stores
+ *   Returns 0 on success, -1 on failure
+ */
+static ALWAYS_INLINE int simulate(csim_t *csim, int mode,
+                                  unsigned long long *counts,
+                                  mem_addr_t addr, unsigned int len,
+                                  int write) {
+  int result, core;
+  switch (mode) {
+    case CSIM_SWEEP:
+      sweep_access(&csim->sweep, addr);
+      return 0;
+    case CSIM_ENGINE:
+      engine_access(&csim->engine, addr);
+      return 0;
+    case CSIM_HIER:
+      tally(csim, counts, hier_access(&csim->hier, addr, write), addr);
+      return 0;
+    case CSIM_PREFETCH:
+      tally(csim, counts, prefetch_access(&csim->prefetch, addr), addr);
+      return 0;
+    case CSIM_CLASSIFY:
+      result = cache_access(&csim->cache, addr);
+      tally(csim, counts, result, addr);
+      if (classify_access(&csim->classify, addr, csim->last_pc,
+                          result) != 0)
+        return fail(csim, "Not enough memory to classify misses");
+      return 0;
+    case CSIM_OPT:
+      return record_access(csim, addr);
+    case CSIM_COHERENT:
+      core = csim->thread % csim->config.cores;
+      if (csim->coherence.threaded)
+        coherence_submit(&csim->coherence, core, addr, len, write);
+      else
+        tally(csim, counts, coherence_access(&csim->coherence, core, addr,
+                                             len, write), addr);
+      return 0;
+    case CSIM_SETS:
+      csim->sample.total++;
+      if (!sample_picked(&csim->sample, addr))
+        return 0;
+      result = cache_access(&csim->cache, addr);
+      tally(csim, counts, result, addr);
+      sample_count(&csim->sample, addr, result);
+      return 0;
+    default:
+      tally(csim, counts, cache_access(&csim->cache, addr), addr);
+      return 0;
+  }
+}
+
+/*
+ * translate - look 'addr' up in the TLBs, if any, then load the page
+ *   table entries a walk reads through 'mode' if injecting them
+ *   Returns 0 on success, -1 on failure
+ */
+static ALWAYS_INLINE int translate(csim_t *csim, int mode,
+                                   unsigned long long *counts,
+                                   mem_addr_t addr) {
+  mem_addr_t ptes[TLB_LEVELS];
+  if (csim->config.tlb_entries[0] == 0)
+    return 0;
+  int n = tlb_access(&csim->tlb, addr, ptes);
+  for (int i = 0; i < n && csim->config.inject_walks; i++)
+    if (simulate(csim, mode, counts, ptes[i], 8, 0) != 0)
+      return -1;
+  return 0;
+}
+
+/*
+ * access_span - simulate a load or store of 'len' bytes at 'addr'
+ *   Without splits only the block of 'addr' is accessed. With them every
+ *   block of the span is, in address order, and a span over several
+ *   blocks counts as a line split. vector_bytes widens every access.
+ *   Each block is translated first.
+ *   Returns 0 on success, -1 on failure
+ */
+static ALWAYS_INLINE int access_span(csim_t *csim, int mode,
+                                     unsigned long long *counts,
+                                     mem_addr_t addr, unsigned int len,
+                                     int write) {
+  if (translate(csim, mode, counts, addr) != 0
+      || simulate(csim, mode, counts, addr, len, write) != 0)
+    return -1;
+  if (!csim->config.split)
+    return 0;
+  csim->accesses++;
+  if (len < csim->config.vector_bytes)
+    len = csim->config.vector_bytes;
+  int b = csim->config.b;
+  mem_addr_t first = addr >> b;
+  mem_addr_t last = (addr + (len ? len - 1 : 0)) >> b;
+  if (last == first)
+    return 0;
+  csim->splits++;
+  for (mem_addr_t block = first + 1; block <= last; block++)
+    if (translate(csim, mode, counts, block << b) != 0
+        || simulate(csim, mode, counts, block << b,
+                    addr + len - (block << b), write) != 0)
+      return -1;
+  return 0;
+}
+
+/*
+ * access_interval - simulate one data record of op 'op' at 'addr' under
+ *   interval sampling, as its phase has it
+ */
+static inline void access_interval(csim_t *csim, unsigned long long *counts,
+                                   mem_addr_t addr, int op) {
+  sample_t *sample = &csim->sample;
+  int phase = sample_phase(sample);
+  int times = op == TRACE_M ? 2 : 1;
+  sample->total += times;
+  for (int i = 0; i < times && phase != PHASE_SKIP; i++) {
+    int result = cache_access(&csim->cache, addr);
+    if (phase == PHASE_DETAIL) {
+      tally(csim, counts, result, addr);
+      sample_count(sample, addr, result);
+    }
+  }
+  sample_advance(sample, 1);
+}
+
+/*
+ * access_all - csim_access_sized for 'mode', the mode of 'csim'
+ */
+static ALWAYS_INLINE int access_all(csim_t *csim, int mode,
+                                    const mem_addr_t *addrs,
+                                    const unsigned char *ops,
+                                    const unsigned int *lens, size_t n) {
+  unsigned long long counts[3] = {0};
+  int status = 0;
+  for (size_t i = 0; i < n && status == 0; i++) {
+    int op = ops ? ops[i] : TRACE_L;
+    unsigned int len = lens ? lens[i] : 1;
+    if (op == TRACE_I)
+      csim->last_pc = addrs[i];
+    else if (op == TRACE_T)
+      csim->thread = addrs[i];
+    else if (op > TRACE_T)
+      status = fail(csim, "unknown op %d", op);
+    else if (mode == CSIM_INTERVALS)
+      access_interval(csim, counts, addrs[i], op);
+    else if (access_span(csim, mode, counts, addrs[i], len,
+                         op == TRACE_S) != 0
+             || (op == TRACE_M
+                 && access_span(csim, mode, counts, addrs[i], len, 1) != 0))
+      status = -1;
+  }
+  for (int k = 0; k < 3; k++)
+    csim->counts[k] += counts[k];
+  return status;
+}
+
+/*
+ * access_plain - csim_access_sized for a plain cache
+ *   With 'series' set the accesses are also sampled for the time series,
+ *   the caller making sure that they cannot end its interval.
+ */
+static ALWAYS_INLINE int access_plain(csim_t *csim, int series,
+                                      const mem_addr_t *addrs,
+                                      const unsigned char *ops, size_t n) {
+  cache_t *cache = &csim->cache;
+  unsigned long long counts[3] = {0};
+  int status = 0, b = csim->series.b;
+  mem_addr_t block;
+  for (size_t i = 0; i < n; i++) {
+    int op = ops ? ops[i] : TRACE_L;
+    if (op == TRACE_I) {
+      csim->last_pc = addrs[i];
+      continue;
+    }
+    if (op == TRACE_T) {
+      csim->thread = addrs[i];
+      continue;
+    }
+    if (op > TRACE_T) {
+      status = fail(csim, "unknown op %d", op);
+      break;
+    }
+    counts[cache_access(cache, addrs[i])]++;
+    if (series && series_sampled(block = addrs[i] >> b))
+      series_sample(&csim->series, block, csim->series.pos + counts[0]
+                    + counts[1] + counts[2] - 1);
+    if (op == TRACE_M) {
+      counts[cache_access(cache, addrs[i])]++;
+      if (series && series_sampled(block))
+        series_sample(&csim->series, block, csim->series.pos + counts[0]
+                      + counts[1] + counts[2] - 1);
+    }
+  }
+  if (series)
+    csim->series.pos += counts[0] + counts[1] + counts[2];
+  for (int k = 0; k < 3; k++)
+    csim->counts[k] += counts[k];
+  return status;
+}
+
+/*
+ * access_series - csim_access_sized for a plain cache with a time series
+ *   Runs of records too few to reach the end of the interval, a record
+ *   being at most two accesses, take the plain loop, which counts them all
+ *   at the end of the run, and a record that may end it the general one.
+ */
+static int access_series(csim_t *csim, const mem_addr_t *addrs,
+                         const unsigned char *ops, size_t n) {
+  int status = 0;
+  for (size_t i = 0, run; i < n && status == 0; i += run) {
+    run = (csim->series.length - csim->series.pos - 1) / 2;
+    if (run == 0) {
+      run = 1;
+      status = access_all(csim, CSIM_CACHE, addrs + i, ops ? ops + i : NULL,
+                          NULL, 1);
+    } else {
+      if (run > n - i)
+        run = n - i;
+      status = access_plain(csim, 1, addrs + i, ops ? ops + i : NULL, run);
+    }
+  }
+  return status;
+}
+
+/*
+ * csim_access_sized - simulate 'n' accesses, the i-th of op 'ops[i]' (a
+ *   TRACE_*, all loads if 'ops' is NULL) of 'lens[i]' bytes (1 if 'lens'
+ *   is NULL) at 'addrs[i]'
+ *   A modify is a load then a store, an instruction only sets the PC
+ *   the data accesses after it are attributed to and a thread switch the
+ *   thread they come from. The sizes only matter with splits and
+ *   coherence.
+ *   Returns 0 on success, -1 with the reason in csim->error on failure
+ */
+int csim_access_sized(csim_t *csim, const mem_addr_t *addrs,
+                      const unsigned char *ops, const unsigned int *lens,
+                      size_t n) {
+  if (csim->finished)
+    return fail(csim, "accesses after csim_finish");
+
+  // A plain cache gets the tightest loop, counting locally
+  if (csim->mode == CSIM_CACHE && !csim->config.split
+      && !csim->config.observer && event_level == 0
+      && csim->config.tlb_entries[0] == 0) {
+    if (csim->series.length)
+      return access_series(csim, addrs, ops, n);
+    return access_plain(csim, 0, addrs, ops, n);
+  }
+
+  switch (csim->mode) {
+    case CSIM_SWEEP:
+      return access_all(csim, CSIM_SWEEP, addrs, ops, lens, n);
+    case CSIM_ENGINE:
+      return access_all(csim, CSIM_ENGINE, addrs, ops, lens, n);
+    case CSIM_HIER:
+      return access_all(csim, CSIM_HIER, addrs, ops, lens, n);
+    case CSIM_PREFETCH:
+      return access_all(csim, CSIM_PREFETCH, addrs, ops, lens, n);
+    case CSIM_CLASSIFY:
+      return access_all(csim, CSIM_CLASSIFY, addrs, ops, lens, n);
+    case CSIM_OPT:
+      return access_all(csim, CSIM_OPT, addrs, ops, lens, n);
+    case CSIM_SETS:
+      return access_all(csim, CSIM_SETS, addrs, ops, lens, n);
+    case CSIM_INTERVALS:
+      return access_all(csim, CSIM_INTERVALS, addrs, ops, lens, n);
+    case CSIM_COHERENT:
+      return access_all(csim, CSIM_COHERENT, addrs, ops, lens, n);
+    default:
+      return access_all(csim, CSIM_CACHE, addrs, ops, lens, n);
+  }
+}
+
+/*
+ * csim_access_batch - csim_access_sized with every access 1 byte long
+ */
+int csim_access_batch(csim_t *csim, const mem_addr_t *addrs,
+                      const unsigned char *ops, size_t n) {
+  return csim_access_sized(csim, addrs, ops, NULL, n);
+}
+
+/*
+ * csim_skippable - how many of the next data records interval sampling
+ *   skips
+ *   A caller that can drop them faster than it can pass them (see
+ *   trace_skip) does so, then reports them with csim_skip.
+ */
+size_t csim_skippable(const csim_t *csim) {
+  if (csim->mode != CSIM_INTERVALS
+      || sample_phase(&csim->sample) != PHASE_SKIP)
+    return 0;
+  return csim->sample.skip - csim->sample.pos;
+}
+
+/*
+ * csim_skip - account for 'records' data records, 'accesses' accesses,
+ *   that the caller dropped as csim_skippable allowed
+ */
+void csim_skip(csim_t *csim, size_t records, unsigned long long accesses) {
+  if (csim->mode != CSIM_INTERVALS)
+    return;
+  csim->sample.total += accesses;
+  sample_advance(&csim->sample, records);
+}
+
+/*
+ * replay_opt - run the buffered accesses through the cache now that
+ *   their next uses are known
+ *   Returns 0 on success, -1 if out of memory
+ */
+static int replay_opt(csim_t *csim) {
+  size_t n = csim->opt_count;
+  unsigned long long *next_use = malloc(n * sizeof(unsigned long long));
+  if (next_use == NULL
+      || repl_next_use(csim->opt_addrs, n, csim->config.b, next_use) != 0) {
+    free(next_use);
+    return fail(csim, "Not enough memory to look ahead in the accesses");
+  }
+  unsigned long long counts[3] = {0};
+  csim->cache.next_use = next_use;
+  for (size_t i = 0; i < n; i++)
+    tally(csim, counts, cache_access(&csim->cache, csim->opt_addrs[i]),
+          csim->opt_addrs[i]);
+  for (int k = 0; k < 3; k++)
+    csim->counts[k] += counts[k];
+  csim->cache.next_use = NULL;
+  free(next_use);
+  free(csim->opt_addrs);
+  csim->opt_addrs = NULL;
+  csim->opt_count = csim->opt_size = 0;
+  return 0;
+}
+
+/*
+ * csim_finish - complete the simulation once every access is in: stop
+ *   the worker threads, or simulate the buffered accesses under OPT, and
+ *   close the last interval of the time series
+ *   Returns 0 on success, -1 with the reason in csim->error on failure
+ */
+int csim_finish(csim_t *csim) {
+  if (csim->finished)
+    return 0;
+  csim->finished = 1;
+  if (csim->mode == CSIM_ENGINE)
+    engine_finish(&csim->engine, csim->counts);
+  else if (csim->mode == CSIM_SETS || csim->mode == CSIM_INTERVALS)
+    sample_finish(&csim->sample);
+  else if (csim->mode == CSIM_OPT && replay_opt(csim) != 0)
+    return -1;
+  else if (csim->mode == CSIM_COHERENT
+           && coherence_finish(&csim->coherence, csim->counts) != 0)
+    return fail(csim, "Not enough memory to track the shared lines");
+  if (csim->series.length
+      && series_finish(&csim->series, csim->counts) != 0)
+    return fail(csim, "Not enough memory for the time series");
+  return 0;
+}
+
+/*
+ * csim_stats - store the outcome of the accesses so far in *stats
+ *   A sweep has one per geometry, see csim->sweep, and the TLBs count
+ *   their own in csim->tlb
+ */
+void csim_stats(const csim_t *csim, csim_stats_t *stats) {
+  memset(stats, 0, sizeof(csim_stats_t));
+  stats->hits = csim->counts[CACHE_HIT];
+  stats->misses = csim->counts[CACHE_MISS] + csim->counts[CACHE_EVICT];
+  stats->evictions = csim->counts[CACHE_EVICT];
+  stats->accesses = csim->accesses;
+  stats->splits = csim->splits;
+  for (int k = 0; k < 3; k++)
+    stats->half[k] = -1;
+
+  // Sampled runs scale their rates up to every access of the trace
+  unsigned long long total = stats->hits + stats->misses;
+  if ((csim->mode == CSIM_SETS || csim->mode == CSIM_INTERVALS)
+      && csim->finished
+      && sample_estimate(&csim->sample, stats->rate, stats->half) == 0) {
+    total = csim->sample.total;
+    stats->estimated = 1;
+    stats->misses = stats->rate[CACHE_MISS] * total + 0.5;
+    stats->hits = total - stats->misses;
+    stats->evictions = stats->rate[CACHE_EVICT] * total + 0.5;
+  } else if (total > 0) {
+    stats->rate[CACHE_HIT] = (double) stats->hits / total;
+    stats->rate[CACHE_MISS] = (double) stats->misses / total;
+    stats->rate[CACHE_EVICT] = (double) stats->evictions / total;
+  }
+}
+
+/*
+ * csim_print - report what the mode adds to the counts to 'fp': the
+ *   sweep table, the levels, the prefetchers, the miss classes or the
+ *   cores, then the line splits, the TLBs and the phases
+ */
+void csim_print(const csim_t *csim, FILE *fp) {
+  switch (csim->mode) {
+    case CSIM_SWEEP:
+      sweep_print(&csim->sweep, fp);
+      break;
+    case CSIM_HIER:
+      hier_print(&csim->hier, fp);
+      break;
+    case CSIM_PREFETCH:
+      prefetch_print(&csim->prefetch, csim->counts[CACHE_MISS]
+                     + csim->counts[CACHE_EVICT], fp);
+      break;
+    case CSIM_CLASSIFY:
+      classify_print(&csim->classify, csim->config.top, fp);
+      break;
+    case CSIM_SETS:
+    case CSIM_INTERVALS:
+      sample_print(&csim->sample, fp);
+      break;
+    case CSIM_COHERENT:
+      coherence_print(&csim->coherence, csim->config.top, fp);
+      break;
+  }
+  if (csim->config.split)
+    fprintf(fp, "accesses:%llu line splits:%llu (%.2f%%)\n", csim->accesses,
+            csim->splits,
+            csim->accesses ? 100.0 * csim->splits / csim->accesses : 0.0);
+  if (csim->config.tlb_entries[0] > 0)
+    tlb_print(&csim->tlb, fp);
+  if (csim->series.length)
+    series_print(&csim->series, fp);
+}
+
+/*
+ * csim_free - free everything 'csim' allocated, stopping the worker
+ *   threads if csim_finish did not
+ */
+void csim_free(csim_t *csim) {
+  tlb_free(&csim->tlb);
+  series_free(&csim->series);
+  switch (csim->mode) {
+    case CSIM_SWEEP:
+      sweep_free(&csim->sweep);
+      return;
+    case CSIM_HIER:
+      hier_free(&csim->hier);
+      return;
+    case CSIM_COHERENT:
+      coherence_free(&csim->coherence);
+      return;
+    case CSIM_ENGINE:
+      if (!csim->finished)
+        engine_finish(&csim->engine, NULL);
+      break;
+    case CSIM_PREFETCH:
+      prefetch_free(&csim->prefetch);
+      break;
+    case CSIM_CLASSIFY:
+      classify_free(&csim->classify);
+      break;
+    case CSIM_SETS:
+      sample_free(&csim->sample);
+      break;
+  }
+  free(csim->opt_addrs);
+  csim->opt_addrs = NULL;
+  cache_free(&csim->cache);
+}
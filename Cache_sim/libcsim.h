@@ -0,0 +1,162 @@
+////////////////////////////////////////////////////////////////////////////////
+// Main File:        csim.c
+// This File:        libcsim.h
+// Other Files:      csim.c libcsim.c cache.c cache.h sweep.c sweep.h
+//                   parallel.c parallel.h hier.c hier.h prefetch.c
+//                   prefetch.h classify.c classify.h sample.c sample.h
+//                   tlb.c tlb.h coherence.c coherence.h series.c series.h
+// Semester:         CS 354 Fall 2018
+//
+// Author:           Yuanhang Wang
+// Email:            wang2243@wisc.edu
+// CS Login:         ywang
+//
+/////////////////////////// OTHER SOURCES OF HELP //////////////////////////////
+//                   fully acknowledge and credit all sources of help,
+//                   other than Instructors and TAs.
+//
+// Persons:          Identify persons by name, relationship to you, and email.
+//                   Describe in detail the the ideas and help they provided.
+//
+// Online sources:   avoid web searches to solve your problems, but if you do
+//                   search, be sure to include Web URLs and description of
+//                   of any information you find.
+//////////////////////////// 80 columns wide ///////////////////////////////////
+
+#ifndef __libcsim_h__
+#define __libcsim_h__
+
+#include <stdio.h>
+#include "cache.h"
+#include "trace.h"
+#include "sweep.h"
+#include "parallel.h"
+#include "hier.h"
+#include "prefetch.h"
+#include "classify.h"
+#include "sample.h"
+#include "tlb.h"
+#include "coherence.h"
+#include "series.h"
+
+/* Modes, picked by csim_init from the configuration */
+#define CSIM_CACHE     0  /* one cache */
+#define CSIM_SWEEP     1  /* every geometry in the ranges */
+#define CSIM_ENGINE    2  /* one cache split among worker threads */
+#define CSIM_HIER      3  /* the L1 of a hierarchy */
+#define CSIM_PREFETCH  4  /* one cache with prefetchers */
+#define CSIM_CLASSIFY  5  /* one cache with its misses classified */
+#define CSIM_OPT       6  /* one cache under OPT, simulated by csim_finish */
+#define CSIM_SETS      7  /* one cache, some of its sets simulated */
+#define CSIM_INTERVALS 8  /* one cache, periodic intervals simulated */
+#define CSIM_COHERENT  9  /* a cache per core, kept coherent */
+
+/* Type: What to simulate, start from csim_config_default */
+typedef struct csim_config {
+  int s, E, b;
+  int s_hi, E_hi, b_hi;       /* ends of ranges to sweep, -1 => no range */
+  int repl;                   /* one of REPL_* */
+  int list_lru;               /* nonzero => O(1) list LRU */
+  int nthreads;               /* above 1 => split the sets among threads */
+  int cores;                  /* above 0 => a cache per core, kept
+                                 coherent, thread t running on core
+                                 t % cores */
+  int protocol;               /* one of COH_MESI and COH_MOESI */
+  int directory;              /* nonzero => directory, else snooping */
+  const char *levels;         /* levels below the L1 if set, each
+                                 <s>:<E>:<b>:<latency>[:wt], comma
+                                 separated */
+  int l1_latency;             /* cycles */
+  int l1_write_through;
+  int mem_latency;            /* cycles */
+  int inclusion;              /* one of HIER_* */
+  const char *prefetchers;    /* if set, each <kind>[:<deg>[:<dist>]],
+                                 comma separated */
+  int prefetch_latency;       /* demand accesses */
+  int classify;               /* nonzero => classify and attribute misses */
+  int region_bits;
+  int top;                    /* regions and PCs csim_print reports */
+  int split;                  /* nonzero => access every block covered */
+  unsigned int vector_bytes;  /* minimum access size, 0 => as given */
+  int sample_sets;            /* above 0 => simulate 1 in sample_sets sets */
+  unsigned long long sample_period;  /* above 0 => interval sampling with
+                                        periods of this many data records */
+  unsigned long long sample_detail;  /* records measured per period */
+  long long sample_warm;      /* records of warm-up before them, -1 => all
+                                 the others */
+  int tlb_entries[2];         /* L1 and L2 TLB entries, 0 => no such TLB */
+  int tlb_ways[2];
+  int page_bits;              /* 12, 21 or 30 */
+  int walk_entries;           /* page-walk cache entries per level */
+  int inject_walks;           /* nonzero => walks read the page table
+                                 entries through the cache */
+  unsigned long long series_length;  /* above 0 => statistics of every
+                                        interval of this many accesses */
+  double phase_threshold;     /* signature distance starting a new phase */
+  /* Called with the outcome (CACHE_*) of every access to the cache, if
+   * set, except in the sweep and engine modes and with threads */
+  void (*observer)(void *arg, mem_addr_t addr, int result);
+  void *observer_arg;
+} csim_config_t;
+
+/* Type: Outcome of the accesses so far
+ * With threads or OPT the counts are only complete after csim_finish.
+ * With coherence they add up every core's.
+ * With sampling they are those measured until then, and estimates for the
+ * whole trace after. Page table entries that walks read through the cache
+ * count as loads.
+ */
+typedef struct csim_stats {
+  unsigned long long hits;
+  unsigned long long misses;
+  unsigned long long evictions;  /* misses that replaced a valid line */
+  unsigned long long accesses;   /* loads and stores, if split */
+  unsigned long long splits;     /* of which covered several blocks */
+  int estimated;                 /* nonzero => the counts are estimates */
+  double rate[3];                /* hit, miss and eviction rates */
+  double half[3];                /* half widths of their 95% intervals if
+                                    estimated, -1 otherwise */
+} csim_stats_t;
+
+/* Type: One simulation
+ * Instances share no state, so each can be driven by its own thread. A
+ * csim_t must not be moved or copied once initialized.
+ */
+typedef struct csim {
+  csim_config_t config;
+  int mode;                   /* one of CSIM_* */
+  int finished;
+  cache_t cache;
+  sweep_t sweep;
+  engine_t engine;
+  hier_t hier;
+  prefetch_t prefetch;
+  classify_t classify;
+  sample_t sample;
+  tlb_t tlb;                  /* if config.tlb_entries[0] is set */
+  coherence_t coherence;
+  series_t series;            /* if config.series_length is set */
+  mem_addr_t *opt_addrs;      /* accesses buffered for OPT */
+  size_t opt_count, opt_size;
+  mem_addr_t last_pc;         /* latest instruction address */
+  mem_addr_t thread;          /* latest thread switched to */
+  unsigned long long counts[3];  /* indexed by CACHE_HIT/MISS/EVICT */
+  unsigned long long accesses, splits;
+  char error[160];            /* why the latest call failed */
+} csim_t;
+
+void csim_config_default(csim_config_t *config);
+int csim_init(csim_t *csim, const csim_config_t *config);
+int csim_access_batch(csim_t *csim, const mem_addr_t *addrs,
+                      const unsigned char *ops, size_t n);
+int csim_access_sized(csim_t *csim, const mem_addr_t *addrs,
+                      const unsigned char *ops, const unsigned int *lens,
+                      size_t n);
+size_t csim_skippable(const csim_t *csim);
+void csim_skip(csim_t *csim, size_t records, unsigned long long accesses);
+int csim_finish(csim_t *csim);
+void csim_stats(const csim_t *csim, csim_stats_t *stats);
+void csim_print(const csim_t *csim, FILE *fp);
+void csim_free(csim_t *csim);
+
+#endif // __libcsim_h__
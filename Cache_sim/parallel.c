@@ -0,0 +1,152 @@
+////////////////////////////////////////////////////////////////////////////////
+// Main File:        csim.c
+// This File:        parallel.c
+// Other Files:      csim.c parallel.h ring.h cache.c cache.h
+// Semester:         CS 354 Fall 2018
+//
+// Author:           Yuanhang Wang
+// Email:            wang2243@wisc.edu
+// CS Login:         ywang
+//
+/////////////////////////// OTHER SOURCES OF HELP //////////////////////////////
+//                   fully acknowledge and credit all sources of help,
+//                   other than Instructors and TAs.
+//
+// Persons:          Identify persons by name, relationship to you, and email.
+//                   Describe in detail the the ideas and help they provided.
+//
+// Online sources:   avoid web searches to solve your problems, but if you do
+//                   search, be sure to include Web URLs and description of
+//                   of any information you find.
+//////////////////////////// 80 columns wide ///////////////////////////////////
+
+/*
+ * parallel.c - Simulates the cache with one thread per range of sets
+ *     (see parallel.h).
+ *
+ * Worker w owns sets [w * S / N, (w + 1) * S / N). In stamp mode all
+ * workers share the cache arrays and each has its own access clock,
+ * which is enough because stamps are only compared within a set. The hash
+ * table of list LRU mode is shared between sets, so there every worker
+ * gets a cache of its own.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include "parallel.h"
+
+#define RING_SIZE (1 << 16)  /* addresses per worker ring */
+
+static void *worker_main(void *arg) {
+  worker_t *worker = arg;
+  mem_addr_t batch[BATCH];
+  for (;;) {
+    size_t n = ring_pop(&worker->ring, batch, BATCH);
+    if (n == 0) {
+      // The reader sets done after its last push, so once done is seen an
+      // empty ring stays empty
+      if (__atomic_load_n(&worker->ring.done, __ATOMIC_ACQUIRE)
+          && (n = ring_pop(&worker->ring, batch, BATCH)) == 0)
+        break;
+      if (n == 0) {
+        sched_yield();
+        continue;
+      }
+    }
+    for (size_t i = 0; i < n; i++)
+      worker->counts[cache_access(&worker->cache, batch[i])]++;
+  }
+  return NULL;
+}
+
+/*
+ * flush - push the staged addresses of 'worker' into its ring, waiting
+ *   for room if the worker is behind
+ */
+static void flush(worker_t *worker) {
+  size_t done = 0;
+  while (done < (size_t) worker->batched) {
+    done += ring_push(&worker->ring, worker->batch + done,
+                      worker->batched - done);
+    if (done < (size_t) worker->batched)
+      sched_yield();
+  }
+  worker->batched = 0;
+}
+
+/*
+ * engine_start - start 'nworkers' workers on 'cache', fewer if it has
+ *   fewer sets
+ *   Returns 0 on success, -1 on failure
+ */
+int engine_start(engine_t *engine, cache_t *cache, int nworkers) {
+  memset(engine, 0, sizeof(engine_t));
+  if (nworkers > cache->S)
+    nworkers = cache->S;
+  engine->s = cache->s;
+  engine->b = cache->b;
+  engine->workers = calloc(nworkers, sizeof(worker_t));
+  if (engine->workers == NULL)
+    return -1;
+
+  for (int i = 0; i < nworkers; i++) {
+    worker_t *worker = &engine->workers[i];
+    if (cache->list_lru) {
+      if (cache_init(&worker->cache, cache->s, cache->E, cache->b, 1) != 0)
+        goto fail;
+    } else {
+      worker->cache = *cache;
+    }
+    worker->ring.slots = malloc(RING_SIZE * sizeof(mem_addr_t));
+    worker->ring.mask = RING_SIZE - 1;
+    if (worker->ring.slots == NULL
+        || pthread_create(&worker->tid, NULL, worker_main, worker) != 0) {
+      if (cache->list_lru)
+        cache_free(&worker->cache);
+      free(worker->ring.slots);
+      goto fail;
+    }
+    engine->nworkers++;
+  }
+  return 0;
+
+fail:
+  engine_finish(engine, NULL);
+  return -1;
+}
+
+/*
+ * engine_access - hand 'addr' to the worker owning its set
+ */
+void engine_access(engine_t *engine, mem_addr_t addr) {
+  mem_addr_t set = (addr >> engine->b) & (((mem_addr_t) 1 << engine->s) - 1);
+  worker_t *worker = &engine->workers[(set * engine->nworkers) >> engine->s];
+  worker->batch[worker->batched++] = addr;
+  if (worker->batched == BATCH)
+    flush(worker);
+}
+
+/*
+ * engine_finish - wait for the workers to drain their rings, stop them and
+ *   add up their counts into 'counts' (indexed by CACHE_HIT/MISS/EVICT)
+ *   unless it is NULL
+ */
+void engine_finish(engine_t *engine, unsigned long long counts[3]) {
+  for (int i = 0; i < engine->nworkers; i++) {
+    worker_t *worker = &engine->workers[i];
+    flush(worker);
+    __atomic_store_n(&worker->ring.done, 1, __ATOMIC_RELEASE);
+  }
+  for (int i = 0; i < engine->nworkers; i++) {
+    worker_t *worker = &engine->workers[i];
+    pthread_join(worker->tid, NULL);
+    for (int k = 0; counts != NULL && k < 3; k++)
+      counts[k] += worker->counts[k];
+    if (worker->cache.list_lru)
+      cache_free(&worker->cache);
+    free(worker->ring.slots);
+  }
+  free(engine->workers);
+  memset(engine, 0, sizeof(engine_t));
+}
@@ -0,0 +1,62 @@
+////////////////////////////////////////////////////////////////////////////////
+// Main File:        csim.c
+// This File:        parallel.h
+// Other Files:      csim.c parallel.c ring.h cache.h
+// Semester:         CS 354 Fall 2018
+//
+// Author:           Yuanhang Wang
+// Email:            wang2243@wisc.edu
+// CS Login:         ywang
+//
+/////////////////////////// OTHER SOURCES OF HELP //////////////////////////////
+//                   fully acknowledge and credit all sources of help,
+//                   other than Instructors and TAs.
+//
+// Persons:          Identify persons by name, relationship to you, and email.
+//                   Describe in detail the the ideas and help they provided.
+//
+// Online sources:   avoid web searches to solve your problems, but if you do
+//                   search, be sure to include Web URLs and description of
+//                   of any information you find.
+//////////////////////////// 80 columns wide ///////////////////////////////////
+
+#ifndef __parallel_h__
+#define __parallel_h__
+
+#include <pthread.h>
+#include "cache.h"
+#include "ring.h"
+
+#define BATCH 256  /* addresses staged per worker before a ring push */
+
+/* Type: Worker thread
+ * Owns a contiguous range of sets, so its view of the cache shares no
+ * line with another worker's.
+ */
+typedef struct worker {
+  pthread_t tid;
+  ring_t ring;
+  cache_t cache;              /* shares the arrays unless list_lru */
+  unsigned long long counts[3];  /* indexed by CACHE_HIT/MISS/EVICT */
+  mem_addr_t batch[BATCH];    /* staged by the reader */
+  int batched;
+} worker_t;
+
+/* Type: Set-partitioned simulation engine
+ * The thread calling engine_access is the reader: it routes every
+ * access to the worker owning its set. Since LRU state is per set and
+ * each worker sees the accesses to its sets in trace order, the counts
+ * are exactly those of a serial run.
+ */
+typedef struct engine {
+  int nworkers;
+  int s;
+  int b;
+  worker_t *workers;
+} engine_t;
+
+int engine_start(engine_t *engine, cache_t *cache, int nworkers);
+void engine_access(engine_t *engine, mem_addr_t addr);
+void engine_finish(engine_t *engine, unsigned long long counts[3]);
+
+#endif // __parallel_h__
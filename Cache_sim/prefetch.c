@@ -0,0 +1,348 @@
+////////////////////////////////////////////////////////////////////////////////
+// Main File:        csim.c
+// This File:        prefetch.c
+// Other Files:      csim.c prefetch.h cache.c cache.h event.h
+// Semester:         CS 354 Fall 2018
+//
+// Author:           Yuanhang Wang
+// Email:            wang2243@wisc.edu
+// CS Login:         ywang
+//
+/////////////////////////// OTHER SOURCES OF HELP //////////////////////////////
+//                   fully acknowledge and credit all sources of help,
+//                   other than Instructors and TAs.
+//
+// Persons:          Identify persons by name, relationship to you, and email.
+//                   Describe in detail the the ideas and help they provided.
+//
+// Online sources:   avoid web searches to solve your problems, but if you do
+//                   search, be sure to include Web URLs and description of
+//                   of any information you find.
+//////////////////////////// 80 columns wide ///////////////////////////////////
+
+/*
+ * prefetch.c - Hardware prefetchers in front of the cache (see
+ *     prefetch.h).
+ *
+ * Every demand access goes to the cache first. A miss, or the first hit
+ * on a prefetched line, is a trigger; then every prefetcher sees the
+ * access:
+ *   next:   on a trigger, the 'degree' blocks starting 'distance' blocks
+ *           after the accessed one
+ *   stride: on every access, looks up its region in a direct-mapped
+ *           table. Once the same stride has repeated three times in a
+ *           row it prefetches 'degree' strides starting 'distance'
+ *           strides ahead, a stride shorter than a block counting as
+ *           one block.
+ *   stream: on a trigger, follows runs of misses in a few stream buffers.
+ *           A miss within two blocks of a new buffer gives it a
+ *           direction. From then on each miss or prefetched hit in the
+ *           run brings in up to 'degree' more blocks, keeping up to
+ *           'distance' blocks ahead. A miss no buffer follows takes the
+ *           least recently used buffer.
+ * Prefetches go into the cache like misses but count as none, and never
+ * cross a region, as hardware working on physical addresses cannot.
+ *
+ * A prefetch arrives 'latency' demand accesses after it is issued. A
+ * demand hit on a prefetched line counts as useful if the line had
+ * arrived and late otherwise (it is still a hit). A prefetched line
+ * evicted before any demand is unused. A prefetch that evicts a demanded
+ * block records it in a filter with one slot per line, and a later miss
+ * on that block makes the prefetch polluting. Filter slots are
+ * overwritten on collisions, so that count is a lower bound.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "prefetch.h"
+#include "event.h"
+
+static const char *kinds[] = {"next", "stride", "stream"};
+
+/*
+ * prefetch_init - attach an empty set of prefetchers to 'cache'
+ *   Returns 0 on success, -1 if memory runs out
+ */
+int prefetch_init(prefetch_t *prefetch, cache_t *cache, int latency) {
+  memset(prefetch, 0, sizeof(prefetch_t));
+  size_t lines = (size_t) cache->S * cache->ways;
+  size_t slots = 1;
+  while (slots < lines)
+    slots <<= 1;
+  prefetch->cache = cache;
+  prefetch->latency = latency;
+  prefetch->owner = calloc(lines, 1);
+  prefetch->ready = calloc(lines, sizeof(unsigned long long));
+  prefetch->filter = malloc(slots * sizeof(mem_addr_t));
+  prefetch->filter_owner = calloc(slots, 1);
+  prefetch->filter_mask = slots - 1;
+  if (!prefetch->owner || !prefetch->ready || !prefetch->filter
+      || !prefetch->filter_owner) {
+    prefetch_free(prefetch);
+    return -1;
+  }
+  memset(prefetch->filter, 0xff, slots * sizeof(mem_addr_t));
+  return 0;
+}
+
+/*
+ * prefetch_parse - return the PF_* kind called 'name', or -1 if none is
+ */
+int prefetch_parse(const char *name) {
+  for (int i = 0; i < 3; i++)
+    if (strcmp(name, kinds[i]) == 0)
+      return i;
+  return -1;
+}
+
+/*
+ * prefetch_add - add a prefetcher of kind 'kind'
+ *   Returns 0 on success, -1 if there are too many, the arguments are
+ *   invalid or memory runs out
+ */
+int prefetch_add(prefetch_t *prefetch, int kind, int degree, int distance) {
+  if (prefetch->n == PF_MAX || kind < 0 || kind > PF_STREAM || degree < 1
+      || distance < 1)
+    return -1;
+  prefetcher_t *pf = &prefetch->pf[prefetch->n];
+  memset(pf, 0, sizeof(prefetcher_t));
+  pf->kind = kind;
+  pf->degree = degree;
+  pf->distance = distance;
+  if (kind == PF_STRIDE
+      && (pf->table = calloc(PF_TABLE, sizeof(pf_stride_t))) == NULL)
+    return -1;
+  if (kind == PF_STREAM
+      && (pf->streams = calloc(PF_STREAMS, sizeof(pf_stream_t))) == NULL)
+    return -1;
+  if (pf->table)
+    for (int i = 0; i < PF_TABLE; i++)
+      pf->table[i].region = TAG_INVALID;
+  prefetch->n++;
+  return 0;
+}
+
+static inline unsigned long long filter_slot(const prefetch_t *prefetch,
+                                             mem_addr_t block) {
+  unsigned long long h = block * 0x9E3779B97F4A7C15ULL;
+  return (h ^ h >> 31) & prefetch->filter_mask;
+}
+
+/*
+ * same_region - whether 'a' and 'b' are in the same region, a region
+ *   being at least a block
+ */
+static inline int same_region(const prefetch_t *prefetch, mem_addr_t a,
+                              mem_addr_t b) {
+  int bits = prefetch->cache->b > PF_REGION_BITS ? prefetch->cache->b
+                                                 : PF_REGION_BITS;
+  return a >> bits == b >> bits;
+}
+
+/*
+ * issue - prefetcher 'who' brings in the block at 'addr' if it is in the
+ *   region of 'from' and not already in the cache
+ */
+static void issue(prefetch_t *prefetch, int who, mem_addr_t from,
+                  mem_addr_t addr) {
+  cache_t *cache = prefetch->cache;
+  if (!same_region(prefetch, from, addr) || cache_probe(cache, addr) >= 0)
+    return;
+  mem_addr_t victim;
+  int victim_dirty;
+  int result = cache_insert(cache, addr, 0, &victim, &victim_dirty);
+  long long line = cache_probe(cache, addr);
+  if (result == CACHE_EVICT) {
+    if (prefetch->owner[line]) {
+      prefetch->pf[prefetch->owner[line] - 1].unused++;
+    } else {
+      mem_addr_t block = victim >> cache->b;
+      unsigned long long slot = filter_slot(prefetch, block);
+      prefetch->filter[slot] = block;
+      prefetch->filter_owner[slot] = who + 1;
+    }
+  }
+  prefetch->owner[line] = who + 1;
+  prefetch->ready[line] = prefetch->now + prefetch->latency;
+  prefetch->pf[who].issued++;
+  EVENT(EV_DETAIL, 'p', addr);
+}
+
+/*
+ * observe_stride - feed the access at 'addr' to stride prefetcher 'who'
+ */
+static void observe_stride(prefetch_t *prefetch, int who, mem_addr_t addr) {
+  prefetcher_t *pf = &prefetch->pf[who];
+  mem_addr_t region = addr >> PF_REGION_BITS;
+  pf_stride_t *entry = &pf->table[region & (PF_TABLE - 1)];
+  if (entry->region != region) {
+    entry->region = region;
+    entry->last = addr;
+    entry->stride = 0;
+    entry->confidence = 0;
+    return;
+  }
+  long long delta = (long long) (addr - entry->last);
+  if (delta == 0)
+    return;
+  if (delta == entry->stride) {
+    if (entry->confidence < 3)
+      entry->confidence++;
+  } else {
+    entry->stride = delta;
+    entry->confidence = 0;
+  }
+  entry->last = addr;
+  if (entry->confidence < 2)
+    return;
+
+  long long block = 1LL << prefetch->cache->b;
+  long long step = entry->stride;
+  if (step > -block && step < block)
+    step = step > 0 ? block : -block;
+  for (int i = 0; i < pf->degree; i++)
+    issue(prefetch, who, addr, addr + step * (pf->distance + i));
+}
+
+/*
+ * observe_stream - feed the trigger at 'addr' to stream prefetcher 'who'
+ */
+static void observe_stream(prefetch_t *prefetch, int who, mem_addr_t addr) {
+  prefetcher_t *pf = &prefetch->pf[who];
+  int b = prefetch->cache->b;
+  mem_addr_t block = addr >> b;
+  pf_stream_t *stream = NULL, *oldest = &pf->streams[0];
+
+  for (int i = 0; i < PF_STREAMS; i++) {
+    pf_stream_t *sb = &pf->streams[i];
+    if (!sb->valid || sb->stamp < oldest->stamp)
+      oldest = sb;
+    if (!sb->valid)
+      continue;
+    long long d = (long long) (block - sb->last);
+    if (sb->dir == 0 ? d != 0 && d >= -2 && d <= 2
+                     : d * sb->dir > 0 && d * sb->dir <= pf->distance) {
+      stream = sb;
+      break;
+    }
+  }
+  if (stream == NULL) {
+    // A new run, its direction is not known yet
+    oldest->valid = 1;
+    oldest->dir = 0;
+    oldest->last = block;
+    oldest->stamp = prefetch->now;
+    return;
+  }
+
+  if (stream->dir == 0) {
+    stream->dir = block > stream->last ? 1 : -1;
+    stream->next = block + stream->dir;
+  }
+  stream->last = block;
+  stream->stamp = prefetch->now;
+  // Stay ahead of the demand stream
+  if ((long long) (stream->next - block) * stream->dir <= 0)
+    stream->next = block + stream->dir;
+  for (int i = 0; i < pf->degree
+       && (long long) (stream->next - block) * stream->dir <= pf->distance;
+       i++) {
+    issue(prefetch, who, addr, stream->next << b);
+    stream->next += stream->dir;
+  }
+}
+
+/*
+ * prefetch_access - demand access to 'addr', after which every
+ *   prefetcher gets to see it
+ *   Returns CACHE_HIT, CACHE_MISS or CACHE_EVICT, as cache_access
+ */
+int prefetch_access(prefetch_t *prefetch, mem_addr_t addr) {
+  cache_t *cache = prefetch->cache;
+  long long line = cache_probe(cache, addr);
+  int result, trigger;
+
+  prefetch->now++;
+  if (line >= 0) {
+    cache_lookup(cache, addr, 0);
+    result = CACHE_HIT;
+    trigger = prefetch->owner[line] != 0;
+    if (trigger) {
+      prefetcher_t *pf = &prefetch->pf[prefetch->owner[line] - 1];
+      if (prefetch->now < prefetch->ready[line])
+        pf->late++;
+      else
+        pf->useful++;
+      prefetch->owner[line] = 0;
+    }
+  } else {
+    mem_addr_t victim;
+    int victim_dirty;
+    result = cache_insert(cache, addr, 0, &victim, &victim_dirty);
+    line = cache_probe(cache, addr);
+    if (result == CACHE_EVICT && prefetch->owner[line])
+      prefetch->pf[prefetch->owner[line] - 1].unused++;
+    prefetch->owner[line] = 0;
+
+    mem_addr_t block = addr >> cache->b;
+    unsigned long long slot = filter_slot(prefetch, block);
+    if (prefetch->filter[slot] == block) {
+      prefetch->pf[prefetch->filter_owner[slot] - 1].polluting++;
+      prefetch->filter[slot] = TAG_INVALID;
+    }
+    trigger = 1;
+  }
+
+  for (int i = 0; i < prefetch->n; i++) {
+    prefetcher_t *pf = &prefetch->pf[i];
+    if (pf->kind == PF_STRIDE) {
+      observe_stride(prefetch, i, addr);
+    } else if (trigger && pf->kind == PF_STREAM) {
+      observe_stream(prefetch, i, addr);
+    } else if (trigger) {
+      mem_addr_t base = addr >> cache->b << cache->b;
+      for (int k = 0; k < pf->degree; k++)
+        issue(prefetch, i, addr,
+              base + ((mem_addr_t) (pf->distance + k) << cache->b));
+    }
+  }
+  return result;
+}
+
+/*
+ * prefetch_print - print what became of the prefetches of every
+ *   prefetcher, given the number of demand misses that remained
+ *   Accuracy is the share of prefetches demanded, coverage the share of
+ *   would-be misses they removed
+ */
+void prefetch_print(const prefetch_t *prefetch, unsigned long long misses,
+                    FILE *fp) {
+  fprintf(fp, "%-9s %3s %4s %12s %12s %12s %12s %12s %8s %8s\n",
+          "prefetch", "deg", "dist", "issued", "useful", "late", "unused",
+          "polluting", "accuracy", "coverage");
+  for (int i = 0; i < prefetch->n; i++) {
+    const prefetcher_t *pf = &prefetch->pf[i];
+    unsigned long long used = pf->useful + pf->late;
+    fprintf(fp, "%-9s %3d %4d %12llu %12llu %12llu %12llu %12llu %7.2f%% "
+            "%7.2f%%\n", kinds[pf->kind], pf->degree, pf->distance,
+            pf->issued, pf->useful, pf->late, pf->unused, pf->polluting,
+            pf->issued ? 100.0 * used / pf->issued : 0.0,
+            used + misses ? 100.0 * used / (used + misses) : 0.0);
+  }
+  fprintf(fp, "prefetch latency: %d accesses\n", prefetch->latency);
+}
+
+/*
+ * prefetch_free - free the memory of the prefetchers
+ */
+void prefetch_free(prefetch_t *prefetch) {
+  for (int i = 0; i < prefetch->n; i++) {
+    free(prefetch->pf[i].table);
+    free(prefetch->pf[i].streams);
+  }
+  free(prefetch->owner);
+  free(prefetch->ready);
+  free(prefetch->filter);
+  free(prefetch->filter_owner);
+  memset(prefetch, 0, sizeof(prefetch_t));
+}
@@ -0,0 +1,98 @@
+////////////////////////////////////////////////////////////////////////////////
+// Main File:        csim.c
+// This File:        prefetch.h
+// Other Files:      csim.c prefetch.c cache.c cache.h
+// Semester:         CS 354 Fall 2018
+//
+// Author:           Yuanhang Wang
+// Email:            wang2243@wisc.edu
+// CS Login:         ywang
+//
+/////////////////////////// OTHER SOURCES OF HELP //////////////////////////////
+//                   fully acknowledge and credit all sources of help,
+//                   other than Instructors and TAs.
+//
+// Persons:          Identify persons by name, relationship to you, and email.
+//                   Describe in detail the the ideas and help they provided.
+//
+// Online sources:   avoid web searches to solve your problems, but if you do
+//                   search, be sure to include Web URLs and description of
+//                   of any information you find.
+//////////////////////////// 80 columns wide ///////////////////////////////////
+
+#ifndef __prefetch_h__
+#define __prefetch_h__
+
+#include <stdio.h>
+#include "cache.h"
+
+#define PF_MAX 4          /* prefetchers running side by side */
+
+/* Prefetcher kinds */
+#define PF_NEXT   0       /* next line(s) */
+#define PF_STRIDE 1       /* constant stride within a region */
+#define PF_STREAM 2       /* stream buffers following ascending or
+                             descending runs of misses */
+
+#define PF_REGION_BITS 12 /* regions are 4 KiB pages */
+#define PF_TABLE   64     /* stride table entries */
+#define PF_STREAMS 8      /* stream buffers */
+
+/* Type: Stride table entry, one region */
+typedef struct pf_stride {
+  mem_addr_t region;
+  mem_addr_t last;            /* last address accessed */
+  long long stride;           /* bytes between the last two accesses */
+  int confidence;             /* times in a row stride repeated, at most 3 */
+} pf_stride_t;
+
+/* Type: Stream buffer */
+typedef struct pf_stream {
+  int valid;
+  int dir;                    /* +1 or -1, 0 until a second miss */
+  mem_addr_t last;            /* block of the last miss it followed */
+  mem_addr_t next;            /* next block to prefetch */
+  unsigned long long stamp;   /* last use, the oldest is reallocated */
+} pf_stream_t;
+
+/* Type: One prefetcher and what became of its prefetches */
+typedef struct prefetcher {
+  int kind;                   /* one of PF_* */
+  int degree;                 /* blocks prefetched per trigger */
+  int distance;               /* how far ahead the first one is */
+  pf_stride_t *table;         /* PF_STRIDE only */
+  pf_stream_t *streams;       /* PF_STREAM only */
+  unsigned long long issued;    /* blocks brought in */
+  unsigned long long useful;    /* demanded after they arrived */
+  unsigned long long late;      /* demanded before they arrived */
+  unsigned long long unused;    /* evicted without being demanded */
+  unsigned long long polluting; /* evicted a block demanded again later */
+} prefetcher_t;
+
+/* Type: Prefetchers attached to a cache
+ * Time is counted in demand accesses. Every line remembers which
+ * prefetcher brought it in until it is demanded, and a small filter
+ * remembers the blocks prefetches evicted.
+ */
+typedef struct prefetch {
+  cache_t *cache;
+  int latency;                /* accesses a prefetch takes to arrive */
+  int n;
+  prefetcher_t pf[PF_MAX];
+  unsigned long long now;     /* demand accesses so far */
+  unsigned char *owner;       /* per line, prefetcher + 1, 0 => none */
+  unsigned long long *ready;  /* per line, when its prefetch arrives */
+  mem_addr_t *filter;         /* blocks evicted by prefetches */
+  unsigned char *filter_owner;
+  unsigned long long filter_mask;
+} prefetch_t;
+
+int prefetch_init(prefetch_t *prefetch, cache_t *cache, int latency);
+int prefetch_parse(const char *name);
+int prefetch_add(prefetch_t *prefetch, int kind, int degree, int distance);
+int prefetch_access(prefetch_t *prefetch, mem_addr_t addr);
+void prefetch_print(const prefetch_t *prefetch, unsigned long long misses,
+                    FILE *fp);
+void prefetch_free(prefetch_t *prefetch);
+
+#endif // __prefetch_h__
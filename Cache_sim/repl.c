@@ -0,0 +1,313 @@
+////////////////////////////////////////////////////////////////////////////////
+// Main File:        csim.c
+// This File:        repl.c
+// Other Files:      csim.c repl.h cache.c cache.h
+// Semester:         CS 354 Fall 2018
+//
+// Author:           Yuanhang Wang
+// Email:            wang2243@wisc.edu
+// CS Login:         ywang
+//
+/////////////////////////// OTHER SOURCES OF HELP //////////////////////////////
+//                   fully acknowledge and credit all sources of help,
+//                   other than Instructors and TAs.
+//
+// Persons:          Identify persons by name, relationship to you, and email.
+//                   Describe in detail the the ideas and help they provided.
+//
+// Online sources:   avoid web searches to solve your problems, but if you do
+//                   search, be sure to include Web URLs and description of
+//                   of any information you find.
+//////////////////////////// 80 columns wide ///////////////////////////////////
+
+/*
+ * repl.c - Replacement policies other than LRU (see repl.h).
+ *
+ * LRU stays inline in cache.c. The others keep only what hardware would
+ * per set:
+ *   plru:   a binary tree of E - 1 bits, each pointing to the half of its
+ *           subtree to evict from; an access points every bit on its path
+ *           away from it. E need not be a power of two, the tree is
+ *           built for the next one and never leads to a missing way.
+ *   srrip:  a 2-bit re-reference prediction value (RRPV) per line. Hits
+ *           set it to 0, fills to 2, and the victim is a line at 3 after
+ *           ageing the set until one is.
+ *   brrip:  likewise, but fills at 3 and only one in 32 at 2, so a scan
+ *           cannot flush the set.
+ *   drrip:  SRRIP and BRRIP each own some leader sets, and a saturating
+ *           counter of their misses picks the one the other sets use.
+ *           With 64 sets or more there are 32 leaders of each, with
+ *           fewer every set leads.
+ *   fifo:   the way filled least recently, as a per-set round robin.
+ *   random: a way from a xorshift generator with a fixed seed.
+ *   opt:    Belady's: the line whose block is next used furthest in the
+ *           future. Needs cache->next_use, from repl_next_use.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "repl.h"
+
+#define RRPV_MAX 3     /* 2-bit RRPVs */
+#define PSEL_MAX 512   /* DRRIP counter range is [-PSEL_MAX, PSEL_MAX) */
+
+static inline unsigned char *set_meta(const cache_t *cache, mem_addr_t set) {
+  return cache->meta + set * cache->meta_stride;
+}
+
+/*
+ * next_random - the next number of the xorshift64* generator of 'cache'
+ */
+static unsigned long long next_random(cache_t *cache) {
+  if (cache->rng == 0)
+    cache->rng = 0x2545F4914F6CDD1DULL;
+  cache->rng ^= cache->rng >> 12;
+  cache->rng ^= cache->rng << 25;
+  cache->rng ^= cache->rng >> 27;
+  return cache->rng * 0x2545F4914F6CDD1DULL;
+}
+
+static void no_hit(cache_t *cache, mem_addr_t set, int way) {
+}
+
+/* Tree pseudo-LRU. Node n has children 2n and 2n + 1, the leaves are
+ * P + way where P is E rounded up to a power of two, and bit n set means
+ * evict from the right.
+ */
+static inline int plru_leaves(int E) {
+  return E == 1 ? 1 : 1 << (32 - __builtin_clz(E - 1));
+}
+
+static size_t plru_meta(int E) {
+  return (plru_leaves(E) + 7) / 8;
+}
+
+static void plru_hit(cache_t *cache, mem_addr_t set, int way) {
+  unsigned char *bits = set_meta(cache, set);
+  for (unsigned int n = plru_leaves(cache->E) + way; n > 1; n >>= 1) {
+    unsigned int parent = n >> 1;
+    if (n & 1)
+      bits[parent >> 3] &= ~(1 << (parent & 7));
+    else
+      bits[parent >> 3] |= 1 << (parent & 7);
+  }
+}
+
+static int plru_victim(cache_t *cache, mem_addr_t set) {
+  const unsigned char *bits = set_meta(cache, set);
+  unsigned int leaves = plru_leaves(cache->E);
+  int depth = __builtin_ctz(leaves);
+  unsigned int n = 1;
+  while (n < leaves) {
+    unsigned int child = 2 * n + (bits[n >> 3] >> (n & 7) & 1);
+    // The left child always starts at a real way, the right may not
+    if ((child << --depth) - leaves >= (unsigned int) cache->E)
+      child &= ~1U;
+    n = child;
+  }
+  return n - leaves;
+}
+
+/* RRIP: one RRPV byte per line */
+static size_t rrip_meta(int E) {
+  return E;
+}
+
+static void rrip_hit(cache_t *cache, mem_addr_t set, int way) {
+  set_meta(cache, set)[way] = 0;
+}
+
+static int rrip_victim(cache_t *cache, mem_addr_t set) {
+  unsigned char *rrpv = set_meta(cache, set);
+  int victim = 0;
+  for (int i = 1; i < cache->E; i++)
+    if (rrpv[i] > rrpv[victim])
+      victim = i;
+  // Age the set in one step as far as the search for a line at RRPV_MAX
+  // would
+  unsigned char age = RRPV_MAX - rrpv[victim];
+  if (age != 0)
+    for (int i = 0; i < cache->E; i++)
+      rrpv[i] += age;
+  return victim;
+}
+
+static void srrip_fill(cache_t *cache, mem_addr_t set, int way) {
+  set_meta(cache, set)[way] = RRPV_MAX - 1;
+}
+
+static void brrip_fill(cache_t *cache, mem_addr_t set, int way) {
+  set_meta(cache, set)[way] = next_random(cache) & 31 ? RRPV_MAX
+                                                      : RRPV_MAX - 1;
+}
+
+/*
+ * leader - the policy set 'set' always uses, REPL_SRRIP or REPL_BRRIP, or
+ *   REPL_DRRIP if it follows the counter
+ */
+static int leader(const cache_t *cache, mem_addr_t set) {
+  mem_addr_t mask = cache->S >= 64 ? cache->S / 32 - 1 : 1;
+  if ((set & mask) == 0)
+    return REPL_SRRIP;
+  return (set & mask) == 1 ? REPL_BRRIP : REPL_DRRIP;
+}
+
+static void drrip_fill(cache_t *cache, mem_addr_t set, int way) {
+  int policy = leader(cache, set);
+  // Every fill is a miss of the set's policy
+  if (policy == REPL_SRRIP && cache->psel < PSEL_MAX - 1)
+    cache->psel++;
+  else if (policy == REPL_BRRIP && cache->psel > -PSEL_MAX)
+    cache->psel--;
+  if (policy == REPL_DRRIP)
+    policy = cache->psel > 0 ? REPL_BRRIP : REPL_SRRIP;
+  if (policy == REPL_SRRIP)
+    srrip_fill(cache, set, way);
+  else
+    brrip_fill(cache, set, way);
+}
+
+/* FIFO: the next way to replace */
+static size_t fifo_meta(int E) {
+  return sizeof(unsigned int);
+}
+
+static void fifo_fill(cache_t *cache, mem_addr_t set, int way) {
+  unsigned int *next = (unsigned int *) set_meta(cache, set);
+  if ((unsigned int) way == *next)
+    *next = (way + 1) % cache->E;
+}
+
+static int fifo_victim(cache_t *cache, mem_addr_t set) {
+  return *(unsigned int *) set_meta(cache, set);
+}
+
+/* Random */
+static size_t random_meta(int E) {
+  return 0;
+}
+
+static void random_fill(cache_t *cache, mem_addr_t set, int way) {
+}
+
+static int random_victim(cache_t *cache, mem_addr_t set) {
+  return next_random(cache) % cache->E;
+}
+
+/* OPT: the next use of the block of every line */
+static size_t opt_meta(int E) {
+  return E * sizeof(unsigned long long);
+}
+
+static void opt_hit(cache_t *cache, mem_addr_t set, int way) {
+  unsigned long long *next = (unsigned long long *) set_meta(cache, set);
+  next[way] = cache->next_use[cache->tick++];
+}
+
+static int opt_victim(cache_t *cache, mem_addr_t set) {
+  const unsigned long long *next = (unsigned long long *) set_meta(cache,
+                                                                   set);
+  int victim = 0;
+  for (int i = 1; i < cache->E; i++)
+    if (next[i] > next[victim])
+      victim = i;
+  return victim;
+}
+
+const repl_ops_t repl_ops[REPL_COUNT] = {
+  [REPL_LRU]    = {"lru", 1, NULL, NULL, NULL, NULL},
+  [REPL_PLRU]   = {"plru", 1, plru_meta, plru_hit, plru_hit, plru_victim},
+  [REPL_SRRIP]  = {"srrip", 1, rrip_meta, rrip_hit, srrip_fill, rrip_victim},
+  [REPL_BRRIP]  = {"brrip", 0, rrip_meta, rrip_hit, brrip_fill, rrip_victim},
+  [REPL_DRRIP]  = {"drrip", 0, rrip_meta, rrip_hit, drrip_fill, rrip_victim},
+  [REPL_FIFO]   = {"fifo", 1, fifo_meta, no_hit, fifo_fill, fifo_victim},
+  [REPL_RANDOM] = {"random", 0, random_meta, no_hit, random_fill,
+                   random_victim},
+  [REPL_OPT]    = {"opt", 0, opt_meta, opt_hit, opt_hit, opt_victim},
+};
+
+/*
+ * repl_parse - return the REPL_* policy called 'name', or -1 if none is
+ */
+int repl_parse(const char *name) {
+  for (int i = 0; i < REPL_COUNT; i++)
+    if (strcmp(name, repl_ops[i].name) == 0)
+      return i;
+  return -1;
+}
+
+static inline unsigned long long hash_block(mem_addr_t block,
+                                            unsigned long long mask) {
+  unsigned long long h = block * 0x9E3779B97F4A7C15ULL;
+  return (h ^ h >> 29) & mask;
+}
+
+/*
+ * repl_next_use - for each of the 'n' accesses in 'addrs' store in
+ *   next_use the index of the next access to the same 2^b-byte block, or
+ *   NEVER
+ *   Walks the accesses backwards with a table from block to the latest
+ *   access seen, which grows with the number of distinct blocks
+ *   Returns 0 on success, -1 if memory runs out
+ */
+int repl_next_use(const mem_addr_t *addrs, size_t n, int b,
+                  unsigned long long *next_use) {
+  size_t slots = 1024, used = 0;
+  mem_addr_t *blocks = malloc(slots * sizeof(mem_addr_t));
+  unsigned long long *last = malloc(slots * sizeof(unsigned long long));
+  if (blocks == NULL || last == NULL)
+    goto fail;
+  // Block numbers are below 2^63, so TAG_INVALID marks an empty slot
+  memset(blocks, 0xff, slots * sizeof(mem_addr_t));
+
+  for (size_t i = n; i-- > 0;) {
+    if (2 * used >= slots) {
+      // Rehash into a table twice the size
+      size_t new_slots = 2 * slots;
+      mem_addr_t *new_blocks = malloc(new_slots * sizeof(mem_addr_t));
+      unsigned long long *new_last = malloc(new_slots
+                                            * sizeof(unsigned long long));
+      if (new_blocks == NULL || new_last == NULL) {
+        free(new_blocks);
+        free(new_last);
+        goto fail;
+      }
+      memset(new_blocks, 0xff, new_slots * sizeof(mem_addr_t));
+      for (size_t j = 0; j < slots; j++) {
+        if (blocks[j] == TAG_INVALID)
+          continue;
+        unsigned long long k = hash_block(blocks[j], new_slots - 1);
+        while (new_blocks[k] != TAG_INVALID)
+          k = (k + 1) & (new_slots - 1);
+        new_blocks[k] = blocks[j];
+        new_last[k] = last[j];
+      }
+      free(blocks);
+      free(last);
+      blocks = new_blocks;
+      last = new_last;
+      slots = new_slots;
+    }
+
+    mem_addr_t block = addrs[i] >> b;
+    unsigned long long k = hash_block(block, slots - 1);
+    while (blocks[k] != TAG_INVALID && blocks[k] != block)
+      k = (k + 1) & (slots - 1);
+    if (blocks[k] == block) {
+      next_use[i] = last[k];
+    } else {
+      next_use[i] = NEVER;
+      blocks[k] = block;
+      used++;
+    }
+    last[k] = i;
+  }
+  free(blocks);
+  free(last);
+  return 0;
+
+fail:
+  free(blocks);
+  free(last);
+  return -1;
+}
@@ -0,0 +1,64 @@
+////////////////////////////////////////////////////////////////////////////////
+// Main File:        csim.c
+// This File:        repl.h
+// Other Files:      csim.c repl.c cache.c cache.h
+// Semester:         CS 354 Fall 2018
+//
+// Author:           Yuanhang Wang
+// Email:            wang2243@wisc.edu
+// CS Login:         ywang
+//
+/////////////////////////// OTHER SOURCES OF HELP //////////////////////////////
+//                   fully acknowledge and credit all sources of help,
+//                   other than Instructors and TAs.
+//
+// Persons:          Identify persons by name, relationship to you, and email.
+//                   Describe in detail the the ideas and help they provided.
+//
+// Online sources:   avoid web searches to solve your problems, but if you do
+//                   search, be sure to include Web URLs and description of
+//                   of any information you find.
+//////////////////////////// 80 columns wide ///////////////////////////////////
+
+#ifndef __repl_h__
+#define __repl_h__
+
+#include <stddef.h>
+#include "cache.h"
+
+/* Replacement policies */
+#define REPL_LRU    0  /* least recently used, built into cache.c */
+#define REPL_PLRU   1  /* tree pseudo-LRU */
+#define REPL_SRRIP  2  /* static re-reference interval prediction */
+#define REPL_BRRIP  3  /* bimodal RRIP */
+#define REPL_DRRIP  4  /* SRRIP or BRRIP picked by set dueling */
+#define REPL_FIFO   5
+#define REPL_RANDOM 6
+#define REPL_OPT    7  /* Belady's optimal, needs the next use of accesses */
+#define REPL_COUNT  8
+
+#define NEVER (~0ULL)  /* next use of a block that is not used again */
+
+/* Type: Replacement policy
+ * The cache takes an empty line of the set when there is one and only
+ * asks the policy for a victim when the set is full. Every hit and every
+ * fill is reported, with 'way' counted from the first line of the set.
+ * A policy keeps its state in the meta_bytes(E) bytes of the set at
+ * cache->meta + set * cache->meta_stride.
+ */
+typedef struct repl_ops {
+  const char *name;
+  int per_set;                /* nonzero => no state shared between sets */
+  size_t (*meta_bytes)(int E);
+  void (*hit)(cache_t *cache, mem_addr_t set, int way);
+  void (*fill)(cache_t *cache, mem_addr_t set, int way);
+  int (*victim)(cache_t *cache, mem_addr_t set);
+} repl_ops_t;
+
+extern const repl_ops_t repl_ops[REPL_COUNT];
+
+int repl_parse(const char *name);
+int repl_next_use(const mem_addr_t *addrs, size_t n, int b,
+                  unsigned long long *next_use);
+
+#endif // __repl_h__
@@ -0,0 +1,76 @@
+////////////////////////////////////////////////////////////////////////////////
+// Main File:        csim.c
+// This File:        ring.h
+// Other Files:      parallel.c parallel.h cache.h
+// Semester:         CS 354 Fall 2018
+//
+// Author:           Yuanhang Wang
+// Email:            wang2243@wisc.edu
+// CS Login:         ywang
+//
+/////////////////////////// OTHER SOURCES OF HELP //////////////////////////////
+//                   fully acknowledge and credit all sources of help,
+//                   other than Instructors and TAs.
+//
+// Persons:          Identify persons by name, relationship to you, and email.
+//                   Describe in detail the the ideas and help they provided.
+//
+// Online sources:   avoid web searches to solve your problems, but if you do
+//                   search, be sure to include Web URLs and description of
+//                   of any information you find.
+//////////////////////////// 80 columns wide ///////////////////////////////////
+
+#ifndef __ring_h__
+#define __ring_h__
+
+#include <stddef.h>
+#include "cache.h"
+
+/* Type: Single-producer single-consumer ring of addresses
+ * 'head' only moves forward by the producer and 'tail' only by the
+ * consumer, each published with a release store and read with an acquire
+ * load, so no lock is needed. They count entries ever pushed and popped;
+ * the slot of entry i is i & mask. The two live on separate cache lines so
+ * that the threads do not bounce one line between them.
+ */
+typedef struct ring {
+  mem_addr_t *slots;
+  size_t mask;                                  /* capacity - 1 */
+  size_t head __attribute__((aligned(64)));     /* next entry to push */
+  size_t tail __attribute__((aligned(64)));     /* next entry to pop */
+  int done __attribute__((aligned(64)));        /* no more pushes if set */
+} ring_t;
+
+/*
+ * ring_push - append up to 'n' addresses from 'src'
+ *   Returns how many fit
+ */
+static inline size_t ring_push(ring_t *ring, const mem_addr_t *src,
+                               size_t n) {
+  size_t head = ring->head;
+  size_t room = ring->mask + 1
+                - (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE));
+  if (n > room)
+    n = room;
+  for (size_t i = 0; i < n; i++)
+    ring->slots[(head + i) & ring->mask] = src[i];
+  __atomic_store_n(&ring->head, head + n, __ATOMIC_RELEASE);
+  return n;
+}
+
+/*
+ * ring_pop - take up to 'max' addresses into 'dst'
+ *   Returns how many there were
+ */
+static inline size_t ring_pop(ring_t *ring, mem_addr_t *dst, size_t max) {
+  size_t tail = ring->tail;
+  size_t n = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - tail;
+  if (n > max)
+    n = max;
+  for (size_t i = 0; i < n; i++)
+    dst[i] = ring->slots[(tail + i) & ring->mask];
+  __atomic_store_n(&ring->tail, tail + n, __ATOMIC_RELEASE);
+  return n;
+}
+
+#endif // __ring_h__
@@ -0,0 +1,267 @@
+////////////////////////////////////////////////////////////////////////////////
+// Main File:        csim.c
+// This File:        sample.c
+// Other Files:      csim.c libcsim.c libcsim.h sample.h cache.c cache.h
+// Semester:         CS 354 Fall 2018
+//
+// Author:           Yuanhang Wang
+// Email:            wang2243@wisc.edu
+// CS Login:         ywang
+//
+/////////////////////////// OTHER SOURCES OF HELP //////////////////////////////
+//                   fully acknowledge and credit all sources of help,
+//                   other than Instructors and TAs.
+//
+// Persons:          Identify persons by name, relationship to you, and email.
+//                   Describe in detail the the ideas and help they provided.
+//
+// Online sources:   avoid web searches to solve your problems, but if you do
+//                   search, be sure to include Web URLs and description of
+//                   of any information you find.
+//////////////////////////// 80 columns wide ///////////////////////////////////
+
+/*
+ * sample.c - Estimating the miss rate of a cache from part of the
+ *     accesses, with confidence intervals.
+ *
+ * Set sampling simulates only the accesses to 1 in k sets, picked at
+ * random so that strided patterns do not alias with the picking. Since
+ * sets share no state, the picked sets behave exactly as in the full
+ * cache, and each is a cluster of accesses drawn from the S sets.
+ *
+ * Interval sampling splits the trace into periods of data records, each
+ * of which skips some records, simulates some more only to warm the cache
+ * up and then measures a detailed interval. By default the whole gap is
+ * warm-up, which keeps the cache state exact; a shorter warm-up lets the
+ * reader skip the rest (see trace_skip) at the cost of cold misses
+ * counted in the detailed intervals. Each interval is a cluster.
+ *
+ * Either way the rates are ratio estimates, measured misses over measured
+ * accesses, whose variance comes from how much the clusters disagree:
+ *
+ *     r = sum(m) / sum(a)
+ *     s^2 = sum((m - r a)^2) / (n - 1)
+ *     var(r) = (1 - n / N) s^2 / (n abar^2)
+ *
+ * for n clusters out of N, abar being their mean number of accesses. The
+ * intervals are r +- t sqrt(var(r)), t being the 95% quantile of Student's
+ * t with n - 1 degrees of freedom, as few clusters leave s^2 itself
+ * uncertain.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sample.h"
+
+/* Two-sided 95% quantiles of Student's t with 1 to 30 degrees of
+ * freedom, beyond which the normal 1.96 is close enough */
+static const double t95[31] = {
+  0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+  2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+  2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+};
+
+/*
+ * add_cluster - add a cluster of 'counts' (accesses, misses, evictions) to
+ *   the sums
+ */
+static void add_cluster(sample_sums_t *sums, const unsigned long long *counts) {
+  double a = counts[0];
+  sums->n++;
+  for (int k = 0; k < 3; k++) {
+    double y = counts[k];
+    sums->sum[k] += y;
+    sums->sq[k] += y * y;
+    sums->cross[k] += a * y;
+  }
+}
+
+/*
+ * sample_init_sets - sample 1 in 'ratio' of the 2^s sets of a cache with
+ *   2^b-byte blocks, at least one
+ *   Returns 0 on success, -1 if 'ratio' is not positive or out of memory
+ */
+int sample_init_sets(sample_t *sample, int s, int b, int ratio) {
+  memset(sample, 0, sizeof(sample_t));
+  if (ratio < 1)
+    return -1;
+  size_t nsets = (size_t) 1 << s;
+  sample->kind = SAMPLE_SETS;
+  sample->b = b;
+  sample->set_mask = nsets - 1;
+  sample->npicked = nsets / ratio ? nsets / ratio : 1;
+  sample->picked = calloc(nsets, 1);
+  sample->set_counts = calloc(nsets, sizeof(sample->set_counts[0]));
+  size_t *order = malloc(nsets * sizeof(size_t));
+  if (sample->picked == NULL || sample->set_counts == NULL || order == NULL) {
+    free(order);
+    sample_free(sample);
+    return -1;
+  }
+
+  // The first npicked sets of a shuffle, seeded so runs repeat
+  unsigned long long rng = 0x9E3779B97F4A7C15ULL;
+  for (size_t i = 0; i < nsets; i++)
+    order[i] = i;
+  for (size_t i = 0; i < sample->npicked; i++) {
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    size_t j = i + rng % (nsets - i);
+    size_t tmp = order[i];
+    order[i] = order[j];
+    order[j] = tmp;
+    sample->picked[order[i]] = 1;
+  }
+  free(order);
+  return 0;
+}
+
+/*
+ * sample_init_intervals - sample a detailed interval of 'detail' data
+ *   records every 'period', after 'warm' of warm-up
+ *   'detail' + 'warm' must not exceed 'period'
+ */
+void sample_init_intervals(sample_t *sample, unsigned long long period,
+                           unsigned long long detail,
+                           unsigned long long warm) {
+  memset(sample, 0, sizeof(sample_t));
+  sample->kind = SAMPLE_INTERVALS;
+  sample->period = period;
+  sample->warm = warm;
+  sample->skip = period - detail - warm;
+}
+
+/*
+ * sample_count - count a measured access to 'addr' with outcome 'result'
+ */
+void sample_count(sample_t *sample, mem_addr_t addr, int result) {
+  unsigned long long *counts = sample->kind == SAMPLE_SETS
+      ? sample->set_counts[(addr >> sample->b) & sample->set_mask]
+      : sample->cur;
+  counts[0]++;
+  if (result != CACHE_HIT)
+    counts[1]++;
+  if (result == CACHE_EVICT)
+    counts[2]++;
+}
+
+/*
+ * sample_advance - move interval sampling on by 'records' data records,
+ *   closing the detailed intervals that end
+ */
+void sample_advance(sample_t *sample, unsigned long long records) {
+  while (records > 0) {
+    if (sample->pos == 0)
+      sample->periods++;
+    unsigned long long step = sample->period - sample->pos;
+    if (step > records)
+      step = records;
+    sample->pos += step;
+    records -= step;
+    if (sample->pos == sample->period) {
+      add_cluster(&sample->sums, sample->cur);
+      memset(sample->cur, 0, sizeof(sample->cur));
+      sample->pos = 0;
+    }
+  }
+}
+
+/*
+ * sample_finish - fold the per-set counts, or the interval the trace ended
+ *   in, into the sums
+ */
+void sample_finish(sample_t *sample) {
+  if (sample->kind == SAMPLE_SETS) {
+    for (size_t set = 0; set <= sample->set_mask; set++)
+      if (sample->picked[set])
+        add_cluster(&sample->sums, sample->set_counts[set]);
+  } else if (sample->pos > sample->skip + sample->warm) {
+    // Cut short, but as much a cluster as the others
+    add_cluster(&sample->sums, sample->cur);
+    memset(sample->cur, 0, sizeof(sample->cur));
+  }
+}
+
+/*
+ * sample_estimate - estimate the hit, miss and eviction rates into
+ *   rate[CACHE_HIT/MISS/EVICT], where MISS counts all misses, and the
+ *   half widths of their 95% intervals into 'half', -1 if there are too
+ *   few clusters to tell
+ *   Returns 0 on success, -1 if nothing was measured
+ */
+int sample_estimate(const sample_t *sample, double rate[3], double half[3]) {
+  const sample_sums_t *sums = &sample->sums;
+  if (sums->sum[0] == 0)
+    return -1;
+
+  // The population of clusters: every set, or every interval of the
+  // detailed length the trace has room for
+  double n = sums->n, population;
+  if (sample->kind == SAMPLE_SETS) {
+    population = sample->set_mask + 1.0;
+  } else {
+    double detail = sample->period - sample->skip - sample->warm;
+    population = (double) sample->periods * sample->period / detail;
+  }
+  double fpc = n < population ? 1 - n / population : 0;
+  double abar = sums->sum[0] / n;
+
+  for (int k = 1; k < 3; k++) {
+    double r = sums->sum[k] / sums->sum[0];
+    rate[k] = r;
+    half[k] = -1;
+    if (n >= 2) {
+      double ss = sums->sq[k] - 2 * r * sums->cross[k]
+                  + r * r * sums->sq[0];
+      double var = fpc * (ss > 0 ? ss : 0) / (n - 1) / (n * abar * abar);
+      half[k] = (n <= 30 ? t95[(int) n - 1] : 1.96) * sqrt(var);
+    }
+  }
+  rate[CACHE_HIT] = 1 - rate[CACHE_MISS];
+  half[CACHE_HIT] = half[CACHE_MISS];
+  return 0;
+}
+
+/*
+ * sample_print - print how much was sampled and the estimated rates with
+ *   their 95% intervals to 'fp'
+ */
+void sample_print(const sample_t *sample, FILE *fp) {
+  static const char *names[3] = {"hit rate", "miss rate", "eviction rate"};
+  double rate[3], half[3];
+
+  if (sample->kind == SAMPLE_SETS)
+    fprintf(fp, "set sampling: %zu of %llu sets", sample->npicked,
+            (unsigned long long) sample->set_mask + 1);
+  else
+    fprintf(fp, "interval sampling: %llu intervals of %llu records, every "
+            "%llu after %llu of warm-up",
+            sample->sums.n, sample->period - sample->skip - sample->warm,
+            sample->period, sample->warm);
+  fprintf(fp, ", %llu of %llu accesses measured\n",
+          (unsigned long long) sample->sums.sum[0], sample->total);
+  if (sample_estimate(sample, rate, half) != 0) {
+    fprintf(fp, "nothing measured, no estimate\n");
+    return;
+  }
+  fprintf(fp, "%-14s %9s %10s\n", "", "estimate", "95% CI");
+  for (int k = 0; k < 3; k++) {
+    if (half[k] < 0)
+      fprintf(fp, "%-14s %8.3f%% %10s\n", names[k], 100 * rate[k], "n/a");
+    else
+      fprintf(fp, "%-14s %8.3f%%  +-%6.3f%%\n", names[k], 100 * rate[k],
+              100 * half[k]);
+  }
+}
+
+/*
+ * sample_free - free what sample_init_sets allocated
+ */
+void sample_free(sample_t *sample) {
+  free(sample->picked);
+  free(sample->set_counts);
+  sample->picked = NULL;
+  sample->set_counts = NULL;
+}
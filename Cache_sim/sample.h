@@ -0,0 +1,102 @@
+////////////////////////////////////////////////////////////////////////////////
+// Main File:        csim.c
+// This File:        sample.h
+// Other Files:      csim.c libcsim.c libcsim.h sample.c cache.c cache.h
+// Semester:         CS 354 Fall 2018
+//
+// Author:           Yuanhang Wang
+// Email:            wang2243@wisc.edu
+// CS Login:         ywang
+//
+/////////////////////////// OTHER SOURCES OF HELP //////////////////////////////
+//                   fully acknowledge and credit all sources of help,
+//                   other than Instructors and TAs.
+//
+// Persons:          Identify persons by name, relationship to you, and email.
+//                   Describe in detail the the ideas and help they provided.
+//
+// Online sources:   avoid web searches to solve your problems, but if you do
+//                   search, be sure to include Web URLs and description of
+//                   of any information you find.
+//////////////////////////// 80 columns wide ///////////////////////////////////
+
+#ifndef __sample_h__
+#define __sample_h__
+
+#include <stdio.h>
+#include "cache.h"
+
+/* Sampling kinds */
+#define SAMPLE_SETS      1  /* simulate a subset of the sets */
+#define SAMPLE_INTERVALS 2  /* simulate periodic intervals of the trace */
+
+/* Phases of an interval sampling period, in this order */
+#define PHASE_SKIP   0  /* not simulated */
+#define PHASE_WARM   1  /* simulated, not counted */
+#define PHASE_DETAIL 2  /* simulated and counted */
+
+/* Type: Sums over the clusters (sets or intervals) measured so far, for
+ * the ratio estimates of the miss and eviction rates
+ * Index 0 is accesses, 1 misses and 2 evictions.
+ */
+typedef struct sample_sums {
+  unsigned long long n;       /* clusters */
+  double sum[3];
+  double sq[3];               /* sums of squares */
+  double cross[3];            /* sums of products with the accesses */
+} sample_sums_t;
+
+/* Type: Sampler of one cache */
+typedef struct sample {
+  int kind;                   /* one of SAMPLE_* */
+  unsigned long long total;   /* accesses in the trace, simulated or not */
+  sample_sums_t sums;
+
+  /* Set sampling */
+  int b;
+  mem_addr_t set_mask;
+  unsigned char *picked;      /* nonzero => the set is simulated */
+  size_t npicked;
+  unsigned long long (*set_counts)[3];  /* per set, as in sample_sums_t */
+
+  /* Interval sampling, each period skips, warms up then measures */
+  unsigned long long period;  /* data records per period */
+  unsigned long long skip;    /* of which skipped */
+  unsigned long long warm;    /* of which simulated without counting */
+  unsigned long long pos;     /* data records into the current period */
+  unsigned long long periods; /* periods begun */
+  unsigned long long cur[3];  /* counts of the current detailed interval */
+} sample_t;
+
+int sample_init_sets(sample_t *sample, int s, int b, int ratio);
+void sample_init_intervals(sample_t *sample, unsigned long long period,
+                           unsigned long long detail,
+                           unsigned long long warm);
+
+/*
+ * sample_picked - whether the set of 'addr' is simulated under set
+ *   sampling
+ */
+static inline int sample_picked(const sample_t *sample, mem_addr_t addr) {
+  return sample->picked[(addr >> sample->b) & sample->set_mask];
+}
+
+/*
+ * sample_phase - the phase of the next data record under interval
+ *   sampling
+ */
+static inline int sample_phase(const sample_t *sample) {
+  if (sample->pos < sample->skip)
+    return PHASE_SKIP;
+  return sample->pos < sample->skip + sample->warm ? PHASE_WARM
+                                                   : PHASE_DETAIL;
+}
+
+void sample_count(sample_t *sample, mem_addr_t addr, int result);
+void sample_advance(sample_t *sample, unsigned long long records);
+void sample_finish(sample_t *sample);
+int sample_estimate(const sample_t *sample, double rate[3], double half[3]);
+void sample_print(const sample_t *sample, FILE *fp);
+void sample_free(sample_t *sample);
+
+#endif // __sample_h__
@@ -0,0 +1,392 @@
+////////////////////////////////////////////////////////////////////////////////
+// Main File:        csim.c
+// This File:        series.c
+// Other Files:      csim.c libcsim.c libcsim.h series.h conv.c cache.h
+// Semester:         CS 354 Fall 2018
+//
+// Author:           Yuanhang Wang
+// Email:            wang2243@wisc.edu
+// CS Login:         ywang
+//
+/////////////////////////// OTHER SOURCES OF HELP //////////////////////////////
+//                   fully acknowledge and credit all sources of help,
+//                   other than Instructors and TAs.
+//
+// Persons:          Identify persons by name, relationship to you, and email.
+//                   Describe in detail the the ideas and help they provided.
+//
+// Online sources:   avoid web searches to solve your problems, but if you do
+//                   search, be sure to include Web URLs and description of
+//                   of any information you find.
+//////////////////////////// 80 columns wide ///////////////////////////////////
+
+/*
+ * series.c - Statistics of every interval of N accesses, and the phases
+ *     of the trace they reveal.
+ *
+ * Each interval records its hits, misses and evictions, how many distinct
+ * blocks it accessed and the median time between uses of a block. The
+ * last two come from a sample of the blocks, those whose hash falls below
+ * a threshold, as in SHARDS: a sampled block is always sampled, so its
+ * every use is seen, and the distinct sampled blocks times the sampling
+ * ratio estimate the working set. A hash table keeps the time of the
+ * latest access to each sampled block in the interval, which gives the
+ * reuse time, the accesses since its previous use, a cheap stand-in for
+ * the reuse (stack) distance that phases change in the same way. The
+ * table is emptied at the end of each interval, so it stays small enough
+ * to stay in the cache, and a block's first use in an interval counts as
+ * a first use whatever came before: an interval warming up the cache
+ * looks like the rest of its phase. Only 1 in 128 accesses reach the
+ * table, and the hits and misses of an interval are what the simulation
+ * counted between its ends, so the series costs a multiply and two
+ * compares per access.
+ *
+ * An interval's signature is its miss rate and the distribution of its
+ * sampled reuse times over 32 log2 buckets, first uses in a bucket of
+ * their own beyond the longest. Intervals join the phase whose mean
+ * signature is the nearest, or start a new one if none is within the
+ * threshold, the distance being
+ *
+ *     |m - m'| + sum(|R_k - R'_k|) / 32
+ *
+ * R being the cumulative shares of the buckets, so that the reuse term is
+ * the earth mover's distance: reuse times that double cost 1/32, while
+ * the noise of a few hundred samples, which spills into the neighbouring
+ * buckets, costs little. Both terms range from 0 to 1. Phases recur: a
+ * loop nest that comes back later lands in its earlier phase.
+ *
+ * The intervals are kept as columns and written column after column,
+ * each value a varint (see series.h), which csim-conv prints as CSV.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "series.h"
+
+static const char *column_names[SERIES_COLUMNS] = {
+  "accesses", "hits", "misses", "evictions", "blocks", "reuse", "phase"
+};
+
+static inline size_t hash_block(mem_addr_t block, size_t size) {
+  unsigned long long h = block * SERIES_HASH;
+  return (h ^ h >> 31) & (size - 1);
+}
+
+/*
+ * series_init - set up 'series' for intervals of 'length' accesses to
+ *   blocks of 2^b bytes, a signature farther than 'threshold' from every
+ *   phase starting a new one
+ */
+void series_init(series_t *series, unsigned long long length,
+                 double threshold, int b) {
+  memset(series, 0, sizeof(series_t));
+  series->length = length;
+  series->threshold = threshold;
+  series->b = b;
+  series->phase = -1;
+}
+
+/*
+ * grow_table - double the hash table of the sampled blocks
+ *   Returns 0 on success, -1 if out of memory
+ */
+static int grow_table(series_t *series) {
+  size_t size = series->size ? 2 * series->size : 1 << 10;
+  series_entry_t *table = malloc(size * sizeof(series_entry_t));
+  if (table == NULL)
+    return -1;
+  for (size_t i = 0; i < size; i++)
+    table[i].block = TAG_INVALID;
+  for (size_t i = 0; i < series->size; i++) {
+    if (series->table[i].block == TAG_INVALID)
+      continue;
+    size_t k = hash_block(series->table[i].block, size);
+    while (table[k].block != TAG_INVALID)
+      k = (k + 1) & (size - 1);
+    table[k] = series->table[i];
+  }
+  free(series->table);
+  series->table = table;
+  series->size = size;
+  return 0;
+}
+
+/*
+ * series_sample - note the access to the sampled 'block' 'pos' accesses
+ *   into the interval: its reuse time, if the interval accessed it before
+ */
+void series_sample(series_t *series, mem_addr_t block,
+                   unsigned long long pos) {
+  if (series->failed)
+    return;
+  if (2 * (series->used + 1) > series->size && grow_table(series) != 0) {
+    series->failed = 1;
+    return;
+  }
+  size_t k = hash_block(block, series->size);
+  while (series->table[k].block != block
+         && series->table[k].block != TAG_INVALID)
+    k = (k + 1) & (series->size - 1);
+  series_entry_t *entry = &series->table[k];
+  if (entry->block == TAG_INVALID) {
+    entry->block = block;
+    series->used++;
+    series->reuse[0]++;
+  } else {
+    int bucket = 64 - __builtin_clzll(pos - entry->last);
+    series->reuse[bucket < SERIES_BUCKETS ? bucket : SERIES_BUCKETS - 1]++;
+  }
+  entry->last = pos;
+}
+
+/*
+ * median_reuse - the median of the reuse times whose shares by log2
+ *   bucket are 'reuse', first uses left out, rounded down to a power of two
+ *   Returns the median, 0 if there is no reuse
+ */
+static unsigned long long median_reuse(const double *reuse) {
+  double total = 0, sum = 0;
+  for (int k = 1; k < SERIES_BUCKETS; k++)
+    total += reuse[k];
+  for (int k = 1; k < SERIES_BUCKETS && total > 0; k++)
+    if ((sum += reuse[k]) >= total / 2)
+      return 1ULL << (k - 1);
+  return 0;
+}
+
+/*
+ * match_phase - the phase nearest to the signature of miss rate 'miss'
+ *   and reuse shares 'reuse', a new one if none is within the threshold
+ *   and there is room; the reuse only counts if 'sampled' is set
+ *   Returns the index of the phase
+ */
+static int match_phase(series_t *series, double miss, const double *reuse,
+                       int sampled) {
+  int best = -1;
+  double best_distance = 0;
+  for (int p = 0; p < series->nphases; p++) {
+    const series_phase_t *phase = &series->phases[p];
+    double distance = miss > phase->miss ? miss - phase->miss
+                                         : phase->miss - miss;
+    // Earth mover's distance over the buckets, first uses the farthest
+    double cdf = 0, shift = 0;
+    for (int k = 1; k <= SERIES_BUCKETS && sampled; k++) {
+      cdf += reuse[k % SERIES_BUCKETS] - phase->reuse[k % SERIES_BUCKETS];
+      shift += cdf > 0 ? cdf : -cdf;
+    }
+    distance += shift / SERIES_BUCKETS;
+    if (best < 0 || distance < best_distance) {
+      best = p;
+      best_distance = distance;
+    }
+  }
+  if (best >= 0 && (best_distance <= series->threshold
+                    || series->nphases == SERIES_PHASES))
+    return best;
+  memset(&series->phases[series->nphases], 0, sizeof(series_phase_t));
+  return series->nphases++;
+}
+
+/*
+ * add_row - append the values of an interval to the columns
+ *   Returns 0 on success, -1 if out of memory
+ */
+static int add_row(series_t *series, const unsigned long long *values) {
+  if (series->rows == series->rows_size) {
+    size_t size = series->rows_size ? 2 * series->rows_size : 1 << 10;
+    for (int c = 0; c < SERIES_COLUMNS; c++) {
+      unsigned long long *column = realloc(series->columns[c],
+                                           size * sizeof(unsigned long long));
+      if (column == NULL)
+        return -1;
+      series->columns[c] = column;
+    }
+    series->rows_size = size;
+  }
+  for (int c = 0; c < SERIES_COLUMNS; c++)
+    series->columns[c][series->rows] = values[c];
+  series->rows++;
+  return 0;
+}
+
+/*
+ * series_close - end the current interval, the simulation having counted
+ *   'counts' so far: find its phase, add its row and start the next one
+ */
+void series_close(series_t *series, const unsigned long long counts[3]) {
+  unsigned long long values[SERIES_COLUMNS];
+  unsigned long long sampled = 0;
+  double reuse[SERIES_BUCKETS];
+  for (int k = 0; k < SERIES_BUCKETS; k++)
+    sampled += series->reuse[k];
+  for (int k = 0; k < SERIES_BUCKETS; k++)
+    reuse[k] = sampled ? (double) series->reuse[k] / sampled : 0;
+  unsigned long long cur[3];
+  for (int k = 0; k < 3; k++)
+    cur[k] = counts[k] - series->mark[k];
+  values[COL_ACCESSES] = series->pos;
+  values[COL_HITS] = cur[CACHE_HIT];
+  values[COL_MISSES] = cur[CACHE_MISS] + cur[CACHE_EVICT];
+  values[COL_EVICTIONS] = cur[CACHE_EVICT];
+  values[COL_BLOCKS] = (unsigned long long) series->used << SERIES_RATE_BITS;
+  values[COL_REUSE] = median_reuse(reuse);
+  double miss = (double) values[COL_MISSES] / series->pos;
+
+  // Fold the interval into the mean signature of its phase
+  int p = match_phase(series, miss, reuse, sampled > 0);
+  series_phase_t *phase = &series->phases[p];
+  double n = ++phase->intervals;
+  phase->miss += (miss - phase->miss) / n;
+  for (int k = 0; k < SERIES_BUCKETS && sampled; k++)
+    phase->reuse[k] += (reuse[k] - phase->reuse[k]) / n;
+  phase->accesses += values[COL_ACCESSES];
+  phase->misses += values[COL_MISSES];
+  phase->blocks += values[COL_BLOCKS];
+  if (p != series->phase) {
+    phase->runs++;
+    series->changes += series->phase >= 0;
+    series->phase = p;
+  }
+  values[COL_PHASE] = p;
+  if (add_row(series, values) != 0)
+    series->failed = 1;
+
+  series->pos = 0;
+  memcpy(series->mark, counts, sizeof(series->mark));
+  memset(series->reuse, 0, sizeof(series->reuse));
+  for (size_t i = 0; i < series->size; i++)
+    series->table[i].block = TAG_INVALID;
+  series->used = 0;
+}
+
+/*
+ * series_finish - close the last interval, if it has any access, the
+ *   simulation having counted 'counts'
+ *   Returns 0 on success, -1 if memory ran out along the way
+ */
+int series_finish(series_t *series, const unsigned long long counts[3]) {
+  if (series->pos > 0)
+    series_close(series, counts);
+  return series->failed ? -1 : 0;
+}
+
+/*
+ * series_print - print the number of intervals and every phase: how often
+ *   the trace entered it, its miss rate, mean working set and median
+ *   reuse time
+ */
+void series_print(const series_t *series, FILE *fp) {
+  fprintf(fp, "intervals:%zu of %llu accesses, phases:%d, phase "
+          "changes:%llu\n", series->rows, series->length, series->nphases,
+          series->changes);
+  fprintf(fp, "%-5s %9s %6s %12s %8s %10s %9s\n", "phase", "intervals",
+          "runs", "accesses", "miss%", "wss KiB", "reuse");
+  for (int p = 0; p < series->nphases; p++) {
+    const series_phase_t *phase = &series->phases[p];
+    fprintf(fp, "%-5d %9llu %6llu %12llu %8.3f %10.1f %9llu\n", p,
+            phase->intervals, phase->runs, phase->accesses,
+            100.0 * phase->misses / phase->accesses,
+            (double) phase->blocks / phase->intervals
+            * (1ULL << series->b) / 1024, median_reuse(phase->reuse));
+  }
+}
+
+/*
+ * put_varint - write 'value' to 'fp' as a varint
+ */
+static void put_varint(FILE *fp, unsigned long long value) {
+  while (value >= 0x80) {
+    putc((value & 0x7f) | 0x80, fp);
+    value >>= 7;
+  }
+  putc(value, fp);
+}
+
+/*
+ * get_varint - read a varint from 'fp' into *value
+ *   Returns 0 on success, -1 if the file ends or the varint is too long
+ */
+static int get_varint(FILE *fp, unsigned long long *value) {
+  *value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    int c = getc(fp);
+    if (c == EOF)
+      return -1;
+    *value |= (unsigned long long) (c & 0x7f) << shift;
+    if (!(c & 0x80))
+      return 0;
+  }
+  return -1;
+}
+
+/*
+ * series_write - write the intervals to 'fp' in the format of series.h
+ *   Returns 0 on success, -1 on a write error
+ */
+int series_write(const series_t *series, FILE *fp) {
+  fputs(SERIES_MAGIC, fp);
+  put_varint(fp, SERIES_COLUMNS);
+  put_varint(fp, series->rows);
+  put_varint(fp, series->length);
+  for (int c = 0; c < SERIES_COLUMNS; c++) {
+    fputs(column_names[c], fp);
+    putc('\0', fp);
+    for (size_t r = 0; r < series->rows; r++)
+      put_varint(fp, series->columns[c][r]);
+  }
+  return ferror(fp) ? -1 : 0;
+}
+
+/*
+ * series_csv - print the series file 'in' to 'out' as CSV, one line per
+ *   interval, numbered from 0
+ *   Returns 0 on success, -1 if 'in' is not a whole series file
+ */
+int series_csv(FILE *in, FILE *out) {
+  char magic[8], names[SERIES_COLUMNS][16];
+  unsigned long long ncolumns, nrows, length;
+  if (fread(magic, 1, sizeof(magic), in) != sizeof(magic)
+      || memcmp(magic, SERIES_MAGIC, sizeof(magic)) != 0
+      || get_varint(in, &ncolumns) != 0 || get_varint(in, &nrows) != 0
+      || get_varint(in, &length) != 0 || ncolumns != SERIES_COLUMNS
+      || nrows > ((size_t) -1) / sizeof(unsigned long long) / ncolumns)
+    return -1;
+  unsigned long long *values = malloc(nrows * ncolumns
+                                      * sizeof(unsigned long long) + 1);
+  int status = values ? 0 : -1;
+  for (int c = 0; c < SERIES_COLUMNS && status == 0; c++) {
+    size_t len = 0;
+    int ch;
+    while ((ch = getc(in)) != EOF && ch != '\0' && len < sizeof(names[c]) - 1)
+      names[c][len++] = ch;
+    names[c][len] = '\0';
+    if (ch != '\0')
+      status = -1;
+    for (size_t r = 0; r < nrows && status == 0; r++)
+      status = get_varint(in, &values[r * ncolumns + c]);
+  }
+  if (status == 0) {
+    fprintf(out, "interval");
+    for (int c = 0; c < SERIES_COLUMNS; c++)
+      fprintf(out, ",%s", names[c]);
+    fprintf(out, "\n");
+    for (size_t r = 0; r < nrows; r++) {
+      fprintf(out, "%zu", r);
+      for (int c = 0; c < SERIES_COLUMNS; c++)
+        fprintf(out, ",%llu", values[r * ncolumns + c]);
+      fprintf(out, "\n");
+    }
+  }
+  free(values);
+  return status;
+}
+
+/*
+ * series_free - free the table and the columns
+ */
+void series_free(series_t *series) {
+  free(series->table);
+  for (int c = 0; c < SERIES_COLUMNS; c++)
+    free(series->columns[c]);
+  memset(series, 0, sizeof(series_t));
+}
@@ -0,0 +1,135 @@
+////////////////////////////////////////////////////////////////////////////////
+// Main File:        csim.c
+// This File:        series.h
+// Other Files:      csim.c libcsim.c libcsim.h series.c conv.c cache.h
+// Semester:         CS 354 Fall 2018
+//
+// Author:           Yuanhang Wang
+// Email:            wang2243@wisc.edu
+// CS Login:         ywang
+//
+/////////////////////////// OTHER SOURCES OF HELP //////////////////////////////
+//                   fully acknowledge and credit all sources of help,
+//                   other than Instructors and TAs.
+//
+// Persons:          Identify persons by name, relationship to you, and email.
+//                   Describe in detail the the ideas and help they provided.
+//
+// Online sources:   avoid web searches to solve your problems, but if you do
+//                   search, be sure to include Web URLs and description of
+//                   of any information you find.
+//////////////////////////// 80 columns wide ///////////////////////////////////
+
+#ifndef __series_h__
+#define __series_h__
+
+#include <stdio.h>
+#include "cache.h"
+
+/*
+ * Series file: the 8 bytes SERIES_MAGIC, then as varints (see trace.h)
+ * the number of columns, of rows and the accesses per interval, then
+ * each column in turn: its name, NUL terminated, and one varint per row.
+ * Rows are intervals, in trace order, the last one possibly shorter.
+ */
+#define SERIES_MAGIC "CSIMSER1"
+
+#define SERIES_COLUMNS   7
+#define SERIES_BUCKETS   32   /* reuse times by log2, 0 being first uses
+                                 in the interval */
+#define SERIES_PHASES    64   /* at most, later intervals join the nearest */
+#define SERIES_RATE_BITS 7    /* 1 in 2^7 blocks sampled */
+
+/* Blocks whose hash is below SERIES_SAMPLED are sampled */
+#define SERIES_HASH    0x9E3779B97F4A7C15ULL
+#define SERIES_SAMPLED (1ULL << (64 - SERIES_RATE_BITS))
+
+/* Columns, in file order */
+#define COL_ACCESSES  0
+#define COL_HITS      1
+#define COL_MISSES    2       /* evictions included */
+#define COL_EVICTIONS 3
+#define COL_BLOCKS    4       /* estimated distinct blocks accessed */
+#define COL_REUSE     5       /* median reuse time, rounded down to a power
+                                 of two, 0 if no reuse was sampled */
+#define COL_PHASE     6
+
+/* Type: Last access to a sampled block in the current interval */
+typedef struct series_entry {
+  mem_addr_t block;           /* TAG_INVALID => free */
+  unsigned long long last;    /* accesses of the interval before it */
+} series_entry_t;
+
+/* Type: Intervals alike, with the mean of their signatures */
+typedef struct series_phase {
+  double miss;                /* miss rate */
+  double reuse[SERIES_BUCKETS];  /* shares of the sampled accesses */
+  unsigned long long intervals;
+  unsigned long long runs;    /* times the trace entered the phase */
+  unsigned long long accesses, misses, blocks;
+} series_phase_t;
+
+/* Type: Statistics of every interval of 'length' accesses, and the phases
+ * they fall into
+ */
+typedef struct series {
+  unsigned long long length;  /* 0 => no series */
+  double threshold;           /* signature distance starting a new phase */
+  int b;
+
+  /* The current interval */
+  unsigned long long pos;     /* accesses into it */
+  unsigned long long mark[3]; /* counts of the simulation before it,
+                                 indexed by CACHE_HIT/MISS/EVICT */
+  unsigned long long reuse[SERIES_BUCKETS];  /* sampled accesses by log2
+                                                reuse time */
+  series_entry_t *table;      /* hash table of its sampled blocks */
+  size_t size;                /* a power of two, 0 until the first */
+  size_t used;
+
+  unsigned long long *columns[SERIES_COLUMNS];
+  size_t rows, rows_size;
+
+  series_phase_t phases[SERIES_PHASES];
+  int nphases;
+  int phase;                  /* of the latest interval, -1 before */
+  unsigned long long changes;
+  int failed;                 /* nonzero => memory ran out */
+} series_t;
+
+void series_init(series_t *series, unsigned long long length,
+                 double threshold, int b);
+void series_sample(series_t *series, mem_addr_t block,
+                   unsigned long long pos);
+void series_close(series_t *series, const unsigned long long counts[3]);
+
+/*
+ * series_sampled - whether 'block' is one of the sampled blocks
+ */
+static inline int series_sampled(mem_addr_t block) {
+  return block * SERIES_HASH < SERIES_SAMPLED;
+}
+
+/*
+ * series_note - note an access to 'addr'
+ *   The interval counts its outcomes as the difference of the counts of
+ *   the simulation at its start and end, so an access costs a multiply
+ *   and two compares. A caller that knows the next accesses cannot end
+ *   the interval can do with one, see access_series in libcsim.c.
+ *   Returns nonzero once the interval has 'length' accesses, for the
+ *   caller to close it with series_close
+ */
+static inline int series_note(series_t *series, mem_addr_t addr) {
+  mem_addr_t block = addr >> series->b;
+  if (series_sampled(block))
+    series_sample(series, block, series->pos);
+  return ++series->pos == series->length;
+}
+
+int series_finish(series_t *series, const unsigned long long counts[3]);
+void series_print(const series_t *series, FILE *fp);
+int series_write(const series_t *series, FILE *fp);
+int series_csv(FILE *in, FILE *out);
+void series_free(series_t *series);
+
+#endif // __series_h__
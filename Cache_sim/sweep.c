@@ -0,0 +1,162 @@
+////////////////////////////////////////////////////////////////////////////////
+// Main File:        csim.c
+// This File:        sweep.c
+// Other Files:      csim.c sweep.h cache.h
+// Semester:         CS 354 Fall 2018
+//
+// Author:           Yuanhang Wang
+// Email:            wang2243@wisc.edu
+// CS Login:         ywang
+//
+/////////////////////////// OTHER SOURCES OF HELP //////////////////////////////
+//                   fully acknowledge and credit all sources of help,
+//                   other than Instructors and TAs.
+//
+// Persons:          Identify persons by name, relationship to you, and email.
+//                   Describe in detail the the ideas and help they provided.
+//
+// Online sources:   avoid web searches to solve your problems, but if you do
+//                   search, be sure to include Web URLs and description of
+//                   of any information you find.
+//////////////////////////// 80 columns wide ///////////////////////////////////
+
+/*
+ * sweep.c - Simulates a whole range of LRU cache geometries in one pass
+ *     over the trace with Mattson's stack algorithm.
+ *
+ * LRU has the inclusion property: a set with E lines always holds the E
+ * most recently used blocks that map to it. So for each (s, b) only the
+ * LRU stack of every set is kept, and the depth at which an access finds
+ * its block tells which associativities hit:
+ *   hits(E)      = accesses found at a depth below E
+ *   misses(E)    = accesses - hits(E)
+ *   evictions(E) = misses(E) - fills(E)
+ * where fills(E), the misses that filled an empty line, is the sum over
+ * the sets of min(E, blocks the set has seen). A stack capped at E_hi
+ * deep holds min(E_hi, blocks seen), which is all that sum needs.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "sweep.h"
+
+/*
+ * sweep_init - set up a sweep of s in [s_lo, s_hi], E in [E_lo, E_hi] and
+ *   b in [b_lo, b_hi]
+ *   Returns 0 on success, -1 if a range is invalid or memory runs out
+ */
+int sweep_init(sweep_t *sweep, int s_lo, int s_hi, int E_lo, int E_hi,
+               int b_lo, int b_hi) {
+  memset(sweep, 0, sizeof(sweep_t));
+  if (s_lo < 0 || s_lo > s_hi || s_hi > 30 || E_lo < 1 || E_lo > E_hi
+      || b_lo < 1 || b_lo > b_hi || s_hi + b_hi > 63)
+    return -1;
+  sweep->s_lo = s_lo;
+  sweep->s_hi = s_hi;
+  sweep->E_lo = E_lo;
+  sweep->E_hi = E_hi;
+  sweep->b_lo = b_lo;
+  sweep->b_hi = b_hi;
+  sweep->ngeoms = (s_hi - s_lo + 1) * (b_hi - b_lo + 1);
+  sweep->geoms = calloc(sweep->ngeoms, sizeof(sweep_geom_t));
+  if (sweep->geoms == NULL)
+    return -1;
+
+  sweep_geom_t *geom = sweep->geoms;
+  for (int b = b_lo; b <= b_hi; b++)
+    for (int s = s_lo; s <= s_hi; s++, geom++) {
+      size_t sets = (size_t) 1 << s;
+      geom->s = s;
+      geom->b = b;
+      geom->stacks = malloc(sets * E_hi * sizeof(mem_addr_t));
+      geom->depth = calloc(sets, sizeof(unsigned int));
+      geom->hits = calloc(E_hi, sizeof(unsigned long long));
+      if (!geom->stacks || !geom->depth || !geom->hits) {
+        sweep_free(sweep);
+        return -1;
+      }
+    }
+  return 0;
+}
+
+/*
+ * sweep_access - access 'addr' in every geometry of the sweep
+ */
+void sweep_access(sweep_t *sweep, mem_addr_t addr) {
+  int E_hi = sweep->E_hi;
+  sweep->accesses++;
+  for (int i = 0; i < sweep->ngeoms; i++) {
+    sweep_geom_t *geom = &sweep->geoms[i];
+    mem_addr_t block = addr >> geom->b;
+    mem_addr_t set = block & (((mem_addr_t) 1 << geom->s) - 1);
+    mem_addr_t *stack = geom->stacks + set * E_hi;
+    unsigned int depth = geom->depth[set];
+
+    unsigned int d = 0;
+    while (d < depth && stack[d] != block)
+      d++;
+    if (d < depth) {
+      geom->hits[d]++;
+    } else if (depth < (unsigned int) E_hi) {
+      geom->depth[set] = ++depth;  // First E_hi blocks of the set
+    } else {
+      d = depth - 1;  // Falls off the bottom of the stack
+    }
+    // Move the block to the top
+    memmove(stack + 1, stack, d * sizeof(mem_addr_t));
+    stack[0] = block;
+  }
+}
+
+/*
+ * sweep_print - print hits, misses and evictions of every combination as
+ *   a table, one row per cache
+ */
+void sweep_print(const sweep_t *sweep, FILE *fp) {
+  int E_hi = sweep->E_hi;
+  unsigned long long *fills_at = calloc(E_hi + 1, sizeof(unsigned long long));
+  if (fills_at == NULL)
+    return;
+
+  fprintf(fp, "%3s %5s %3s %12s %14s %14s %14s %8s\n", "s", "E", "b",
+          "bytes", "hits", "misses", "evictions", "miss%");
+  for (int i = 0; i < sweep->ngeoms; i++) {
+    const sweep_geom_t *geom = &sweep->geoms[i];
+    size_t sets = (size_t) 1 << geom->s;
+
+    // fills_at[k] = number of sets whose stack is k deep
+    memset(fills_at, 0, (E_hi + 1) * sizeof(unsigned long long));
+    for (size_t set = 0; set < sets; set++)
+      fills_at[geom->depth[set]]++;
+
+    unsigned long long hits = 0;
+    for (int E = 1; E <= E_hi; E++) {
+      hits += geom->hits[E - 1];
+      if (E < sweep->E_lo)
+        continue;
+      unsigned long long fills = 0;
+      for (int k = 0; k <= E_hi; k++)
+        fills += fills_at[k] * (k < E ? k : E);
+      unsigned long long misses = sweep->accesses - hits;
+      fprintf(fp, "%3d %5d %3d %12llu %14llu %14llu %14llu %8.3f\n",
+              geom->s, E, geom->b,
+              (unsigned long long) sets * E << geom->b, hits, misses,
+              misses - fills,
+              sweep->accesses ? 100.0 * misses / sweep->accesses : 0.0);
+    }
+  }
+  free(fills_at);
+}
+
+/*
+ * sweep_free - free the memory sweep_init allocated
+ */
+void sweep_free(sweep_t *sweep) {
+  for (int i = 0; sweep->geoms != NULL && i < sweep->ngeoms; i++) {
+    free(sweep->geoms[i].stacks);
+    free(sweep->geoms[i].depth);
+    free(sweep->geoms[i].hits);
+  }
+  free(sweep->geoms);
+  memset(sweep, 0, sizeof(sweep_t));
+}
@@ -0,0 +1,58 @@
+////////////////////////////////////////////////////////////////////////////////
+// Main File:        csim.c
+// This File:        sweep.h
+// Other Files:      csim.c sweep.c cache.h
+// Semester:         CS 354 Fall 2018
+//
+// Author:           Yuanhang Wang
+// Email:            wang2243@wisc.edu
+// CS Login:         ywang
+//
+/////////////////////////// OTHER SOURCES OF HELP //////////////////////////////
+//                   fully acknowledge and credit all sources of help,
+//                   other than Instructors and TAs.
+//
+// Persons:          Identify persons by name, relationship to you, and email.
+//                   Describe in detail the the ideas and help they provided.
+//
+// Online sources:   avoid web searches to solve your problems, but if you do
+//                   search, be sure to include Web URLs and description of
+//                   of any information you find.
+//////////////////////////// 80 columns wide ///////////////////////////////////
+
+#ifndef __sweep_h__
+#define __sweep_h__
+
+#include <stdio.h>
+#include "cache.h"
+
+/* Type: Stack-distance state of one (s, b) geometry
+ * Every set keeps its blocks in LRU order, most recent first, up to
+ * E_hi deep. An access found at depth d hits in every cache of this
+ * geometry with more than d lines per set, so one stack answers every E.
+ */
+typedef struct sweep_geom {
+  int s;
+  int b;
+  mem_addr_t *stacks;         /* 2^s stacks of E_hi block numbers */
+  unsigned int *depth;        /* 2^s stack depths */
+  unsigned long long *hits;   /* E_hi counts of hits at each depth */
+} sweep_geom_t;
+
+/* Type: Sweep over every combination of s, E and b in the given ranges */
+typedef struct sweep {
+  int s_lo, s_hi;
+  int E_lo, E_hi;
+  int b_lo, b_hi;
+  int ngeoms;
+  sweep_geom_t *geoms;
+  unsigned long long accesses;
+} sweep_t;
+
+int sweep_init(sweep_t *sweep, int s_lo, int s_hi, int E_lo, int E_hi,
+               int b_lo, int b_hi);
+void sweep_access(sweep_t *sweep, mem_addr_t addr);
+void sweep_print(const sweep_t *sweep, FILE *fp);
+void sweep_free(sweep_t *sweep);
+
+#endif // __sweep_h__
@@ -0,0 +1,259 @@
+////////////////////////////////////////////////////////////////////////////////
+// Main File:        csim.c
+// This File:        tlb.c
+// Other Files:      csim.c libcsim.c libcsim.h tlb.h cache.c cache.h
+// Semester:         CS 354 Fall 2018
+//
+// Author:           Yuanhang Wang
+// Email:            wang2243@wisc.edu
+// CS Login:         ywang
+//
+/////////////////////////// OTHER SOURCES OF HELP //////////////////////////////
+//                   fully acknowledge and credit all sources of help,
+//                   other than Instructors and TAs.
+//
+// Persons:          Identify persons by name, relationship to you, and email.
+//                   Describe in detail the the ideas and help they provided.
+//
+// Online sources:   avoid web searches to solve your problems, but if you do
+//                   search, be sure to include Web URLs and description of
+//                   of any information you find.
+//////////////////////////// 80 columns wide ///////////////////////////////////
+
+/*
+ * tlb.c - Address translation in front of the data cache: an L1 and an
+ *     optional L2 TLB, and a page walker with a page-walk cache.
+ *
+ * The trace's addresses are taken as virtual, mapped by x86-64 style four
+ * level page tables. Level 0 (PML4) entries map 512 GiB, level 1 (PDPT)
+ * 1 GiB, level 2 (PD) 2 MiB and level 3 (PT) 4 KiB, and a page size stops
+ * the walk at the level whose entries map it. The tables are laid out
+ * linearly, the entry of 'addr' at level l being at
+ *
+ *     TLB_PT_BASE + l * 2^40 + (addr >> (39 - 9 l)) * 8
+ *
+ * so neighbouring pages share the cache lines of their entries as they
+ * do in a real radix tree.
+ *
+ * Each TLB is a cache_t whose blocks are pages, under LRU. An access
+ * looks up the L1, then the L2 on a miss, and walks the tables if both
+ * miss; the TLBs fill on the way back. The page-walk cache keeps, per
+ * level above the leaf, the latest entries read there as a fully
+ * associative cache_t whose blocks are what an entry maps. A walk starts
+ * below the deepest level it hits, so a hit at the PD level leaves a
+ * single entry to read for a 4 KiB page.
+ *
+ * The same TLBs are simulated under all three page sizes at once, which
+ * tells how many walks huge pages would save on the same trace.
+ */
+
+#include <string.h>
+#include "tlb.h"
+
+static const char *page_names[TLB_PAGES] = {"4 KiB", "2 MiB", "1 GiB"};
+static const char *level_names[TLB_LEVELS] = {"PML4", "PDPT", "PD", "PT"};
+
+/*
+ * tlb_page_bits - the page offset bits of the page size 'name', 4k, 2m
+ *   or 1g
+ *   Returns the bits, -1 if 'name' is none of them
+ */
+int tlb_page_bits(const char *name) {
+  if (strcmp(name, "4k") == 0)
+    return 12;
+  if (strcmp(name, "2m") == 0)
+    return 21;
+  if (strcmp(name, "1g") == 0)
+    return 30;
+  return -1;
+}
+
+/*
+ * level_bits - the bits of the addresses an entry at 'level' maps
+ */
+static inline int level_bits(int level) {
+  return 39 - 9 * level;
+}
+
+/*
+ * init_tlb_cache - set up 'cache' as a TLB of 'entries' pages of
+ *   2^page_bits bytes in sets of 'ways'
+ *   Returns 0 on success, -1 unless 'entries' is 'ways' times a power of
+ *   two or if out of memory
+ */
+static int init_tlb_cache(cache_t *cache, int entries, int ways,
+                          int page_bits) {
+  int s = 0;
+  if (ways < 1 || entries < ways || entries % ways != 0)
+    return -1;
+  while ((ways << s) < entries)
+    s++;
+  if ((ways << s) != entries)
+    return -1;
+  return cache_init(cache, s, ways, page_bits, 0);
+}
+
+/*
+ * free_sim - free the caches of 'sim', set up or not
+ */
+static void free_sim(tlb_sim_t *sim) {
+  cache_free(&sim->l1);
+  cache_free(&sim->l2);
+  for (int l = 0; l < TLB_LEVELS - 1; l++)
+    cache_free(&sim->walk[l]);
+}
+
+/*
+ * init_sim - set up 'sim' for pages of 2^page_bits bytes
+ *   Returns 0 on success, -1 if a geometry is invalid or out of memory
+ */
+static int init_sim(tlb_sim_t *sim, const int entries[2], const int ways[2],
+                    int page_bits, int walk_entries) {
+  memset(sim, 0, sizeof(tlb_sim_t));
+  sim->page_bits = page_bits;
+  sim->leaf = (39 - page_bits) / 9;
+  sim->has_l2 = entries[1] > 0;
+  sim->has_walk = walk_entries > 0;
+  int status = init_tlb_cache(&sim->l1, entries[0], ways[0], page_bits);
+  if (status == 0 && sim->has_l2)
+    status = init_tlb_cache(&sim->l2, entries[1], ways[1], page_bits);
+  for (int l = 0; l < sim->leaf && sim->has_walk && status == 0; l++)
+    status = cache_init(&sim->walk[l], 0, walk_entries, level_bits(l), 0);
+  if (status != 0)
+    free_sim(sim);
+  return status;
+}
+
+/*
+ * tlb_init - set up an L1 TLB of entries[0] pages in sets of ways[0], an
+ *   L2 TLB likewise unless entries[1] is 0, and a page-walk cache of
+ *   'walk_entries' per level (none if 0), for pages of 2^page_bits bytes
+ *   Returns 0 on success, -1 if a geometry or the page size is invalid or
+ *   out of memory
+ */
+int tlb_init(tlb_t *tlb, const int entries[2], const int ways[2],
+             int page_bits, int walk_entries) {
+  memset(tlb, 0, sizeof(tlb_t));
+  tlb->page = -1;
+  for (int p = 0; p < TLB_PAGES; p++) {
+    int bits = level_bits(TLB_LEVELS - 1 - p);
+    if (bits == page_bits)
+      tlb->page = p;
+    if (init_sim(&tlb->sims[p], entries, ways, bits, walk_entries) != 0) {
+      tlb_free(tlb);
+      return -1;
+    }
+  }
+  if (tlb->page < 0) {
+    tlb_free(tlb);
+    return -1;
+  }
+  return 0;
+}
+
+/*
+ * translate - look 'addr' up in the TLBs of 'sim', walking the tables on
+ *   a miss, and store the addresses of the entries the walk reads in
+ *   'ptes' if set
+ *   Returns the number of entries read, 0 if a TLB hit
+ */
+static int translate(tlb_sim_t *sim, mem_addr_t addr,
+                     mem_addr_t ptes[TLB_LEVELS]) {
+  if (cache_access(&sim->l1, addr) == CACHE_HIT) {
+    sim->l1_hits++;
+    return 0;
+  }
+  sim->l1_misses++;
+  if (sim->has_l2) {
+    if (cache_access(&sim->l2, addr) == CACHE_HIT) {
+      sim->l2_hits++;
+      return 0;
+    }
+    sim->l2_misses++;
+  }
+
+  // Start below the deepest level the walk cache holds, filling the
+  // levels under it, which the walk reads
+  int start = 0;
+  for (int l = sim->leaf - 1; l >= 0 && sim->has_walk; l--) {
+    if (cache_access(&sim->walk[l], addr) == CACHE_HIT) {
+      sim->walk_hits[l]++;
+      start = l + 1;
+      break;
+    }
+  }
+  sim->walks++;
+  sim->loads += sim->leaf + 1 - start;
+  if (ptes)
+    for (int l = start; l <= sim->leaf; l++)
+      ptes[l - start] = TLB_PT_BASE + ((mem_addr_t) l << 40)
+                        + ((addr & ((1ULL << 48) - 1)) >> level_bits(l)) * 8;
+  return sim->leaf + 1 - start;
+}
+
+/*
+ * tlb_access - translate 'addr' under every page size, storing the
+ *   addresses of the entries read by the walk under the trace's in 'ptes',
+ *   in the order read
+ *   Returns the number of entries in 'ptes', 0 if the TLBs hit
+ */
+int tlb_access(tlb_t *tlb, mem_addr_t addr, mem_addr_t ptes[TLB_LEVELS]) {
+  int n = 0;
+  for (int p = 0; p < TLB_PAGES; p++) {
+    int loads = translate(&tlb->sims[p], addr, p == tlb->page ? ptes : NULL);
+    if (p == tlb->page)
+      n = loads;
+  }
+  return n;
+}
+
+/*
+ * tlb_print - print the hits and misses of the TLBs, the walks under the
+ *   trace's page size and how many the other page sizes would take
+ */
+void tlb_print(const tlb_t *tlb, FILE *fp) {
+  const tlb_sim_t *sim = &tlb->sims[tlb->page];
+  fprintf(fp, "%-9s %7s %4s %12s %12s %8s\n", "TLB", "entries", "ways",
+          "hits", "misses", "miss%");
+  for (int i = 0; i < 1 + sim->has_l2; i++) {
+    const cache_t *cache = i ? &sim->l2 : &sim->l1;
+    unsigned long long hits = i ? sim->l2_hits : sim->l1_hits;
+    unsigned long long misses = i ? sim->l2_misses : sim->l1_misses;
+    fprintf(fp, "L%-8d %7d %4d %12llu %12llu %8.3f\n", i + 1,
+            cache->S * cache->E, cache->E, hits, misses,
+            hits + misses ? 100.0 * misses / (hits + misses) : 0.0);
+  }
+  fprintf(fp, "page walks:%llu entries read:%llu (%.2f per walk, %s pages)\n",
+          sim->walks, sim->loads,
+          sim->walks ? (double) sim->loads / sim->walks : 0.0,
+          page_names[tlb->page]);
+  if (sim->has_walk) {
+    fprintf(fp, "walk cache hits:");
+    for (int l = 0; l < sim->leaf; l++)
+      fprintf(fp, " %s:%llu", level_names[l], sim->walk_hits[l]);
+    fprintf(fp, "\n");
+  }
+
+  fprintf(fp, "%-9s %12s %12s %9s\n", "pages", "walks", "entries",
+          "walks vs");
+  for (int p = 0; p < TLB_PAGES; p++) {
+    const tlb_sim_t *other = &tlb->sims[p];
+    fprintf(fp, "%-9s %12llu %12llu ", page_names[p], other->walks,
+            other->loads);
+    if (p == tlb->page)
+      fprintf(fp, "%9s\n", "-");
+    else if (sim->walks)
+      fprintf(fp, "%+8.1f%%\n",
+              100.0 * ((double) other->walks - sim->walks) / sim->walks);
+    else
+      fprintf(fp, "%9s\n", "n/a");
+  }
+}
+
+/*
+ * tlb_free - free the caches of every page size
+ */
+void tlb_free(tlb_t *tlb) {
+  for (int p = 0; p < TLB_PAGES; p++)
+    free_sim(&tlb->sims[p]);
+}
@@ -0,0 +1,69 @@
+////////////////////////////////////////////////////////////////////////////////
+// Main File:        csim.c
+// This File:        tlb.h
+// Other Files:      csim.c libcsim.c libcsim.h tlb.c cache.c cache.h
+// Semester:         CS 354 Fall 2018
+//
+// Author:           Yuanhang Wang
+// Email:            wang2243@wisc.edu
+// CS Login:         ywang
+//
+/////////////////////////// OTHER SOURCES OF HELP //////////////////////////////
+//                   fully acknowledge and credit all sources of help,
+//                   other than Instructors and TAs.
+//
+// Persons:          Identify persons by name, relationship to you, and email.
+//                   Describe in detail the the ideas and help they provided.
+//
+// Online sources:   avoid web searches to solve your problems, but if you do
+//                   search, be sure to include Web URLs and description of
+//                   of any information you find.
+//////////////////////////// 80 columns wide ///////////////////////////////////
+
+#ifndef __tlb_h__
+#define __tlb_h__
+
+#include <stdio.h>
+#include "cache.h"
+
+#define TLB_LEVELS 4        /* page table levels, x86-64 four-level paging */
+#define TLB_PAGES  3        /* page sizes: 4 KiB, 2 MiB and 1 GiB */
+
+/* Page table entries are 8 bytes, and the table of level l sits at
+ * TLB_PT_BASE + l * 2^40, far above the addresses of user traces */
+#define TLB_PT_BASE 0xFFFF800000000000ULL
+
+/* Type: TLBs and page walker for one page size */
+typedef struct tlb_sim {
+  int page_bits;              /* 12, 21 or 30 */
+  int leaf;                   /* level of the entries mapping the pages */
+  int has_l2;
+  cache_t l1, l2;             /* blocks are pages */
+  cache_t walk[TLB_LEVELS - 1]; /* page-walk cache of each level above the
+                                   leaf, blocks are what an entry maps */
+  int has_walk;
+  unsigned long long l1_hits, l1_misses;
+  unsigned long long l2_hits, l2_misses;
+  unsigned long long walks;
+  unsigned long long loads;   /* entries the walks read */
+  unsigned long long walk_hits[TLB_LEVELS - 1];  /* walks started below
+                                                    the level */
+} tlb_sim_t;
+
+/* Type: TLBs of the trace's page size, with the same TLBs under the other
+ * page sizes alongside for comparison
+ * Only the walks of sims[page] load entries through the data cache.
+ */
+typedef struct tlb {
+  int page;                   /* index into sims of the trace's page size */
+  tlb_sim_t sims[TLB_PAGES];
+} tlb_t;
+
+int tlb_page_bits(const char *name);
+int tlb_init(tlb_t *tlb, const int entries[2], const int ways[2],
+             int page_bits, int walk_entries);
+int tlb_access(tlb_t *tlb, mem_addr_t addr, mem_addr_t ptes[TLB_LEVELS]);
+void tlb_print(const tlb_t *tlb, FILE *fp);
+void tlb_free(tlb_t *tlb);
+
+#endif // __tlb_h__
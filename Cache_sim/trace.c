@@ -0,0 +1,408 @@
+////////////////////////////////////////////////////////////////////////////////
+// Main File:        csim.c
+// This File:        trace.c
+// Other Files:      csim.c cache.c cache.h trace.h conv.c
+// Semester:         CS 354 Fall 2018
+//
+// Author:           Yuanhang Wang
+// Email:            wang2243@wisc.edu
+// CS Login:         ywang
+//
+/////////////////////////// OTHER SOURCES OF HELP //////////////////////////////
+//                   fully acknowledge and credit all sources of help,
+//                   other than Instructors and TAs.
+//
+// Persons:          Identify persons by name, relationship to you, and email.
+//                   Describe in detail the the ideas and help they provided.
+//
+// Online sources:   avoid web searches to solve your problems, but if you do
+//                   search, be sure to include Web URLs and description of
+//                   of any information you find.
+//////////////////////////// 80 columns wide ///////////////////////////////////
+
+/*
+ * trace.c - Reading and writing traces in the text and binary formats
+ *     described in trace.h.
+ *
+ * The text parser is hand-rolled: it finds each line with memchr and
+ * converts the hex address and decimal size itself instead of going
+ * through fgets and sscanf.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "trace.h"
+
+#define BUF_SIZE   (1 << 20)  /* read buffer for stdin and pipes */
+#define MAX_RECORD 21         /* op byte and two 10-byte varints */
+
+/*
+ * refill - move the unparsed bytes to the start of the buffer and read
+ *   more after them
+ *   Returns -1 on a read error, 0 otherwise
+ */
+static int refill(trace_t *trace) {
+  if (trace->mapped || trace->eof)
+    return 0;
+  size_t left = trace->end - trace->pos;
+  memmove(trace->buf, trace->pos, left);
+  trace->pos = trace->buf;
+  trace->end = trace->buf + left;
+  while (trace->end < trace->buf + trace->size) {
+    ssize_t n = read(trace->fd, (char *) trace->end,
+                     trace->buf + trace->size - trace->end);
+    if (n < 0)
+      return -1;
+    if (n == 0) {
+      trace->eof = 1;
+      break;
+    }
+    trace->end += n;
+    // A pipe hands out what it has, take it rather than wait for more
+    if (trace->end - trace->pos >= MAX_RECORD)
+      break;
+  }
+  return 0;
+}
+
+/*
+ * trace_open - open the trace at 'path' ("-" for stdin) and detect its
+ *   format
+ *   Returns 0 on success, -1 with errno set on failure
+ */
+int trace_open(trace_t *trace, const char *path) {
+  memset(trace, 0, sizeof(trace_t));
+  trace->fd = strcmp(path, "-") == 0 ? 0 : open(path, O_RDONLY);
+  if (trace->fd < 0)
+    return -1;
+
+  struct stat st;
+  if (fstat(trace->fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, trace->fd, 0);
+    if (map != MAP_FAILED) {
+      madvise(map, st.st_size, MADV_SEQUENTIAL);
+      trace->mapped = 1;
+      trace->eof = 1;
+      trace->buf = map;
+      trace->size = st.st_size;
+      trace->pos = trace->buf;
+      trace->end = trace->buf + st.st_size;
+    }
+  }
+  if (!trace->mapped) {
+    trace->buf = malloc(BUF_SIZE);
+    if (trace->buf == NULL) {
+      trace_close(trace);
+      return -1;
+    }
+    trace->size = BUF_SIZE;
+    trace->pos = trace->buf;
+    trace->end = trace->buf;
+    while (trace->end - trace->pos < 8 && !trace->eof)
+      if (refill(trace) != 0) {
+        trace_close(trace);
+        return -1;
+      }
+  }
+
+  size_t magic_len = strlen(TRACE_MAGIC);
+  if (trace->end - trace->pos >= magic_len
+      && memcmp(trace->pos, TRACE_MAGIC, magic_len) == 0) {
+    trace->binary = 1;
+    trace->pos += magic_len;
+  }
+  return 0;
+}
+
+/*
+ * trace_close - release what trace_open acquired
+ */
+void trace_close(trace_t *trace) {
+  if (trace->mapped)
+    munmap(trace->buf, trace->size);
+  else
+    free(trace->buf);
+  if (trace->fd > 0)
+    close(trace->fd);
+  memset(trace, 0, sizeof(trace_t));
+}
+
+static inline int hex_digit(unsigned char c) {
+  if ((unsigned char) (c - '0') < 10)
+    return c - '0';
+  c |= 0x20;  // Lower case
+  if ((unsigned char) (c - 'a') < 6)
+    return c - 'a' + 10;
+  return -1;
+}
+
+/*
+ * next_line - find the next line of a text trace, from *line up to *nl
+ *   Returns 1 if there is one, 0 at the end of the trace and -1 on a read
+ *   error
+ */
+static inline int next_line(trace_t *trace, const char **line,
+                            const char **nl) {
+  for (;;) {
+    *nl = memchr(trace->pos, '\n', trace->end - trace->pos);
+    if (*nl == NULL) {
+      if (!trace->eof) {
+        if (trace->pos == trace->buf && trace->end == trace->buf + trace->size)
+          trace->pos = trace->end;  // No line is this long, drop it
+        if (refill(trace) != 0)
+          return -1;
+        continue;
+      }
+      if (trace->pos == trace->end)
+        return 0;
+      *nl = trace->end;  // Last line without a newline
+    }
+    *line = trace->pos;
+    trace->pos = *nl < trace->end ? *nl + 1 : *nl;
+    return 1;
+  }
+}
+
+/*
+ * text_next - trace_next for the text format
+ *   Lines that are not accesses are skipped
+ */
+static int text_next(trace_t *trace, int *op, mem_addr_t *addr,
+                     unsigned int *len) {
+  const char *p, *nl;
+  int status;
+  while ((status = next_line(trace, &p, &nl)) > 0) {
+    // " L 7ff000398,8", " S ...", " M ...", "I  0400d7d4,8" or "T 3"
+    if (nl - p >= 3 && p[0] == 'T' && p[1] == ' ') {
+      mem_addr_t thread = 0;
+      for (p += 2; p < nl && *p == ' '; p++)
+        ;
+      for (; p < nl && (unsigned char) (*p - '0') < 10; p++)
+        thread = thread * 10 + (*p - '0');
+      *op = TRACE_T;
+      *addr = thread;
+      *len = 0;
+      return 1;
+    }
+    if (nl - p < 4)
+      continue;
+    if (p[0] == 'I' && p[1] == ' ')
+      *op = TRACE_I;
+    else if (p[0] == ' ' && p[1] == 'L')
+      *op = TRACE_L;
+    else if (p[0] == ' ' && p[1] == 'S')
+      *op = TRACE_S;
+    else if (p[0] == ' ' && p[1] == 'M')
+      *op = TRACE_M;
+    else
+      continue;
+    p += 2;
+    while (p < nl && *p == ' ')
+      p++;
+
+    mem_addr_t a = 0;
+    int digit;
+    while (p < nl && (digit = hex_digit(*p)) >= 0) {
+      a = a << 4 | digit;
+      p++;
+    }
+    unsigned int n = 0;
+    if (p < nl && *p == ',')
+      for (p++; p < nl && (unsigned char) (*p - '0') < 10; p++)
+        n = n * 10 + (*p - '0');
+    *addr = a;
+    *len = n;
+    return 1;
+  }
+  return status;
+}
+
+/*
+ * text_skip - trace_skip for the text format
+ *   Only the first two characters of a line are looked at
+ */
+static size_t text_skip(trace_t *trace, size_t n,
+                        unsigned long long *accesses) {
+  const char *p, *nl;
+  size_t skipped = 0;
+  while (skipped < n && next_line(trace, &p, &nl) > 0)
+    if (nl - p >= 4 && p[0] == ' '
+        && (p[1] == 'L' || p[1] == 'S' || p[1] == 'M')) {
+      skipped++;
+      *accesses += p[1] == 'M' ? 2 : 1;
+    }
+  return skipped;
+}
+
+/*
+ * get_varint - decode the varint at 'p' into *value
+ *   Returns the byte after it, or NULL if it runs past 'end'
+ */
+static inline const unsigned char *get_varint(const unsigned char *p,
+                                              const unsigned char *end,
+                                              unsigned long long *value) {
+  unsigned long long v = 0;
+  for (int shift = 0; p < end && shift < 64; shift += 7) {
+    unsigned char c = *p++;
+    v |= (unsigned long long) (c & 0x7f) << shift;
+    if (!(c & 0x80)) {
+      *value = v;
+      return p;
+    }
+  }
+  return NULL;
+}
+
+/*
+ * bin_next - trace_next for the binary format
+ */
+static int bin_next(trace_t *trace, int *op, mem_addr_t *addr,
+                    unsigned int *len) {
+  if (trace->end - trace->pos < MAX_RECORD && !trace->eof)
+    if (refill(trace) != 0)
+      return -1;
+  if (trace->pos == trace->end)
+    return 0;
+
+  const unsigned char *p = (const unsigned char *) trace->pos;
+  const unsigned char *end = (const unsigned char *) trace->end;
+  unsigned long long value;
+  *op = *p & 3;
+  *len = *p++ >> 2;
+  if (*len == 63) {
+    if ((p = get_varint(p, end, &value)) == NULL)
+      return -1;
+    *len = value;
+  } else if (*len == 0 && *op == TRACE_I) {
+    if ((p = get_varint(p, end, &value)) == NULL)
+      return -1;
+    *op = TRACE_T;
+    *addr = value;
+    trace->pos = (const char *) p;
+    return 1;
+  }
+  if ((p = get_varint(p, end, &value)) == NULL)
+    return -1;
+  // Zigzag: even values are non-negative deltas, odd ones negative
+  mem_addr_t *last = &trace->last_addr[*op == TRACE_I];
+  *last += (value >> 1) ^ -(value & 1);
+  *addr = *last;
+  trace->pos = (const char *) p;
+  return 1;
+}
+
+/*
+ * bin_skip - trace_skip for the binary format
+ *   The addresses still have to be decoded, as the next ones are deltas
+ *   from them
+ */
+static size_t bin_skip(trace_t *trace, size_t n,
+                       unsigned long long *accesses) {
+  size_t skipped = 0;
+  while (skipped < n) {
+    if (trace->end - trace->pos < MAX_RECORD && !trace->eof)
+      if (refill(trace) != 0)
+        break;
+    const unsigned char *p = (const unsigned char *) trace->pos;
+    const unsigned char *end = (const unsigned char *) trace->end;
+    unsigned long long value;
+    if (p == end)
+      break;
+    int op = *p & 3, size = *p++ >> 2;
+    if (size == 63 && (p = get_varint(p, end, &value)) == NULL)
+      break;
+    if ((p = get_varint(p, end, &value)) == NULL)
+      break;
+    if (op == TRACE_I && size == 0) {
+      trace->pos = (const char *) p;  // A thread switch
+      continue;
+    }
+    trace->last_addr[op == TRACE_I] += (value >> 1) ^ -(value & 1);
+    trace->pos = (const char *) p;
+    if (op != TRACE_I) {
+      skipped++;
+      *accesses += op == TRACE_M ? 2 : 1;
+    }
+  }
+  return skipped;
+}
+
+/*
+ * trace_skip - skip the next 'n' data accesses (loads, stores and
+ *   modifies) of 'trace', and the other records among them, without
+ *   converting them as trace_next would
+ *   Adds the number of accesses skipped to *accesses, a modify counting
+ *   twice
+ *   Returns the number of data accesses skipped, fewer than 'n' only at
+ *   the end of the trace or at a damaged record, which the next
+ *   trace_next reports
+ */
+size_t trace_skip(trace_t *trace, size_t n, unsigned long long *accesses) {
+  if (trace->binary)
+    return bin_skip(trace, n, accesses);
+  return text_skip(trace, n, accesses);
+}
+
+/*
+ * trace_next - read the next access of 'trace'
+ *   Sets *op to one of TRACE_L, TRACE_S, TRACE_M or TRACE_I, *addr to the
+ *   address and *len to the size, or *op to TRACE_T and *addr to the
+ *   thread
+ *   Returns 1 if there was an access, 0 at the end of the trace and -1 if
+ *   the trace is cut short or cannot be read
+ */
+int trace_next(trace_t *trace, int *op, mem_addr_t *addr, unsigned int *len) {
+  if (trace->binary)
+    return bin_next(trace, op, addr, len);
+  return text_next(trace, op, addr, len);
+}
+
+/*
+ * trace_writer_open - start a binary trace on 'fp'
+ *   Returns 0 on success, -1 on a write error
+ */
+int trace_writer_open(trace_writer_t *writer, FILE *fp) {
+  memset(writer, 0, sizeof(trace_writer_t));
+  writer->fp = fp;
+  return fputs(TRACE_MAGIC, fp) == EOF ? -1 : 0;
+}
+
+static inline unsigned char *put_varint(unsigned char *p,
+                                        unsigned long long value) {
+  while (value >= 0x80) {
+    *p++ = (unsigned char) value | 0x80;
+    value >>= 7;
+  }
+  *p++ = (unsigned char) value;
+  return p;
+}
+
+/*
+ * trace_write - append an access, or a thread switch to thread 'addr' if
+ *   'op' is TRACE_T, to a binary trace
+ *   Returns 0 on success, -1 on a write error
+ */
+int trace_write(trace_writer_t *writer, int op, mem_addr_t addr,
+                unsigned int len) {
+  unsigned char record[MAX_RECORD];
+  unsigned char *p = record;
+  if (op == TRACE_T) {
+    *p++ = TRACE_I;
+    p = put_varint(p, addr);
+    return fwrite(record, p - record, 1, writer->fp) == 1 ? 0 : -1;
+  }
+  // An instruction of size 0 would read as a thread switch
+  int escape = len >= 63 || (len == 0 && op == TRACE_I);
+  *p++ = op | (escape ? 63 : len) << 2;
+  if (escape)
+    p = put_varint(p, len);
+  mem_addr_t *last = &writer->last_addr[op == TRACE_I];
+  long long delta = (long long) (addr - *last);
+  *last = addr;
+  p = put_varint(p, (unsigned long long) delta << 1 ^ (delta >> 63));
+  return fwrite(record, p - record, 1, writer->fp) == 1 ? 0 : -1;
+}
@@ -0,0 +1,87 @@
+////////////////////////////////////////////////////////////////////////////////
+// Main File:        csim.c
+// This File:        trace.h
+// Other Files:      csim.c cache.c cache.h trace.c conv.c
+// Semester:         CS 354 Fall 2018
+//
+// Author:           Yuanhang Wang
+// Email:            wang2243@wisc.edu
+// CS Login:         ywang
+//
+/////////////////////////// OTHER SOURCES OF HELP //////////////////////////////
+//                   fully acknowledge and credit all sources of help,
+//                   other than Instructors and TAs.
+//
+// Persons:          Identify persons by name, relationship to you, and email.
+//                   Describe in detail the the ideas and help they provided.
+//
+// Online sources:   avoid web searches to solve your problems, but if you do
+//                   search, be sure to include Web URLs and description of
+//                   of any information you find.
+//////////////////////////// 80 columns wide ///////////////////////////////////
+
+#ifndef __trace_h__
+#define __trace_h__
+
+#include <stdio.h>
+#include "cache.h"
+
+/* Trace formats
+ *
+ * Text: the Valgrind lackey format, one access per line, e.g.
+ *   "I  0400d7d4,8" or " M 0421c7f0,4"
+ * plus, in traces of several threads, "T 3" lines saying that the
+ * records after them are those of thread 3.
+ *
+ * Binary: the 8 bytes TRACE_MAGIC, then one record per access:
+ *   - an op byte: bits 0-1 are the operation (TRACE_L, TRACE_S, TRACE_M or
+ *     TRACE_I), bits 2-7 the size, or 63 if a varint size follows
+ *   - [the size as a varint]
+ *   - the address as a zigzag varint delta from the previous address of
+ *     the same kind (instruction or data), starting from 0
+ * An instruction op byte with a size of 0 is a thread switch instead,
+ * followed by the thread as a plain varint; instructions of size 0 take
+ * the varint size. A varint holds 7 bits per byte, least significant
+ * first, with the top bit set on every byte but the last. Typical records
+ * take 2-4 bytes.
+ */
+#define TRACE_MAGIC "CSIMBIN1"
+
+#define TRACE_L 0
+#define TRACE_S 1
+#define TRACE_M 2
+#define TRACE_I 3
+#define TRACE_T 4  /* thread switch, the address is the thread */
+
+/* Type: Trace reader
+ * Regular files are mapped with MADV_SEQUENTIAL, anything else (stdin,
+ * pipes) is read through a buffer.
+ */
+typedef struct trace {
+  int fd;
+  int binary;                 /* nonzero => binary format */
+  int mapped;                 /* nonzero => buf is an mmap of the file */
+  int eof;                    /* nonzero => nothing left to read into buf */
+  char *buf;
+  size_t size;                /* mapped length or buffer capacity */
+  const char *pos;            /* next unparsed byte */
+  const char *end;            /* end of the valid bytes in buf */
+  mem_addr_t last_addr[2];    /* previous data and instruction address */
+} trace_t;
+
+/* Type: Binary trace writer */
+typedef struct trace_writer {
+  FILE *fp;
+  mem_addr_t last_addr[2];
+} trace_writer_t;
+
+int trace_open(trace_t *trace, const char *path);
+int trace_next(trace_t *trace, int *op, mem_addr_t *addr, unsigned int *len);
+size_t trace_skip(trace_t *trace, size_t n, unsigned long long *accesses);
+void trace_close(trace_t *trace);
+
+int trace_writer_open(trace_writer_t *writer, FILE *fp);
+int trace_write(trace_writer_t *writer, int op, mem_addr_t addr,
+                unsigned int len);
+
+#endif // __trace_h__
@@ -0,0 +1,262 @@
+////////////////////////////////////////////////////////////////////////////////
+// Main File:        bench_policy.c
+// This File:        bench_policy.c
+// Other Files:      ../mem.h
+// Semester:         CS 354 Fall 2018
+//
+// Author:           Yuanhang Wang
+// Email:            wang2243@wisc.edu
+// CS Login:         ywang
+//
+/////////////////////////// OTHER SOURCES OF HELP //////////////////////////////
+//                   fully acknowledge and credit all sources of help,
+//                   other than Instructors and TAs.
+//
+// Persons:          Identify persons by name, relationship to you, and email.
+//                   Describe in detail the the ideas and help they provided.
+//
+// Online sources:   avoid web searches to solve your problems, but if you do
+//                   search, be sure to include Web URLs and description of
+//                   of any information you find.
+//////////////////////////// 80 columns wide ///////////////////////////////////
+
+/*
+ * Trace-driven comparison of the placement policies
+ *
+ * A trace is a text file with one request per line:
+ *   a <id> <size>    allocate 'size' bytes as block 'id'
+ *   r <id> <size>    resize block 'id' to 'size' bytes
+ *   f <id>           free block 'id'
+ * Blank lines and lines starting with '#' are skipped. Binary traces
+ * written by memrecord (see memtrace.h) are read as well.
+ *
+ * Every trace is replayed once per policy, each time in a fresh process
+ * with one big arena, and for each run this reports
+ *   ops/sec  - requests replayed per second
+ *   util     - peak bytes requested and live at the same time, divided by
+ *              the highest address the heap handed out, counted from the
+ *              start of the arena
+ *   visited  - free blocks looked at per search
+ * Slab bins are off unless -s is given, so every request goes through the
+ * placement policy.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <time.h>
+#include <sys/wait.h>
+#include "../mem.h"
+#include "memtrace.h"
+
+typedef struct request {
+    char op;
+    unsigned id;
+    size_t size;
+} request;
+
+typedef struct trace {
+    request *reqs;
+    size_t count;
+    unsigned max_id;
+} trace;
+
+static const char *policy_names[] = {"best", "first", "next", "good"};
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Reads the rest of the binary trace 'file' whose header is 'hdr' into 't'
+ * Returns 0 on success and -1 on failure
+ */
+static int read_binary(FILE *file, memtrace_hdr *hdr, trace *t) {
+    t->reqs = malloc((hdr->count + 1) * sizeof(request));
+    t->count = 0;
+    t->max_id = hdr->max_id;
+    memtrace_rec rec;
+    while (t->count < hdr->count && fread(&rec, sizeof(rec), 1, file) == 1) {
+        if (rec.op < MT_ALLOC || rec.op > MT_REALLOC || rec.id > hdr->max_id)
+            return -1;
+        t->reqs[t->count].op = " afr"[rec.op];
+        t->reqs[t->count].id = rec.id;
+        t->reqs[t->count].size = rec.size;
+        t->count++;
+    }
+    return t->count == hdr->count ? 0 : -1;
+}
+
+/*
+ * Reads the trace in 'path' into 't'
+ * Returns 0 on success and -1 on failure
+ */
+static int read_trace(const char *path, trace *t) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        perror(path);
+        return -1;
+    }
+    memtrace_hdr hdr;
+    if (fread(&hdr, sizeof(hdr), 1, file) == 1
+        && memcmp(hdr.magic, MEMTRACE_MAGIC, sizeof(hdr.magic)) == 0) {
+        int ret = read_binary(file, &hdr, t);
+        if (ret != 0)
+            fprintf(stderr, "%s: not a complete trace\n", path);
+        fclose(file);
+        return ret;
+    }
+    rewind(file);
+
+    size_t cap = 1024;
+    char line[256];
+    int line_no = 0;
+    t->reqs = malloc(cap * sizeof(request));
+    t->count = 0;
+    t->max_id = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        request req = {0};
+        line_no++;
+        if (line[0] == '#' || line[0] == '\n')
+            continue;
+        int n = sscanf(line, " %c %u %zu", &req.op, &req.id, &req.size);
+        if ((req.op != 'f' && n != 3) || (req.op == 'f' && n < 2)
+            || strchr("arf", req.op) == NULL) {
+            fprintf(stderr, "%s:%d: bad request\n", path, line_no);
+            fclose(file);
+            return -1;
+        }
+        if (t->count == cap) {
+            cap *= 2;
+            t->reqs = realloc(t->reqs, cap * sizeof(request));
+        }
+        t->reqs[t->count++] = req;
+        if (req.id > t->max_id)
+            t->max_id = req.id;
+    }
+    fclose(file);
+    return 0;
+}
+
+/*
+ * Replays 't' with placement policy 'policy' and prints the results
+ * Returns 0 on success and -1 if a request fails
+ */
+static int replay(const char *name, trace *t, int policy, int slab,
+                  int heap_mb) {
+    Tune_Mem(MEM_POLICY, policy);
+    Tune_Mem(MEM_SLAB, slab);
+    Tune_Mem(MEM_TRIM_IDLE, -1);
+    if (Init_Mem((size_t) heap_mb << 20) != 0)
+        return -1;
+
+    void **blocks = calloc(t->max_id + 1, sizeof(void *));
+    size_t *sizes = calloc(t->max_id + 1, sizeof(size_t));
+    size_t live = 0;
+    size_t peak_live = 0;
+    uintptr_t low = UINTPTR_MAX;
+    uintptr_t high = 0;
+
+    double start = now();
+    for (size_t i = 0; i < t->count; i++) {
+        request *req = &t->reqs[i];
+        void *ptr;
+        switch (req->op) {
+            case 'a':
+                ptr = Alloc_Mem(req->size);
+                break;
+            case 'r':
+                ptr = Realloc_Mem(blocks[req->id], req->size);
+                break;
+            default:
+                Free_Mem(blocks[req->id]);
+                blocks[req->id] = NULL;
+                live -= sizes[req->id];
+                sizes[req->id] = 0;
+                continue;
+        }
+        if (ptr == NULL) {
+            fprintf(stderr, "%s: request %zu failed\n", name, i + 1);
+            return -1;
+        }
+        blocks[req->id] = ptr;
+        live += req->size - sizes[req->id];
+        sizes[req->id] = req->size;
+        if (live > peak_live)
+            peak_live = live;
+        if ((uintptr_t) ptr < low)
+            low = (uintptr_t) ptr;
+        if ((uintptr_t) ptr + req->size > high)
+            high = (uintptr_t) ptr + req->size;
+    }
+    double elapsed = now() - start;
+
+    Mem_Stats stats;
+    Stats_Mem(&stats);
+    printf("%-20s %-6s %12.0f %7.1f%% %8.2f%s\n", name,
+           policy_names[policy], t->count / elapsed,
+           100.0 * peak_live / (high - low), stats.avg_visited,
+           stats.heap_size > (size_t) heap_mb << 20 ? "  (heap grew)" : "");
+    return 0;
+}
+
+static void print_usage(char *argv[]) {
+    printf("Usage: %s [-h] [-s] [-m <MiB>] [-k <K>] <trace>...\n", argv[0]);
+    printf("  -s        Keep the slab bins on\n");
+    printf("  -m <MiB>  Size of the arena (default: 1024)\n");
+    printf("  -k <K>    Candidates for good fit (default: 4)\n");
+}
+
+int main(int argc, char *argv[]) {
+    int slab = 0;
+    int heap_mb = 1024;
+    int good_fit_k = 4;
+    int c;
+
+    while ((c = getopt(argc, argv, "sm:k:h")) != -1) {
+        switch (c) {
+            case 's': slab = 1;
+                break;
+            case 'm': heap_mb = atoi(optarg);
+                break;
+            case 'k': good_fit_k = atoi(optarg);
+                break;
+            default: print_usage(argv);
+                return c == 'h' ? 0 : 1;
+        }
+    }
+    if (heap_mb < 1 || good_fit_k < 1 || optind == argc) {
+        print_usage(argv);
+        return 1;
+    }
+    Tune_Mem(MEM_GOOD_FIT_K, good_fit_k);
+
+    printf("%-20s %-6s %12s %8s %8s\n", "trace", "policy", "ops/sec", "util",
+           "visited");
+    for (int i = optind; i < argc; i++) {
+        trace t;
+        if (read_trace(argv[i], &t) != 0)
+            return 1;
+        const char *name = strrchr(argv[i], '/') != NULL
+                           ? strrchr(argv[i], '/') + 1 : argv[i];
+        for (int policy = MEM_FIT_BEST; policy <= MEM_FIT_GOOD; policy++) {
+            fflush(stdout);
+            pid_t pid = fork();
+            if (pid == 0)
+                exit(replay(name, &t, policy, slab, heap_mb) ? 1 : 0);
+            int status;
+            waitpid(pid, &status, 0);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                fprintf(stderr, "%s: replay of %s failed\n", argv[0], name);
+                return 1;
+            }
+        }
+        free(t.reqs);
+    }
+    return 0;
+}
@@ -0,0 +1,197 @@
+////////////////////////////////////////////////////////////////////////////////
+// Main File:        bench_threads.c
+// This File:        bench_threads.c
+// Other Files:      ../mem.h
+// Semester:         CS 354 Fall 2018
+//
+// Author:           Yuanhang Wang
+// Email:            wang2243@wisc.edu
+// CS Login:         ywang
+//
+/////////////////////////// OTHER SOURCES OF HELP //////////////////////////////
+//                   fully acknowledge and credit all sources of help,
+//                   other than Instructors and TAs.
+//
+// Persons:          Identify persons by name, relationship to you, and email.
+//                   Describe in detail the the ideas and help they provided.
+//
+// Online sources:   avoid web searches to solve your problems, but if you do
+//                   search, be sure to include Web URLs and description of
+//                   of any information you find.
+//////////////////////////// 80 columns wide ///////////////////////////////////
+
+/*
+ * Multi-threaded stress benchmark for libmem
+ *
+ * Every thread runs a random mix of Alloc_Mem/Free_Mem over its own set of
+ * slots (mostly 8-256 byte requests, some up to 4 KiB). One free in eight
+ * swaps the block into a shared exchange table instead and frees whatever
+ * block was there, which usually belongs to another thread.
+ *
+ * Two modes are measured, each in its own process since Init_Mem can only
+ * run once:
+ *   lock   - the plain allocator behind one global mutex
+ *   tcache - Tune_Mem(MEM_CONCURRENT, 1), per-thread caches
+ * and the throughput is reported for 1, 2, 4, ... up to N threads.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/wait.h>
+#include "../mem.h"
+
+#define SLOTS      1024
+#define EXCHANGE   4096
+
+static int ops_per_thread = 1000000;
+static int use_lock = 0;
+static pthread_mutex_t big_lock = PTHREAD_MUTEX_INITIALIZER;
+static void *exchange[EXCHANGE];
+
+static void *bench_alloc(int size) {
+    if (!use_lock)
+        return Alloc_Mem(size);
+    pthread_mutex_lock(&big_lock);
+    void *ptr = Alloc_Mem(size);
+    pthread_mutex_unlock(&big_lock);
+    return ptr;
+}
+
+static void bench_free(void *ptr) {
+    if (ptr == NULL)
+        return;
+    if (!use_lock) {
+        Free_Mem(ptr);
+        return;
+    }
+    pthread_mutex_lock(&big_lock);
+    Free_Mem(ptr);
+    pthread_mutex_unlock(&big_lock);
+}
+
+static inline uint32_t xorshift(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+static void *worker(void *arg) {
+    void *slots[SLOTS] = {0};
+    uint32_t rng = 2463534242u + (uint32_t) (uintptr_t) arg * 7919;
+
+    for (int i = 0; i < ops_per_thread; i++) {
+        uint32_t r = xorshift(&rng);
+        int slot = r % SLOTS;
+        if (slots[slot] == NULL) {
+            int size = (r >> 10) % 10 ? 8 + (r >> 16) % 249
+                                      : 257 + (r >> 16) % 3840;
+            slots[slot] = bench_alloc(size);
+            if (slots[slot] != NULL)
+                *(char *) slots[slot] = (char) i;
+        } else if ((r >> 10) % 8 == 0) {
+            void **cell = &exchange[(r >> 13) % EXCHANGE];
+            bench_free(__atomic_exchange_n(cell, slots[slot],
+                                           __ATOMIC_ACQ_REL));
+            slots[slot] = NULL;
+        } else {
+            bench_free(slots[slot]);
+            slots[slot] = NULL;
+        }
+    }
+    for (int slot = 0; slot < SLOTS; slot++)
+        bench_free(slots[slot]);
+    return NULL;
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Runs the benchmark for 1..max_threads threads in the current process
+ */
+static int run_mode(const char *mode, int max_threads, int heap_mb) {
+    if (!use_lock && Tune_Mem(MEM_CONCURRENT, 1) != 0)
+        return -1;
+    if (Init_Mem((size_t) heap_mb << 20) != 0)
+        return -1;
+
+    pthread_t *tids = malloc(sizeof(pthread_t) * max_threads);
+    double base = 0;
+    for (int n = 1; ; n = n * 2 < max_threads ? n * 2 : max_threads) {
+        double start = now();
+        for (int t = 0; t < n; t++)
+            pthread_create(&tids[t], NULL, worker, (void *) (uintptr_t) t);
+        for (int t = 0; t < n; t++)
+            pthread_join(tids[t], NULL);
+        for (int i = 0; i < EXCHANGE; i++) {
+            bench_free(exchange[i]);
+            exchange[i] = NULL;
+        }
+        double ops = (double) n * ops_per_thread / (now() - start);
+        if (n == 1)
+            base = ops;
+        printf("%-8s %7d %14.0f %8.2fx\n", mode, n, ops, ops / base);
+        fflush(stdout);
+        if (n == max_threads)
+            break;
+    }
+    free(tids);
+    return 0;
+}
+
+static void print_usage(char *argv[]) {
+    printf("Usage: %s [-h] [-t <threads>] [-n <ops>] [-m <MiB>]\n", argv[0]);
+    printf("  -t <threads>  Highest thread count (default: online cores)\n");
+    printf("  -n <ops>      Operations per thread (default: 1000000)\n");
+    printf("  -m <MiB>      Heap size (default: 64)\n");
+}
+
+int main(int argc, char *argv[]) {
+    int max_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    int heap_mb = 64;
+    int c;
+
+    while ((c = getopt(argc, argv, "t:n:m:h")) != -1) {
+        switch (c) {
+            case 't': max_threads = atoi(optarg);
+                break;
+            case 'n': ops_per_thread = atoi(optarg);
+                break;
+            case 'm': heap_mb = atoi(optarg);
+                break;
+            default: print_usage(argv);
+                return c == 'h' ? 0 : 1;
+        }
+    }
+    if (max_threads < 1 || ops_per_thread < 1 || heap_mb < 1) {
+        print_usage(argv);
+        return 1;
+    }
+
+    printf("%-8s %7s %14s %9s\n", "mode", "threads", "ops/sec", "speedup");
+    for (use_lock = 1; use_lock >= 0; use_lock--) {
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid == 0)
+            exit(run_mode(use_lock ? "lock" : "tcache", max_threads,
+                          heap_mb) ? 1 : 0);
+        int status;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            fprintf(stderr, "%s: benchmark failed\n", argv[0]);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,119 @@
+////////////////////////////////////////////////////////////////////////////////
+// Main File:        gen_trace.c
+// This File:        gen_trace.c
+// Other Files:
+// Semester:         CS 354 Fall 2018
+//
+// Author:           Yuanhang Wang
+// Email:            wang2243@wisc.edu
+// CS Login:         ywang
+//
+/////////////////////////// OTHER SOURCES OF HELP //////////////////////////////
+//                   fully acknowledge and credit all sources of help,
+//                   other than Instructors and TAs.
+//
+// Persons:          Identify persons by name, relationship to you, and email.
+//                   Describe in detail the the ideas and help they provided.
+//
+// Online sources:   avoid web searches to solve your problems, but if you do
+//                   search, be sure to include Web URLs and description of
+//                   of any information you find.
+//////////////////////////// 80 columns wide ///////////////////////////////////
+
+/*
+ * Writes synthetic allocation traces for bench_policy to stdout
+ *   mixed   - random alloc/free, mostly small blocks, some up to 64 KiB
+ *   phases  - waves of short-lived small objects around long-lived
+ *             buffers, the pattern that fragments a heap
+ *   realloc - buffers growing by realloc next to small allocations
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SLOTS 4096
+
+static unsigned state = 1;
+
+static unsigned next_rand(void) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static unsigned small_size(void) {
+    return 8 + next_rand() % 249;
+}
+
+static void gen_mixed(int ops) {
+    static int live[SLOTS];
+    for (int i = 0; i < ops; i++) {
+        int id = next_rand() % SLOTS;
+        if (live[id]) {
+            printf("f %d\n", id);
+        } else {
+            unsigned x = next_rand();
+            printf("a %d %u\n", id, x % 8 ? small_size() : 8 + x % 65536);
+        }
+        live[id] = !live[id];
+    }
+}
+
+static void gen_phases(int ops) {
+    int next_id = 0;
+    int *wave = malloc(sizeof(int) * ops);
+    while (ops > 0) {
+        // A long-lived buffer, then a wave of small objects that mostly die
+        printf("a %d %u\n", next_id++, 4096 + next_rand() % 60000);
+        int n = 500 + next_rand() % 1500;
+        for (int i = 0; i < n; i++) {
+            wave[i] = next_id++;
+            printf("a %d %u\n", wave[i], small_size());
+        }
+        for (int i = 0; i < n; i++)
+            if (next_rand() % 10 != 0)
+                printf("f %d\n", wave[i]);
+        ops -= 1 + 2 * n;
+    }
+    free(wave);
+}
+
+static void gen_realloc(int ops) {
+    static unsigned len[64];
+    int id = 64;
+    for (int i = 0; i < ops; i++) {
+        int buf = next_rand() % 64;
+        if (len[buf] > (1 << 18)) {
+            printf("f %d\n", buf);
+            len[buf] = 0;
+        } else if (len[buf] == 0) {
+            len[buf] = 1 + next_rand() % 256;
+            printf("a %d %u\n", buf, len[buf]);
+        } else {
+            len[buf] += 1 + next_rand() % 512;
+            printf("r %d %u\n", buf, len[buf]);
+        }
+        // Small objects that live for a while
+        printf("a %d %u\n", id, small_size());
+        if (id >= 64 + 256)
+            printf("f %d\n", id - 256);
+        id++;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int ops = argc > 2 ? atoi(argv[2]) : 1000000;
+    if (argc > 1 && strcmp(argv[1], "mixed") == 0)
+        gen_mixed(ops);
+    else if (argc > 1 && strcmp(argv[1], "phases") == 0)
+        gen_phases(ops);
+    else if (argc > 1 && strcmp(argv[1], "realloc") == 0)
+        gen_realloc(ops);
+    else {
+        fprintf(stderr, "Usage: %s mixed|phases|realloc [ops]\n", argv[0]);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,376 @@
+////////////////////////////////////////////////////////////////////////////////
+// Main File:        memrecord.c
+// This File:        memrecord.c
+// Other Files:      memtrace.h
+// Semester:         CS 354 Fall 2018
+//
+// Author:           Yuanhang Wang
+// Email:            wang2243@wisc.edu
+// CS Login:         ywang
+//
+/////////////////////////// OTHER SOURCES OF HELP //////////////////////////////
+//                   fully acknowledge and credit all sources of help,
+//                   other than Instructors and TAs.
+//
+// Persons:          Identify persons by name, relationship to you, and email.
+//                   Describe in detail the the ideas and help they provided.
+//
+// Online sources:   avoid web searches to solve your problems, but if you do
+//                   search, be sure to include Web URLs and description of
+//                   of any information you find.
+//////////////////////////// 80 columns wide ///////////////////////////////////
+
+/*
+ * Allocation trace recorder, see memtrace.h for the format
+ *
+ *     LD_PRELOAD=./bench/libmemrecord.so MEMTRACE_FILE=app.trace program
+ *
+ * Every malloc, calloc, realloc, free and aligned allocation the program
+ * makes is passed on to the next allocator (normally libc's) and appended
+ * to the trace. Without MEMTRACE_FILE the trace goes to memtrace.<pid>.
+ * Calls from all threads are recorded in the order they take the lock.
+ * A forked child stops recording, it would share the parent's file.
+ *
+ * The recorder must not allocate itself: the block-to-id table and the
+ * list of free ids live in mmap'ed memory and records are buffered in a
+ * static array that is written out with write(2).
+ */
+
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "memtrace.h"
+
+#define BUF_RECS   65536
+#define BOOT_SIZE  8192
+
+static void *(*next_malloc)(size_t);
+static void *(*next_calloc)(size_t, size_t);
+static void *(*next_realloc)(void *, size_t);
+static void (*next_free)(void *);
+static int (*next_posix_memalign)(void **, size_t, size_t);
+static void *(*next_aligned_alloc)(size_t, size_t);
+static void *(*next_memalign)(size_t, size_t);
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static int state = 0;            // 0 new, 1 resolving, 2 recording, 3 off
+static int fd = -1;
+static uint64_t count = 0;       // Records written so far
+static uint32_t max_id = 0;
+static memtrace_rec buf[BUF_RECS];
+static int buffered = 0;
+
+// dlsym may allocate before the next allocator is known
+static char boot_mem[BOOT_SIZE] __attribute__((aligned(16)));
+static size_t boot_used = 0;
+
+/*
+ * Open addressing table from block address to id, with linear probing
+ * and backward shift deletion, plus a stack of ids that are free again
+ */
+typedef struct slot {
+    uintptr_t addr;   // 0 => empty
+    uint32_t id;
+} slot;
+
+static slot *table = NULL;
+static size_t table_cap = 0;     // Power of two
+static size_t table_used = 0;
+static uint32_t *free_ids = NULL;
+static size_t free_ids_cap = 0;
+static size_t free_ids_top = 0;
+
+static void *map(size_t size) {
+    void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return ptr == MAP_FAILED ? NULL : ptr;
+}
+
+static inline size_t hash(uintptr_t addr) {
+    return (addr >> 4) * 0x9e3779b97f4a7c15ull >> 20;
+}
+
+static void table_put(uintptr_t addr, uint32_t id);
+
+static int table_grow(void) {
+    size_t old_cap = table_cap;
+    slot *old = table;
+    size_t cap = old_cap ? old_cap * 2 : 1 << 16;
+    slot *fresh = map(cap * sizeof(slot));
+    if (fresh == NULL)
+        return -1;
+    table = fresh;
+    table_cap = cap;
+    table_used = 0;
+    for (size_t i = 0; i < old_cap; i++)
+        if (old[i].addr != 0)
+            table_put(old[i].addr, old[i].id);
+    if (old != NULL)
+        munmap(old, old_cap * sizeof(slot));
+    return 0;
+}
+
+static void table_put(uintptr_t addr, uint32_t id) {
+    size_t i = hash(addr) & (table_cap - 1);
+    while (table[i].addr != 0 && table[i].addr != addr)
+        i = (i + 1) & (table_cap - 1);
+    if (table[i].addr == 0)
+        table_used++;
+    table[i].addr = addr;
+    table[i].id = id;
+}
+
+/*
+ * Removes 'addr' from the table
+ * Returns its id, or UINT32_MAX if it was not there
+ */
+static uint32_t table_take(uintptr_t addr) {
+    if (table_cap == 0)
+        return UINT32_MAX;
+    size_t mask = table_cap - 1;
+    size_t i = hash(addr) & mask;
+    while (table[i].addr != addr) {
+        if (table[i].addr == 0)
+            return UINT32_MAX;
+        i = (i + 1) & mask;
+    }
+    uint32_t id = table[i].id;
+    // Shift back the entries that probed past the hole
+    for (size_t j = (i + 1) & mask; table[j].addr != 0; j = (j + 1) & mask) {
+        size_t home = hash(table[j].addr) & mask;
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            table[i] = table[j];
+            i = j;
+        }
+    }
+    table[i].addr = 0;
+    table_used--;
+    return id;
+}
+
+static uint32_t new_id(void) {
+    if (free_ids_top > 0)
+        return free_ids[--free_ids_top];
+    return max_id++;
+}
+
+static void release_id(uint32_t id) {
+    if (free_ids_top == free_ids_cap) {
+        size_t cap = free_ids_cap ? free_ids_cap * 2 : 1 << 16;
+        uint32_t *fresh = map(cap * sizeof(uint32_t));
+        if (fresh == NULL)
+            return;  // The id is just not reused
+        if (free_ids != NULL) {
+            memcpy(fresh, free_ids, free_ids_cap * sizeof(uint32_t));
+            munmap(free_ids, free_ids_cap * sizeof(uint32_t));
+        }
+        free_ids = fresh;
+        free_ids_cap = cap;
+    }
+    free_ids[free_ids_top++] = id;
+}
+
+static void flush(void) {
+    size_t len = buffered * sizeof(memtrace_rec);
+    char *data = (char *) buf;
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n <= 0) {
+            state = 3;  // Give up on the trace rather than the program
+            return;
+        }
+        data += n;
+        len -= n;
+    }
+    count += buffered;
+    buffered = 0;
+}
+
+static void append(int op, uint32_t id, size_t size) {
+    memtrace_rec *rec = &buf[buffered++];
+    memset(rec, 0, sizeof(*rec));
+    rec->op = op;
+    rec->id = id;
+    rec->size = size;
+    if (buffered == BUF_RECS)
+        flush();
+}
+
+/*
+ * Records the calls, 'old' is the block given back (or NULL) and 'ptr'
+ * the block handed out (or NULL)
+ */
+static void record(void *old, void *ptr, size_t size) {
+    if (state != 2)
+        return;
+    pthread_mutex_lock(&lock);
+    if (state == 2) {
+        uint32_t id = old != NULL ? table_take((uintptr_t) old) : UINT32_MAX;
+        if (old != NULL && ptr != NULL && id != UINT32_MAX) {
+            if (table_used * 2 >= table_cap && table_grow() != 0)
+                state = 3;
+            else
+                table_put((uintptr_t) ptr, id);
+            append(MT_REALLOC, id, size);
+        } else {
+            if (id != UINT32_MAX) {
+                append(MT_FREE, id, 0);
+                release_id(id);
+            }
+            if (ptr != NULL) {
+                if (table_used * 2 >= table_cap && table_grow() != 0) {
+                    state = 3;
+                } else {
+                    id = new_id();
+                    table_put((uintptr_t) ptr, id);
+                    append(MT_ALLOC, id, size);
+                }
+            }
+        }
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+static void stop_in_child(void) {
+    state = 3;
+}
+
+/*
+ * Finds the next allocator and opens the trace
+ */
+static void start(void) {
+    state = 1;
+    next_malloc = dlsym(RTLD_NEXT, "malloc");
+    next_calloc = dlsym(RTLD_NEXT, "calloc");
+    next_realloc = dlsym(RTLD_NEXT, "realloc");
+    next_free = dlsym(RTLD_NEXT, "free");
+    next_posix_memalign = dlsym(RTLD_NEXT, "posix_memalign");
+    next_aligned_alloc = dlsym(RTLD_NEXT, "aligned_alloc");
+    next_memalign = dlsym(RTLD_NEXT, "memalign");
+
+    char path[64];
+    const char *file = getenv("MEMTRACE_FILE");
+    if (file == NULL) {
+        snprintf(path, sizeof(path), "memtrace.%d", (int) getpid());
+        file = path;
+    }
+    memtrace_hdr hdr = {MEMTRACE_MAGIC, 0, 0, 0, 0};
+    fd = open(file, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0 || write(fd, &hdr, sizeof(hdr)) != sizeof(hdr)) {
+        state = 3;
+        return;
+    }
+    pthread_atfork(NULL, NULL, stop_in_child);
+    state = 2;
+}
+
+/*
+ * Writes the last records and the final header when the program exits
+ */
+__attribute__((destructor)) static void finish(void) {
+    pthread_mutex_lock(&lock);
+    if (state == 2) {
+        flush();
+        memtrace_hdr hdr = {MEMTRACE_MAGIC, count, max_id, 0, 0};
+        if (pwrite(fd, &hdr, sizeof(hdr), 0) != sizeof(hdr))
+            fprintf(stderr, "memrecord: cannot finish the trace\n");
+        close(fd);
+        state = 3;
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+static inline int ready(void) {
+    if (state == 0) {
+        pthread_mutex_lock(&lock);
+        if (state == 0)
+            start();
+        pthread_mutex_unlock(&lock);
+    }
+    return state != 1;
+}
+
+static void *boot_alloc(size_t size) {
+    size = (size + 15) & ~(size_t) 15;
+    if (boot_used + size > BOOT_SIZE)
+        return NULL;
+    boot_used += size;
+    return boot_mem + boot_used - size;  // Already zero
+}
+
+static inline int is_boot(void *ptr) {
+    return (char *) ptr >= boot_mem && (char *) ptr < boot_mem + BOOT_SIZE;
+}
+
+void *malloc(size_t size) {
+    if (!ready())
+        return boot_alloc(size);
+    void *ptr = next_malloc(size);
+    record(NULL, ptr, size);
+    return ptr;
+}
+
+void *calloc(size_t nmemb, size_t size) {
+    if (!ready())
+        return boot_alloc(nmemb * size);
+    void *ptr = next_calloc(nmemb, size);
+    record(NULL, ptr, nmemb * size);
+    return ptr;
+}
+
+void *realloc(void *old, size_t size) {
+    if (!ready() || is_boot(old)) {
+        void *ptr = state == 1 ? boot_alloc(size) : malloc(size);
+        if (ptr != NULL && old != NULL) {
+            size_t room = boot_mem + BOOT_SIZE - (char *) old;
+            memmove(ptr, old, size < room ? size : room);
+        }
+        return ptr;
+    }
+    void *ptr = next_realloc(old, size);
+    if (ptr != NULL || size == 0)
+        record(old, ptr, size);
+    return ptr;
+}
+
+void free(void *ptr) {
+    if (ptr == NULL || is_boot(ptr))
+        return;
+    if (ready()) {
+        record(ptr, NULL, 0);
+        next_free(ptr);
+    }
+}
+
+int posix_memalign(void **memptr, size_t alignment, size_t size) {
+    if (!ready())
+        return ENOMEM;
+    int ret = next_posix_memalign(memptr, alignment, size);
+    if (ret == 0)
+        record(NULL, *memptr, size);
+    return ret;
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+    if (!ready())
+        return NULL;
+    void *ptr = next_aligned_alloc(alignment, size);
+    record(NULL, ptr, size);
+    return ptr;
+}
+
+void *memalign(size_t alignment, size_t size) {
+    if (!ready())
+        return NULL;
+    void *ptr = next_memalign(alignment, size);
+    record(NULL, ptr, size);
+    return ptr;
+}
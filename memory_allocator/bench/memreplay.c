@@ -0,0 +1,285 @@
+////////////////////////////////////////////////////////////////////////////////
+// Main File:        memreplay.c
+// This File:        memreplay.c
+// Other Files:      memtrace.h ../mem.h
+// Semester:         CS 354 Fall 2018
+//
+// Author:           Yuanhang Wang
+// Email:            wang2243@wisc.edu
+// CS Login:         ywang
+//
+/////////////////////////// OTHER SOURCES OF HELP //////////////////////////////
+//                   fully acknowledge and credit all sources of help,
+//                   other than Instructors and TAs.
+//
+// Persons:          Identify persons by name, relationship to you, and email.
+//                   Describe in detail the the ideas and help they provided.
+//
+// Online sources:   avoid web searches to solve your problems, but if you do
+//                   search, be sure to include Web URLs and description of
+//                   of any information you find.
+//////////////////////////// 80 columns wide ///////////////////////////////////
+
+/*
+ * Replays a binary allocation trace (see memtrace.h) through libmem
+ *
+ * The trace is mmap'ed and read in place. Every call is timed with the
+ * time stamp counter, and the latencies of each kind of call are kept in
+ * a log-linear histogram (32 buckets per power of two), from which the
+ * mean, p50, p99, p99.9 and maximum are reported. The cost of reading
+ * the counter is measured first and taken off.
+ *
+ * The utilization of the heap is sampled at regular intervals: the bytes
+ * the trace has live at that point, the bytes of busy blocks and the size
+ * of the heap.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../mem.h"
+#include "memtrace.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static inline uint64_t cycles(void) {
+    return __rdtsc();
+}
+#else
+static inline uint64_t cycles(void) {  // Nanoseconds stand in for cycles
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+#endif
+
+#define SUB_BITS  5
+#define SUBS      (1 << SUB_BITS)
+#define BUCKETS   (64 * SUBS)
+
+static const char *op_names[] = {"", "alloc", "free", "realloc"};
+static uint64_t hist[4][BUCKETS];
+static uint64_t op_count[4];
+static uint64_t op_total[4];
+static uint64_t op_max[4];
+
+/*
+ * Returns the histogram bucket of 'value': exact below 2 * SUBS, then
+ * SUBS buckets for every power of two
+ */
+static inline int bucket(uint64_t value) {
+    if (value < 2 * SUBS)
+        return value;
+    int exp = 63 - __builtin_clzll(value);
+    return (exp - SUB_BITS + 1) * SUBS
+           + (int) (value >> (exp - SUB_BITS) & (SUBS - 1));
+}
+
+/*
+ * Returns the smallest value that falls into bucket 'b'
+ */
+static uint64_t bucket_low(int b) {
+    if (b < 2 * SUBS)
+        return b;
+    int exp = b / SUBS + SUB_BITS - 1;
+    return ((uint64_t) (SUBS + b % SUBS)) << (exp - SUB_BITS);
+}
+
+/*
+ * Returns the value below which 'fraction' of the samples of 'op' fall
+ */
+static uint64_t percentile(int op, double fraction) {
+    uint64_t rank = (uint64_t) (fraction * op_count[op]);
+    uint64_t seen = 0;
+    for (int b = 0; b < BUCKETS; b++) {
+        seen += hist[op][b];
+        if (seen > rank)
+            return bucket_low(b);
+    }
+    return op_max[op];
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Returns the smallest number of cycles between two readings
+ */
+static uint64_t timer_overhead(void) {
+    uint64_t best = UINT64_MAX;
+    for (int i = 0; i < 10000; i++) {
+        uint64_t start = cycles();
+        uint64_t delta = cycles() - start;
+        if (delta < best)
+            best = delta;
+    }
+    return best;
+}
+
+static void print_usage(char *argv[]) {
+    printf("Usage: %s [-h] [-c] [-s] [-p <policy>] [-m <MiB>] [-n <samples>] "
+           "<trace>\n", argv[0]);
+    printf("  -c           Concurrent mode\n");
+    printf("  -s           Slab bins off\n");
+    printf("  -p <policy>  best, first, next or good (default: best)\n");
+    printf("  -m <MiB>     Initial heap size (default: 16)\n");
+    printf("  -n <samples> Utilization samples (default: 20)\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *policies[] = {"best", "first", "next", "good"};
+    int concurrent = 0;
+    int slab = 1;
+    int policy = MEM_FIT_BEST;
+    int heap_mb = 16;
+    int samples = 20;
+    int c;
+
+    while ((c = getopt(argc, argv, "csp:m:n:h")) != -1) {
+        switch (c) {
+            case 'c': concurrent = 1;
+                break;
+            case 's': slab = 0;
+                break;
+            case 'p':
+                for (policy = MEM_FIT_GOOD; policy >= 0; policy--)
+                    if (strcmp(optarg, policies[policy]) == 0)
+                        break;
+                break;
+            case 'm': heap_mb = atoi(optarg);
+                break;
+            case 'n': samples = atoi(optarg);
+                break;
+            default: print_usage(argv);
+                return c == 'h' ? 0 : 1;
+        }
+    }
+    if (policy < 0 || heap_mb < 1 || samples < 1 || optind != argc - 1) {
+        print_usage(argv);
+        return 1;
+    }
+
+    // Map the trace
+    const char *path = argv[optind];
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        perror(path);
+        return 1;
+    }
+    const memtrace_hdr *hdr = NULL;
+    if ((size_t) st.st_size >= sizeof(memtrace_hdr))
+        hdr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (hdr == NULL || hdr == MAP_FAILED
+        || memcmp(hdr->magic, MEMTRACE_MAGIC, sizeof(hdr->magic)) != 0
+        || hdr->count > (st.st_size - sizeof(memtrace_hdr))
+                        / sizeof(memtrace_rec)) {
+        fprintf(stderr, "%s: not a complete trace\n", path);
+        return 1;
+    }
+    const memtrace_rec *recs = (const memtrace_rec *) (hdr + 1);
+    madvise((void *) hdr, st.st_size, MADV_SEQUENTIAL);
+
+    void **blocks = calloc(hdr->max_id + 1, sizeof(void *));
+    uint64_t *sizes = calloc(hdr->max_id + 1, sizeof(uint64_t));
+    if (blocks == NULL || sizes == NULL) {
+        fprintf(stderr, "%s: out of memory\n", argv[0]);
+        return 1;
+    }
+
+    Tune_Mem(MEM_CONCURRENT, concurrent);
+    Tune_Mem(MEM_SLAB, slab);
+    Tune_Mem(MEM_POLICY, policy);
+    if (Init_Mem((size_t) heap_mb << 20) != 0)
+        return 1;
+
+    uint64_t overhead = timer_overhead();
+    uint64_t interval = hdr->count / samples + 1;
+    uint64_t live = 0;
+    uint64_t failed = 0;
+    printf("%12s %14s %14s %14s %7s\n", "op", "live", "in use", "heap",
+           "util");
+
+    double start_time = now();
+    uint64_t start_cycles = cycles();
+    for (uint64_t i = 0; i < hdr->count; i++) {
+        const memtrace_rec *rec = &recs[i];
+        uint32_t id = rec->id;
+        int op = rec->op;
+        if (id > hdr->max_id || op < MT_ALLOC || op > MT_REALLOC) {
+            fprintf(stderr, "%s: bad record %llu\n", path,
+                    (unsigned long long) i);
+            return 1;
+        }
+        void *ptr = NULL;
+        uint64_t t0 = cycles();
+        if (op == MT_ALLOC)
+            ptr = Alloc_Mem(rec->size);
+        else if (op == MT_REALLOC)
+            ptr = Realloc_Mem(blocks[id], rec->size);
+        else
+            Free_Mem(blocks[id]);
+        uint64_t t1 = cycles();
+
+        uint64_t delta = t1 - t0 > overhead ? t1 - t0 - overhead : 0;
+        hist[op][bucket(delta)]++;
+        op_count[op]++;
+        op_total[op] += delta;
+        if (delta > op_max[op])
+            op_max[op] = delta;
+
+        if (op == MT_FREE || ptr != NULL) {
+            live -= sizes[id];
+            blocks[id] = ptr;
+            sizes[id] = ptr != NULL ? rec->size : 0;
+            live += sizes[id];
+        } else if (rec->size != 0) {
+            failed++;
+        }
+        if ((i + 1) % interval == 0 || i + 1 == hdr->count) {
+            Mem_Stats stats;
+            Stats_Mem(&stats);
+            printf("%12llu %14llu %14zu %14zu %6.1f%%\n",
+                   (unsigned long long) i + 1, (unsigned long long) live,
+                   stats.in_use, stats.heap_size,
+                   stats.heap_size ? 100.0 * live / stats.heap_size : 0);
+        }
+    }
+    double ns_per_cycle = (now() - start_time) * 1e9
+                          / (double) (cycles() - start_cycles);
+
+    printf("\n%-8s %12s %10s %10s %10s %10s %12s\n", "call", "count",
+           "mean", "p50", "p99", "p99.9", "max");
+    for (int op = MT_ALLOC; op <= MT_REALLOC; op++) {
+        if (op_count[op] == 0)
+            continue;
+        printf("%-8s %12llu", op_names[op], (unsigned long long) op_count[op]);
+        printf(" %8.1fns %8.1fns %8.1fns %8.1fns %10.1fns\n",
+               ns_per_cycle * op_total[op] / op_count[op],
+               ns_per_cycle * percentile(op, 0.5),
+               ns_per_cycle * percentile(op, 0.99),
+               ns_per_cycle * percentile(op, 0.999),
+               ns_per_cycle * op_max[op]);
+    }
+    uint64_t total = 0;
+    for (int op = MT_ALLOC; op <= MT_REALLOC; op++)
+        total += op_total[op];
+    printf("\n%llu calls, %.3f ns per cycle, %.0f calls/sec in the allocator",
+           (unsigned long long) hdr->count, ns_per_cycle,
+           hdr->count / (ns_per_cycle * total / 1e9));
+    if (failed != 0)
+        printf(", %llu failed", (unsigned long long) failed);
+    printf("\n");
+    return 0;
+}
@@ -0,0 +1,131 @@
+////////////////////////////////////////////////////////////////////////////////
+// Main File:        memrun.c
+// This File:        memrun.c
+// Other Files:
+// Semester:         CS 354 Fall 2018
+//
+// Author:           Yuanhang Wang
+// Email:            wang2243@wisc.edu
+// CS Login:         ywang
+//
+/////////////////////////// OTHER SOURCES OF HELP //////////////////////////////
+//                   fully acknowledge and credit all sources of help,
+//                   other than Instructors and TAs.
+//
+// Persons:          Identify persons by name, relationship to you, and email.
+//                   Describe in detail the the ideas and help they provided.
+//
+// Online sources:   avoid web searches to solve your problems, but if you do
+//                   search, be sure to include Web URLs and description of
+//                   of any information you find.
+//////////////////////////// 80 columns wide ///////////////////////////////////
+
+/*
+ * Runs a command under libc's allocator and with a preloaded malloc
+ * library, and compares wall time and peak resident set size
+ * Each configuration runs 'reps' times, the fastest run and the largest
+ * peak RSS are reported.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Runs argv once, with LD_PRELOAD set to 'preload' unless it is NULL
+ * Returns 0 on success, and the wall time and peak RSS in KiB
+ */
+static int run_once(char *argv[], const char *preload, double *wall,
+                    long *rss) {
+    double start = now();
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (preload != NULL)
+            setenv("LD_PRELOAD", preload, 1);
+        execvp(argv[0], argv);
+        perror(argv[0]);
+        _exit(127);
+    }
+    int status;
+    struct rusage usage;
+    if (pid < 0 || wait4(pid, &status, 0, &usage) < 0)
+        return -1;
+    *wall = now() - start;
+    *rss = usage.ru_maxrss;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+static void print_usage(char *argv[]) {
+    printf("Usage: %s [-h] [-r <reps>] <lib.so> <command> [args...]\n",
+           argv[0]);
+    printf("  -r <reps>  Runs per allocator (default: 3)\n");
+}
+
+int main(int argc, char *argv[]) {
+    int reps = 3;
+    int c;
+
+    while ((c = getopt(argc, argv, "+r:h")) != -1) {
+        switch (c) {
+            case 'r': reps = atoi(optarg);
+                break;
+            default: print_usage(argv);
+                return c == 'h' ? 0 : 1;
+        }
+    }
+    if (reps < 1 || argc - optind < 2) {
+        print_usage(argv);
+        return 1;
+    }
+    // The library has to be found from the directory the command runs in
+    char *preload = realpath(argv[optind], NULL);
+    if (preload == NULL) {
+        perror(argv[optind]);
+        return 1;
+    }
+    char **cmd = argv + optind + 1;
+
+    char name[64] = "";
+    for (char **arg = cmd; *arg != NULL; arg++) {
+        const char *base = arg == cmd && strrchr(*arg, '/') != NULL
+                           ? strrchr(*arg, '/') + 1 : *arg;
+        snprintf(name + strlen(name), sizeof(name) - strlen(name), "%s%s",
+                 arg == cmd ? "" : " ", base);
+    }
+
+    double wall[2];
+    long rss[2];
+    for (int lib = 0; lib < 2; lib++) {
+        wall[lib] = 0;
+        rss[lib] = 0;
+        for (int i = 0; i < reps; i++) {
+            double t;
+            long r;
+            if (run_once(cmd, lib ? preload : NULL, &t, &r) != 0) {
+                fprintf(stderr, "%s: '%s' failed under %s\n", argv[0], name,
+                        lib ? "libmem" : "libc");
+                return 1;
+            }
+            if (i == 0 || t < wall[lib])
+                wall[lib] = t;
+            if (r > rss[lib])
+                rss[lib] = r;
+        }
+    }
+    printf("%-20s %9.3f %9.3f %7.2fx %10ld %10ld %7.2fx\n", name, wall[0],
+           wall[1], wall[0] / wall[1], rss[0], rss[1],
+           (double) rss[1] / rss[0]);
+    free(preload);
+    return 0;
+}
@@ -0,0 +1,63 @@
+////////////////////////////////////////////////////////////////////////////////
+// Main File:        memreplay.c
+// This File:        memtrace.h
+// Other Files:      memrecord.c memreplay.c bench_policy.c
+// Semester:         CS 354 Fall 2018
+//
+// Author:           Yuanhang Wang
+// Email:            wang2243@wisc.edu
+// CS Login:         ywang
+//
+/////////////////////////// OTHER SOURCES OF HELP //////////////////////////////
+//                   fully acknowledge and credit all sources of help,
+//                   other than Instructors and TAs.
+//
+// Persons:          Identify persons by name, relationship to you, and email.
+//                   Describe in detail the the ideas and help they provided.
+//
+// Online sources:   avoid web searches to solve your problems, but if you do
+//                   search, be sure to include Web URLs and description of
+//                   of any information you find.
+//////////////////////////// 80 columns wide ///////////////////////////////////
+
+#ifndef __memtrace_h__
+#define __memtrace_h__
+
+#include <stdint.h>
+
+/*
+ * Binary allocation trace format
+ *
+ * A trace is a header followed by 'count' fixed size records, in the
+ * order the calls were made. Every field has its natural alignment and
+ * the byte order of the machine that recorded it, so a trace can be
+ * mmap'ed and used in place.
+ *
+ * Ids name blocks: an alloc gives a block an id, a realloc keeps it and
+ * a free ends it, after which the id may be given to a new block. Ids of
+ * live blocks are always below max_id.
+ */
+
+#define MEMTRACE_MAGIC "MEMTRC01"
+
+/* Ops of a record */
+#define MT_ALLOC   1  // malloc, calloc and the aligned variants
+#define MT_FREE    2
+#define MT_REALLOC 3  // 'size' is the new size
+
+typedef struct memtrace_hdr {
+    char magic[8];        // MEMTRACE_MAGIC, not NUL terminated
+    uint64_t count;       // Records that follow
+    uint32_t max_id;      // Ids in use are below this
+    uint32_t reserved;
+    uint64_t reserved2;
+} memtrace_hdr;
+
+typedef struct memtrace_rec {
+    uint8_t op;           // MT_*
+    uint8_t pad[3];
+    uint32_t id;          // Block the op is for
+    uint64_t size;        // Requested bytes, 0 for MT_FREE
+} memtrace_rec;
+
+#endif // __memtrace_h__
@@ -0,0 +1,156 @@
+////////////////////////////////////////////////////////////////////////////////
+// Main File:        workload.c
+// This File:        workload.c
+// Other Files:
+// Semester:         CS 354 Fall 2018
+//
+// Author:           Yuanhang Wang
+// Email:            wang2243@wisc.edu
+// CS Login:         ywang
+//
+/////////////////////////// OTHER SOURCES OF HELP //////////////////////////////
+//                   fully acknowledge and credit all sources of help,
+//                   other than Instructors and TAs.
+//
+// Persons:          Identify persons by name, relationship to you, and email.
+//                   Describe in detail the the ideas and help they provided.
+//
+// Online sources:   avoid web searches to solve your problems, but if you do
+//                   search, be sure to include Web URLs and description of
+//                   of any information you find.
+//////////////////////////// 80 columns wide ///////////////////////////////////
+
+/*
+ * Allocation-heavy workloads that only use the standard malloc API, to
+ * be run under libc's allocator and under libmem_malloc.so (see memrun)
+ *   small   - builds and tears down linked lists of 16-128 byte nodes
+ *   mixed   - random malloc/free of 8 B - 64 KiB blocks, mostly small
+ *   realloc - grows many buffers one chunk at a time
+ *   threads - 'mixed' in 4 threads, a quarter of the frees cross threads
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+#define THREADS  4
+#define SLOTS    8192
+#define EXCHANGE 1024
+
+typedef struct node {
+    struct node *next;
+    char data[];
+} node;
+
+static void *exchange[EXCHANGE];
+
+static unsigned next_rand(unsigned *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+static void run_small(void) {
+    unsigned r = 1;
+    for (int round = 0; round < 100; round++) {
+        node *head = NULL;
+        for (int i = 0; i < 100000; i++) {
+            size_t size = 16 + next_rand(&r) % 113;
+            node *n = malloc(size);
+            n->next = head;
+            memset(n->data, i, size - sizeof(node));
+            head = n;
+        }
+        while (head != NULL) {
+            node *next = head->next;
+            free(head);
+            head = next;
+        }
+    }
+}
+
+static size_t mixed_size(unsigned *r) {
+    unsigned x = next_rand(r);
+    if (x % 16 != 0)
+        return 8 + x / 16 % 249;
+    return 8 + x / 16 % 65536;
+}
+
+/*
+ * The 'mixed' loop, 'share' frees in 1024 go through the exchange table
+ */
+static void *run_mixed(void *arg) {
+    unsigned r = (uintptr_t) arg * 2654435761u + 1;
+    void **slots = calloc(SLOTS, sizeof(void *));
+    int share = arg == NULL ? 0 : 256;
+    for (int i = 0; i < 4000000; i++) {
+        unsigned x = next_rand(&r);
+        int k = x % SLOTS;
+        if (slots[k] == NULL) {
+            size_t size = mixed_size(&r);
+            slots[k] = malloc(size);
+            memset(slots[k], 0, size < 64 ? size : 64);
+        } else if ((int) (x >> 20 & 1023) < share) {
+            void **slot = &exchange[x >> 10 & (EXCHANGE - 1)];
+            free(__atomic_exchange_n(slot, slots[k], __ATOMIC_ACQ_REL));
+            slots[k] = NULL;
+        } else {
+            free(slots[k]);
+            slots[k] = NULL;
+        }
+    }
+    for (int k = 0; k < SLOTS; k++)
+        free(slots[k]);
+    free(slots);
+    return NULL;
+}
+
+static void run_realloc(void) {
+    char *bufs[256] = {0};
+    size_t lens[256] = {0};
+    unsigned r = 7;
+    for (int i = 0; i < 2000000; i++) {
+        int k = next_rand(&r) % 256;
+        size_t chunk = 1 + next_rand(&r) % 64;
+        if (lens[k] + chunk > (1 << 20)) {
+            free(bufs[k]);
+            bufs[k] = NULL;
+            lens[k] = 0;
+        }
+        bufs[k] = realloc(bufs[k], lens[k] + chunk);
+        memset(bufs[k] + lens[k], k, chunk);
+        lens[k] += chunk;
+    }
+    for (int k = 0; k < 256; k++)
+        free(bufs[k]);
+}
+
+static void run_threads(void) {
+    pthread_t tids[THREADS];
+    for (int t = 0; t < THREADS; t++)
+        pthread_create(&tids[t], NULL, run_mixed, (void *) (uintptr_t) (t + 1));
+    for (int t = 0; t < THREADS; t++)
+        pthread_join(tids[t], NULL);
+    for (int i = 0; i < EXCHANGE; i++)
+        free(exchange[i]);
+}
+
+int main(int argc, char *argv[]) {
+    const char *name = argc > 1 ? argv[1] : "";
+    if (strcmp(name, "small") == 0)
+        run_small();
+    else if (strcmp(name, "mixed") == 0)
+        run_mixed(NULL);
+    else if (strcmp(name, "realloc") == 0)
+        run_realloc();
+    else if (strcmp(name, "threads") == 0)
+        run_threads();
+    else {
+        printf("Usage: %s small|mixed|realloc|threads\n", argv[0]);
+        return 1;
+    }
+    return 0;
+}
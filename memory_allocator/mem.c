@@ -21,13 +21,16 @@
 //////////////////////////// 80 columns wide ///////////////////////////////////
 
 #include <stdio.h>
+#include <stdint.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <string.h>
+#include <pthread.h>
 #include "mem.h"
+#include "mem_internal.h"
 
 /*
  * This structure serves as the header for each allocated and free block
@@ -35,44 +38,185 @@
  * The blocks are ordered in the increasing order of addresses
  */
 typedef struct blk_hdr {
-    int size_status;
+    size_t size_status;
 
     /*
-    * Size of the block is always a multiple of 8
-    * => last two bits are always zero - can be used to store other information
+    * Size of the block is always a multiple of 16
+    * => last four bits are always zero - can be used to store other information
     *
     * LSB -> Least Significant Bit (Last Bit)
     * SLB -> Second Last Bit
+    * TLB -> Third Last Bit
     * LSB = 0 => free block
     * LSB = 1 => allocated/busy block
     * SLB = 0 => previous block is free
     * SLB = 1 => previous block is allocated/busy
+    * TLB = 1 => free block whose payload has not been written to since it
+    *            was mapped, apart from its free list links and footer
     *
-    * When used as the footer the last two bits should be zero
+    * When used as the footer the last four bits should be zero
     */
 
     /*
     * Examples:
     *
-    * For a busy block with a payload of 20 bytes (i.e. 20 bytes data + an additional 4 bytes for header)
+    * For a busy block with a payload of 20 bytes (i.e. 20 bytes data + an additional 8 bytes for header)
     * Header:
-    * If the previous block is allocated, size_status should be set to 27
-    * If the previous block is free, size_status should be set to 25
+    * If the previous block is allocated, size_status should be set to 35
+    * If the previous block is free, size_status should be set to 33
     *
-    * For a free block of size 24 bytes (including 4 bytes for header + 4 bytes for footer)
+    * For a free block of size 48 bytes (including 8 bytes for header + 8 bytes for footer)
     * Header:
-    * If the previous block is allocated, size_status should be set to 26
-    * If the previous block is free, size_status should be set to 24
+    * If the previous block is allocated, size_status should be set to 50
+    * If the previous block is free, size_status should be set to 48
     * Footer:
-    * size_status should be 24
+    * size_status should be 48
     *
     */
 } blk_hdr;
 
+/* Payloads are 16 byte aligned, block sizes are multiples of 16 */
+#define ALIGN 16
+#define FRESH 4
+
+/* Size of a block without the status bits */
+#define BLK_SIZE(blk) ((blk)->size_status & ~(size_t) (ALIGN - 1))
+
+/*
+ * Set and clear the p-bit of the block after one that changes state
+ * That block may be busy and owned by a thread that reads its header
+ * without heap_lock (see heap_usable), so the update is atomic.
+ */
+#define SET_PBIT(blk) \
+    __atomic_fetch_or(&(blk)->size_status, 2, __ATOMIC_RELAXED)
+#define CLEAR_PBIT(blk) \
+    __atomic_fetch_and(&(blk)->size_status, ~(size_t) 2, __ATOMIC_RELAXED)
+
+/*
+ * Free blocks are also threaded onto an explicit, doubly linked free list.
+ * The two links live in the first two words of the free block's payload,
+ * right after the header, so no space is taken from busy blocks.
+ */
+typedef struct free_links {
+    blk_hdr *next;
+    blk_hdr *prev;
+} free_links;
+
+#define LINKS(blk) ((free_links *) ((blk) + 1))
+
+/*
+ * A free block has to hold its header, the links and its footer
+ * => no block (busy or free) may be smaller than this
+ */
+#define MIN_BLK_SIZE \
+    ((2 * sizeof(blk_hdr) + sizeof(free_links) + ALIGN - 1) / ALIGN * ALIGN)
+
+/*
+ * Segregated fit: free blocks are bucketed by power-of-two size class,
+ * class i holding the blocks whose size is in [2^i, 2^(i+1)).
+ * Bit i of class_map is set iff free_lists[i] is non-empty, which lets
+ * Alloc_Mem find the next populated class without touching empty lists.
+ */
+#define NUM_CLASSES 64
+
+static blk_hdr *free_lists[NUM_CLASSES];
+static unsigned long long class_map = 0;
+
+/*
+ * Placement policy, see Tune_Mem
+ * The policy picks a block within the free list of a size class. Under
+ * first and next fit the lists are kept in address order, so the first
+ * block that fits is the lowest one; the other policies push freed blocks
+ * on the front. For next fit each class has a roving pointer to where its
+ * next search starts, which moves on when the block it points to leaves
+ * the list.
+ */
+static int policy = MEM_FIT_BEST;
+static int good_fit_k = 4;
+static blk_hdr *rover[NUM_CLASSES];
+
+/*
+ * Free blocks of tree_class and above are not kept on class lists but in
+ * a red-black tree ordered by size and then address. Its nodes live in
+ * the payload of the free blocks, like the list links, so best fit for a
+ * large request is an O(log n) search. Only best and good fit use the
+ * tree, first and next fit keep every class on a list.
+ */
+typedef struct tree_node {
+    struct tree_node *left;
+    struct tree_node *right;
+    struct tree_node *parent;
+    int red;
+} tree_node;
+
+#define NODE(blk) ((tree_node *) ((blk) + 1))
+#define NODE_BLK(node) ((blk_hdr *) (node) - 1)
+#define NODE_SIZE(node) BLK_SIZE(NODE_BLK(node))
+
+static tree_node *tree_root = NULL;
+static int tree_class = 10;  // Blocks of 1 KiB and up
+
+// Payload bytes a free block may have written, whether list or tree
+#define FREE_WORDS \
+    (sizeof(tree_node) > sizeof(free_links) ? sizeof(tree_node) \
+                                            : sizeof(free_links))
+
+/*
+ * The heap is made of arenas, each one a separate mapping laid out as
+ *     [arena][pad][blk][blk]...[blk][end_mark]
+ * Init_Mem maps the initial arena and Alloc_Mem maps a new, geometrically
+ * larger one whenever no free block fits. Each arena has its own end mark
+ * and its first block always has the p-bit set, so blocks never coalesce
+ * across arenas and the free lists can simply span all of them.
+ *
+ * An arena whose blocks have all been freed is 'idle'. Once it has stayed
+ * idle for trim_idle allocator calls it is unmapped if it is the newest
+ * arena (and not the initial one), otherwise its pages are handed back to
+ * the kernel with MADV_DONTNEED and it is 'released'.
+ */
+typedef struct arena {
+    struct arena *older;   // Arena mapped before this one
+    struct arena *newer;   // Arena mapped after this one
+    size_t map_size;       // Bytes mapped, including this header
+    size_t page_size;      // Of the mapping, 2 MiB if MAP_HUGETLB backs it
+    size_t heap_size;      // Bytes from the first block up to the end mark
+    blk_hdr *first;        // First block of the arena
+    int idle;              // Entirely free
+    int released;          // Idle and its pages have been dropped
+    unsigned long idle_since;  // heap_ticks when it became idle
+} arena;
+
+#define ARENA_HDR ((sizeof(arena) + ALIGN - 1) / ALIGN * ALIGN)
+
+static arena *newest_arena = NULL;
+static int idle_arenas = 0;     // Arenas that are idle
+static int pending_arenas = 0;  // Idle arenas trim_arenas still has to visit
+unsigned long heap_ticks = 0;  // Allocator calls, see tick
+
+/* Settings changed through Tune_Mem */
+static int grow_heap = 1;
+int trim_idle = 256;
+static int huge_pages = 0;
+static int slab_bins = 1;
+static int stats_every = 0;
+static int stats_fd = 2;
+static unsigned long next_log = 0;  // heap_ticks of the next JSON line
+
+heap_counters heap_stats;
+alloc_counts heap_counts;
+
 /* Global variable - This will always point to the first block
- * i.e. the block with the lowest address */
+ * of the initial arena */
 blk_hdr *first_blk = NULL;
 
+/*
+ * Set by Tune_Mem(MEM_CONCURRENT, 1) before Init_Mem. In concurrent mode
+ * the block heap below is only ever touched with heap_lock held, and
+ * Alloc_Mem/Free_Mem go through the per-thread caches in mem_tcache.c.
+ */
+int mem_concurrent = 0;
+pthread_mutex_t heap_lock = PTHREAD_MUTEX_INITIALIZER;
+
 /*
  * Note:
  *  The end of the available memory can be determined using end_mark
@@ -80,65 +224,722 @@ blk_hdr *first_blk = NULL;
  *
  */
 
+/*
+ * Returns the size class of a block of 'size' bytes
+ */
+static inline int size_class(size_t size) {
+    return 63 - __builtin_clzll(size);
+}
+
+/*
+ * Puts the free block 'blk' of 'size' bytes on its class list, in address
+ * order under first and next fit and on the front otherwise
+ */
+static void list_insert(blk_hdr *blk, size_t size) {
+    int cls = size_class(size);
+    blk_hdr *prev = NULL;
+    blk_hdr *next = free_lists[cls];
+    if (policy == MEM_FIT_FIRST || policy == MEM_FIT_NEXT) {
+        while (next != NULL && next < blk) {
+            prev = next;
+            next = LINKS(next)->next;
+        }
+    }
+    LINKS(blk)->prev = prev;
+    LINKS(blk)->next = next;
+    if (next != NULL)
+        LINKS(next)->prev = blk;
+    if (prev != NULL)
+        LINKS(prev)->next = blk;
+    else
+        free_lists[cls] = blk;
+    class_map |= 1ull << cls;
+}
+
+/*
+ * Unlinks the free block 'blk' of 'size' bytes from its class list
+ */
+static void list_remove(blk_hdr *blk, size_t size) {
+    int cls = size_class(size);
+    if (LINKS(blk)->prev != NULL)
+        LINKS(LINKS(blk)->prev)->next = LINKS(blk)->next;
+    else
+        free_lists[cls] = LINKS(blk)->next;
+    if (LINKS(blk)->next != NULL)
+        LINKS(LINKS(blk)->next)->prev = LINKS(blk)->prev;
+    if (free_lists[cls] == NULL)
+        class_map &= ~(1ull << cls);
+    if (rover[cls] == blk)
+        rover[cls] = LINKS(blk)->next;
+}
+
+/*
+ * Makes 'child' take the place of 'node' under node's parent
+ */
+static void tree_replace(tree_node *node, tree_node *child) {
+    if (node->parent == NULL)
+        tree_root = child;
+    else if (node == node->parent->left)
+        node->parent->left = child;
+    else
+        node->parent->right = child;
+    if (child != NULL)
+        child->parent = node->parent;
+}
+
+static void rotate_left(tree_node *node) {
+    tree_node *child = node->right;
+    node->right = child->left;
+    if (child->left != NULL)
+        child->left->parent = node;
+    tree_replace(node, child);
+    child->left = node;
+    node->parent = child;
+}
+
+static void rotate_right(tree_node *node) {
+    tree_node *child = node->left;
+    node->left = child->right;
+    if (child->right != NULL)
+        child->right->parent = node;
+    tree_replace(node, child);
+    child->right = node;
+    node->parent = child;
+}
+
+static inline int is_red(tree_node *node) {
+    return node != NULL && node->red;
+}
+
+/*
+ * Adds the free block 'blk' of 'size' bytes to the tree
+ */
+static void tree_insert(blk_hdr *blk, size_t size) {
+    tree_node *node = NODE(blk);
+    tree_node *parent = NULL;
+    tree_node **link = &tree_root;
+    while (*link != NULL) {
+        parent = *link;
+        size_t parent_size = NODE_SIZE(parent);
+        if (size < parent_size || (size == parent_size && node < parent))
+            link = &parent->left;
+        else
+            link = &parent->right;
+    }
+    node->left = NULL;
+    node->right = NULL;
+    node->parent = parent;
+    node->red = 1;
+    *link = node;
+
+    // Restore the red-black properties
+    while (is_red(node->parent)) {
+        parent = node->parent;
+        tree_node *grand = parent->parent;  // The root is black
+        tree_node *uncle = parent == grand->left ? grand->right : grand->left;
+        if (is_red(uncle)) {
+            parent->red = 0;
+            uncle->red = 0;
+            grand->red = 1;
+            node = grand;
+        } else if (parent == grand->left) {
+            if (node == parent->right) {
+                rotate_left(parent);
+                parent = node;
+            }
+            parent->red = 0;
+            grand->red = 1;
+            rotate_right(grand);
+            break;
+        } else {
+            if (node == parent->left) {
+                rotate_right(parent);
+                parent = node;
+            }
+            parent->red = 0;
+            grand->red = 1;
+            rotate_left(grand);
+            break;
+        }
+    }
+    tree_root->red = 0;
+}
+
+/*
+ * Takes the free block 'blk' out of the tree
+ */
+static void tree_remove(blk_hdr *blk) {
+    tree_node *node = NODE(blk);
+    tree_node *child;    // Takes the place of the node that is unlinked
+    tree_node *parent;   // Parent of child
+    int removed_red = node->red;
+
+    if (node->left == NULL || node->right == NULL) {
+        child = node->left != NULL ? node->left : node->right;
+        parent = node->parent;
+        tree_replace(node, child);
+    } else {
+        // Put the successor, which has no left child, in node's place
+        tree_node *next = node->right;
+        while (next->left != NULL)
+            next = next->left;
+        removed_red = next->red;
+        child = next->right;
+        if (next->parent == node) {
+            parent = next;
+        } else {
+            parent = next->parent;
+            tree_replace(next, child);
+            next->right = node->right;
+            next->right->parent = next;
+        }
+        tree_replace(node, next);
+        next->left = node->left;
+        next->left->parent = next;
+        next->red = node->red;
+    }
+    if (removed_red)
+        return;
+
+    // A black node is gone, restore the red-black properties
+    while (child != tree_root && !is_red(child)) {
+        if (child == parent->left) {
+            tree_node *sibling = parent->right;
+            if (sibling->red) {
+                sibling->red = 0;
+                parent->red = 1;
+                rotate_left(parent);
+                sibling = parent->right;
+            }
+            if (!is_red(sibling->left) && !is_red(sibling->right)) {
+                sibling->red = 1;
+                child = parent;
+                parent = child->parent;
+                continue;
+            }
+            if (!is_red(sibling->right)) {
+                sibling->left->red = 0;
+                sibling->red = 1;
+                rotate_right(sibling);
+                sibling = parent->right;
+            }
+            sibling->red = parent->red;
+            parent->red = 0;
+            sibling->right->red = 0;
+            rotate_left(parent);
+        } else {
+            tree_node *sibling = parent->left;
+            if (sibling->red) {
+                sibling->red = 0;
+                parent->red = 1;
+                rotate_right(parent);
+                sibling = parent->left;
+            }
+            if (!is_red(sibling->left) && !is_red(sibling->right)) {
+                sibling->red = 1;
+                child = parent;
+                parent = child->parent;
+                continue;
+            }
+            if (!is_red(sibling->left)) {
+                sibling->right->red = 0;
+                sibling->red = 1;
+                rotate_left(sibling);
+                sibling = parent->left;
+            }
+            sibling->red = parent->red;
+            parent->red = 0;
+            sibling->left->red = 0;
+            rotate_right(parent);
+        }
+        child = tree_root;
+    }
+    if (child != NULL)
+        child->red = 0;
+}
+
+/*
+ * Returns the smallest block in the tree that can hold 'size' bytes, the
+ * one with the lowest address if there are several, or NULL if none can
+ */
+static blk_hdr *tree_best(size_t size) {
+    tree_node *best = NULL;
+    for (tree_node *node = tree_root; node != NULL; ) {
+        heap_stats.visited++;
+        if (NODE_SIZE(node) >= size) {
+            best = node;
+            node = node->left;
+        } else {
+            node = node->right;
+        }
+    }
+    return best != NULL ? NODE_BLK(best) : NULL;
+}
+
+/*
+ * Adds the free block 'blk' of 'size' bytes to the free lists or the tree
+ * Every block that becomes free goes through here
+ */
+static void free_insert(blk_hdr *blk, size_t size) {
+    if (size_class(size) >= tree_class)
+        tree_insert(blk, size);
+    else
+        list_insert(blk, size);
+    heap_stats.free_blocks++;
+    heap_stats.free_bytes += size;
+}
+
+/*
+ * Takes the free block 'blk' of 'size' bytes off the free lists or the
+ * tree, while its header still holds 'size'
+ */
+static void free_remove(blk_hdr *blk, size_t size) {
+    if (size_class(size) >= tree_class)
+        tree_remove(blk);
+    else
+        list_remove(blk, size);
+    heap_stats.free_blocks--;
+    heap_stats.free_bytes -= size;
+}
+
+/*
+ * Returns the smallest block of class 'cls' that can hold 'size' bytes
+ * among the first 'limit' blocks that can (all of them if limit is 0),
+ * or NULL if every block of the class is too small
+ */
+static blk_hdr *best_in_class(int cls, size_t size, int limit) {
+    blk_hdr *best_fit = NULL;
+    size_t best_size = 0;
+    for (blk_hdr *blk = free_lists[cls]; blk != NULL; blk = LINKS(blk)->next) {
+        size_t blk_size = BLK_SIZE(blk);
+        heap_stats.visited++;
+        if (blk_size < size)
+            continue;
+        if (best_fit == NULL || blk_size < best_size) {
+            best_fit = blk;
+            best_size = blk_size;
+        }
+        if (blk_size == size || --limit == 0)  // Good enough
+            break;
+    }
+    return best_fit;
+}
+
+/*
+ * Returns the first block from 'blk' up to, but not including, 'end'
+ * that can hold 'size' bytes, or NULL if there is none
+ */
+static blk_hdr *first_fit(blk_hdr *blk, blk_hdr *end, size_t size) {
+    for (; blk != end; blk = LINKS(blk)->next) {
+        heap_stats.visited++;
+        if (BLK_SIZE(blk) >= size)
+            return blk;
+    }
+    return NULL;
+}
+
+/*
+ * Returns a block of class 'cls' that can hold 'size' bytes as chosen by
+ * the placement policy, or NULL if every block of the class is too small
+ */
+static blk_hdr *find_in_class(int cls, size_t size) {
+    switch (policy) {
+        case MEM_FIT_FIRST:
+            return first_fit(free_lists[cls], NULL, size);
+        case MEM_FIT_NEXT: {
+            // From the rover to the end of the list, then wrap around
+            blk_hdr *start = rover[cls];
+            if (start == NULL)
+                start = free_lists[cls];
+            blk_hdr *blk = first_fit(start, NULL, size);
+            if (blk == NULL && start != free_lists[cls])
+                blk = first_fit(free_lists[cls], start, size);
+            if (blk != NULL)
+                rover[cls] = blk;  // Moves past it when it is taken
+            return blk;
+        }
+        case MEM_FIT_GOOD:
+            return best_in_class(cls, size, good_fit_k);
+        default:
+            return best_in_class(cls, size, 0);
+    }
+}
+
+/*
+ * Maps a region of 'map_size' bytes and sets it up as an arena holding
+ * one free block, which is put on its free list
+ * Returns the new arena on success and NULL on failure
+ */
+static arena *map_arena(size_t map_size) {
+    void *space_ptr = MAP_FAILED;
+    size_t page_size = getpagesize();
+
+    if (huge_pages > 1) {
+        space_ptr = mmap(NULL, map_size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (MAP_FAILED != space_ptr)
+            page_size = 2 << 20;
+    }
+    if (MAP_FAILED == space_ptr) {
+        // Using mmap to allocate memory
+        int fd = open("/dev/zero", O_RDWR);
+        if (-1 == fd) {
+            fprintf(stderr, "Error:mem.c: Cannot open /dev/zero\n");
+            return NULL;
+        }
+        space_ptr = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                         fd, 0);
+        close(fd);
+        if (MAP_FAILED == space_ptr) {
+            fprintf(stderr, "Error:mem.c: mmap cannot allocate space\n");
+            return NULL;
+        }
+        if (huge_pages)
+            madvise(space_ptr, map_size, MADV_HUGEPAGE);
+    }
+
+    arena *a = space_ptr;
+    a->map_size = map_size;
+    a->page_size = page_size;
+    // for the arena header, alignement and end mark
+    a->heap_size = map_size - ARENA_HDR - ALIGN;
+    // initialize the arena so that its first block meets
+    // the alignement requirement
+    a->first = (blk_hdr *) ((char *) space_ptr + ARENA_HDR + ALIGN) - 1;
+    a->idle = 0;
+    a->released = 0;
+    a->idle_since = 0;
+
+    // To begin with there is only one big, fresh free block
+    // whose previous block is marked as busy
+    blk_hdr *end_mark = (blk_hdr *) ((char *) a->first + a->heap_size);
+    a->first->size_status = a->heap_size + FRESH + 2;
+    (end_mark - 1)->size_status = a->heap_size;  // Footer
+    // Setting up the end mark and marking it as busy
+    end_mark->size_status = 1;
+    free_insert(a->first, a->heap_size);
+
+    heap_stats.heap_size += a->heap_size;
+    a->older = newest_arena;
+    a->newer = NULL;
+    if (newest_arena != NULL)
+        newest_arena->newer = a;
+    newest_arena = a;
+    return a;
+}
+
+/*
+ * Maps an arena with room for a block of 'size' bytes
+ * Arenas grow geometrically: each is at least twice the newest one
+ * Returns 0 on success and -1 on failure
+ */
+static int grow(size_t size) {
+    if (newest_arena == NULL)  // Init_Mem has not been called
+        return -1;
+    size_t align = huge_pages ? 2 << 20 : getpagesize();
+    if (size > SIZE_MAX / 2 - ARENA_HDR - ALIGN - align)
+        return -1;
+    size_t need = size + ARENA_HDR + ALIGN;
+    size_t map_size = newest_arena->map_size * 2;
+    if (map_size < need || map_size < newest_arena->map_size)
+        map_size = need;
+    map_size = (map_size + align - 1) / align * align;
+    return map_arena(map_size) == NULL ? -1 : 0;
+}
+
+/*
+ * Returns the arena whose first block is 'blk', or NULL if there is none
+ */
+static arena *arena_of_first(blk_hdr *blk) {
+    // Arenas are page aligned, so their first blocks share a page offset
+    if (((uintptr_t) blk - ARENA_HDR - ALIGN + sizeof(blk_hdr))
+        % getpagesize() != 0)
+        return NULL;
+    for (arena *a = newest_arena; a != NULL; a = a->older)
+        if (a->first == blk)
+            return a;
+    return NULL;
+}
+
+/*
+ * Releases the memory of arenas that have been idle for at least
+ * trim_idle allocator calls
+ * - The newest arena is unmapped (repeatedly, but never the initial one)
+ * - Any other arena keeps its mapping but drops its pages. The few bytes
+ *   around the links and footer that stay mapped are cleared, so the
+ *   block is fresh again.
+ * Also recounts the idle arenas that will need another visit later
+ */
+static void trim_arenas(void) {
+    arena *older;
+    pending_arenas = 0;
+    for (arena *a = newest_arena; a != NULL; a = older) {
+        older = a->older;
+        if (!a->idle)
+            continue;
+        int expired = trim_idle >= 0
+                      && heap_ticks - a->idle_since >= (unsigned) trim_idle;
+        if (a == newest_arena && older != NULL) {
+            if (expired) {
+                free_remove(a->first, a->heap_size);
+                newest_arena = older;
+                older->newer = NULL;
+                idle_arenas--;
+                heap_stats.heap_size -= a->heap_size;
+                munmap(a, a->map_size);
+                continue;
+            }
+        } else if (a->released) {
+            continue;  // Nothing left to do unless it becomes the newest
+        } else if (expired) {
+            // Keep the header, links and footer of the free block. Should
+            // the pages fail to drop, try again after another trim_idle.
+            uintptr_t pagesize = a->page_size;
+            char *links_end = (char *) LINKS(a->first) + FREE_WORDS;
+            char *footer = (char *) a->first + a->heap_size - sizeof(blk_hdr);
+            char *begin = (char *) (((uintptr_t) links_end + pagesize - 1)
+                                    / pagesize * pagesize);
+            char *end = (char *) ((uintptr_t) footer / pagesize * pagesize);
+            if (end > begin) {
+                if (madvise(begin, end - begin, MADV_DONTNEED) != 0) {
+                    a->idle_since = heap_ticks;
+                    pending_arenas++;
+                    continue;
+                }
+                memset(links_end, 0, begin - links_end);
+                memset(end, 0, footer - end);
+                a->first->size_status |= FRESH;
+            }
+            a->released = 1;
+            continue;
+        }
+        pending_arenas++;
+    }
+}
+
+/*
+ * Fills in 'stats' from the counters, see Stats_Mem
+ * The caller must hold heap_lock in concurrent mode
+ */
+static void collect_stats(Mem_Stats *stats) {
+    alloc_counts counts = heap_counts;
+    if (mem_concurrent)
+        tcache_counts(&counts);
+    memset(stats, 0, sizeof(Mem_Stats));
+    memcpy(stats->allocs, counts.allocs, sizeof(stats->allocs));
+    memcpy(stats->frees, counts.frees, sizeof(stats->frees));
+    stats->heap_size = heap_stats.heap_size;
+    stats->slab_released = heap_stats.slab_released;
+    stats->in_use = heap_stats.in_use;
+    stats->peak_in_use = heap_stats.peak_in_use;
+    stats->free_blocks = heap_stats.free_blocks;
+    stats->free_bytes = heap_stats.free_bytes;
+    if (tree_root != NULL) {
+        // The largest free block is the rightmost node of the tree
+        tree_node *node = tree_root;
+        while (node->right != NULL)
+            node = node->right;
+        stats->largest_free = NODE_SIZE(node);
+    } else if (class_map != 0) {
+        // The largest free block is in the highest non-empty class
+        int cls = 63 - __builtin_clzll(class_map);
+        for (blk_hdr *blk = free_lists[cls]; blk != NULL;
+             blk = LINKS(blk)->next)
+            if (BLK_SIZE(blk) > stats->largest_free)
+                stats->largest_free = BLK_SIZE(blk);
+    }
+    if (stats->free_bytes != 0) {
+        stats->fragmentation = 1 - (double) stats->largest_free
+                                   / stats->free_bytes;
+    }
+    stats->searches = heap_stats.searches;
+    if (heap_stats.searches != 0)
+        stats->avg_visited = (double) heap_stats.visited
+                             / heap_stats.searches;
+}
+
+/*
+ * Writes the non-zero counts of 'counts' to 'buf' as a JSON object keyed
+ * by the smallest size of each class
+ * Returns the number of characters written
+ */
+static int json_counts(char *buf, const unsigned long *counts) {
+    const char *sep = "";
+    int len = sprintf(buf, "{");
+    for (int cls = 0; cls < MEM_STAT_CLASSES; cls++) {
+        if (counts[cls] == 0)
+            continue;
+        len += sprintf(buf + len, "%s\"%llu\":%lu", sep, 1ull << cls,
+                       counts[cls]);
+        sep = ",";
+    }
+    return len + sprintf(buf + len, "}");
+}
+
+/*
+ * Writes the statistics to stats_fd as one line of JSON
+ * Does not allocate, so it can run in the middle of an allocator call
+ */
+static void log_stats(void) {
+    Mem_Stats stats;
+    char buf[8192];  // Enough for every class with 20 digit counts
+    collect_stats(&stats);
+    int len = sprintf(buf,
+                      "{\"ticks\":%lu,\"heap_size\":%zu,"
+                      "\"slab_released\":%zu,\"in_use\":%zu,"
+                      "\"peak_in_use\":%zu,\"free_blocks\":%zu,"
+                      "\"free_bytes\":%zu,\"largest_free\":%zu,"
+                      "\"fragmentation\":%.4f,\"searches\":%lu,"
+                      "\"avg_visited\":%.2f,\"allocs\":",
+                      heap_ticks, stats.heap_size, stats.slab_released,
+                      stats.in_use,
+                      stats.peak_in_use, stats.free_blocks,
+                      stats.free_bytes, stats.largest_free,
+                      stats.fragmentation, stats.searches,
+                      stats.avg_visited);
+    len += json_counts(buf + len, stats.allocs);
+    len += sprintf(buf + len, ",\"frees\":");
+    len += json_counts(buf + len, stats.frees);
+    len += sprintf(buf + len, "}\n");
+    ssize_t ret = write(stats_fd, buf, len);
+    (void) ret;
+}
+
+/*
+ * Counts an allocator call, trims the slab and writes the statistics
+ * when it is time to
+ * Outside concurrent mode every call counts, in concurrent mode only the
+ * calls that reach the shared heap do
+ */
+static inline void tick(void) {
+    heap_ticks++;
+    if (heap_ticks >= slab_next_trim)
+        slab_trim();
+    if (stats_every > 0 && heap_ticks >= next_log) {
+        next_log = heap_ticks + stats_every;
+        log_stats();
+    }
+}
+
+/*
+ * Allocates a block for 'size' bytes, see heap_alloc
+ * Sets *fresh if the payload is all zeros except for the words the block
+ * used as a free block (its links and, if it was not split, its footer)
+ */
+static void *alloc_block(size_t size, int *fresh) {
+    if (size == 0) return NULL;
+    if (size > SIZE_MAX / 2) return NULL;
+    size += sizeof(blk_hdr);
+    if (size % ALIGN) size = (size / ALIGN + 1) * ALIGN;
+    if (size < MIN_BLK_SIZE) size = MIN_BLK_SIZE;
+
+    tick();
+    if (pending_arenas)
+        trim_arenas();
+
+    heap_stats.searches++;
+    int cls = size_class(size);
+    blk_hdr *best_fit = NULL;
+    if (cls < tree_class) {
+        if (class_map & (1ull << cls))
+            best_fit = find_in_class(cls, size);
+        if (best_fit == NULL) {
+            // Every class above 'cls' only holds blocks that are big enough
+            unsigned long long larger = class_map & ~((2ull << cls) - 1);
+            if (larger != 0)
+                best_fit = find_in_class(__builtin_ctzll(larger), size);
+        }
+    }
+    if (best_fit == NULL) {
+        if (tree_root != NULL)
+            best_fit = tree_best(size);
+        if (best_fit == NULL) {
+            // Nothing fits, add an arena with room for the request
+            if (!grow_heap || grow(size) != 0)
+                return NULL;
+            best_fit = newest_arena->first;
+        }
+    }
+
+    if (idle_arenas && (best_fit->size_status & 2)) {
+        // Using the first block of an idle arena puts it back to use
+        arena *a = arena_of_first(best_fit);
+        if (a != NULL && a->idle) {
+            a->idle = 0;
+            a->released = 0;
+            idle_arenas--;
+        }
+    }
+
+    // The size of the free blk we found
+    size_t big_blk_size = BLK_SIZE(best_fit);
+    *fresh = (best_fit->size_status & FRESH) != 0;
+    free_remove(best_fit, big_blk_size);
+    if (big_blk_size - size >= MIN_BLK_SIZE) {
+        best_fit->size_status = size + 3;
+        blk_hdr *new_header = (blk_hdr *) ((char *) best_fit + size);
+        // Split the blk, add new hdr, the rest stays as fresh as it was
+        new_header->size_status = big_blk_size - size + 2
+                                  + (*fresh ? FRESH : 0);
+
+        blk_hdr new_footer;                // Split the blk, update new ftr
+        new_footer.size_status = big_blk_size - size;
+        *((blk_hdr *) ((char *) best_fit + big_blk_size) - 1) = new_footer;
+        free_insert(new_header, big_blk_size - size);
+        // No need to change the following blk's header
+    } else {  // The remainder is too small to be a blk, hand out all of it
+        best_fit->size_status = big_blk_size + 3;
+        blk_hdr *next_blk = (blk_hdr *) ((char *) best_fit + big_blk_size);
+        if (next_blk->size_status != 1)
+            SET_PBIT(next_blk);    // Update the next blk's header
+    }
+    count_busy(BLK_SIZE(best_fit));
+    return best_fit + 1;  // Payload pointer
+}
+
 /*
  * Function for allocating 'size' bytes
  * Returns address of allocated block on success
  * Returns NULL on failure
  * Here is what this function should accomplish
  * - Check for sanity of size - Return NULL when appropriate
- * - Round up size to a multiple of 8
- * - Traverse the list of blocks and allocate the best free block which can
- * - accommodate the requested size
+ * - Round up size to a multiple of 16
+ * - Find a free block which can accommodate the requested size, as chosen
+ *   by the placement policy (best fit by default). Only the free list of
+ *   the request's size class and, if none of those blocks fits, the first
+ *   non-empty larger class are searched. Every block of a larger class
+ *   fits, so best fit is still an exact best fit. Large blocks are kept
+ *   in a tree by size instead, which finds the best fit among them in
+ *   O(log n) steps.
+ * - If nothing fits, map a new arena for the request (see grow)
  * - Also, when allocating a block - split it into two blocks
  * Tips: Be careful with pointer arithmetic
  */
-void *Alloc_Mem(int size) {
-    if (size <= 0) return NULL;
-    size += 4;
-    if (size % 8) size = (size / 8 + 1) * 8;
-    blk_hdr *best_fit = first_blk;
-    blk_hdr *current_blk = first_blk;
-    int blk_size = 0;
-    while (current_blk->size_status != 1) {
-        if ((current_blk->size_status & 1) == 0) {  // Current block free
-            blk_size = current_blk->size_status;
-            if (blk_size >= size) {
-                // If the best_fit is not empty or its size is smaller than
-                // the desired size or the current_blk is a better fit.
-                // Since I initialized the best_blk as the first_blk, so
-                // all of them could occur
-                if (best_fit->size_status & 1
-                    || blk_size < best_fit->size_status
-                    || best_fit->size_status < size) {
-                    best_fit = current_blk;
-                }
-            }
-        }
-        // Move cur_blk to next blk
-        current_blk += current_blk->size_status / 4;
-    }
+void *heap_alloc(size_t size) {
+    int fresh;
+    return alloc_block(size, &fresh);
+}
 
-    if (best_fit->size_status >= size && ((best_fit->size_status & 1) == 0)) {
-        // The size of the free blk we found
-        int big_blk_size = best_fit->size_status / 8 * 8;
-        best_fit->size_status = size + 3;
-        if (big_blk_size > size) {
-            blk_hdr new_header;                // Split the blk, add new hdr
-            new_header.size_status = big_blk_size - size + 2;
-            *(best_fit + (size / 4)) = new_header;
-
-            blk_hdr new_footer;                // Split the blk, update new ftr
-            new_footer.size_status = new_header.size_status - 2;
-            *(best_fit + (big_blk_size / 4) - 1) = new_footer;
-            // No need to change the following blk's header
-        } else if (big_blk_size == size) {     // The free blk fits the new blk
-            blk_hdr *next_blk = best_fit + best_fit->size_status / 4;
-            if (next_blk->size_status != 1)
-                next_blk->size_status += 2;    // Update the next blk's header
-        }
-        return best_fit + 1;  // Payload pointer
+/*
+ * Allocates 'size' zeroed bytes, see heap_alloc
+ * A block carved from memory that is still fresh from the mapping only
+ * needs its old free list links or tree node and its footer cleared
+ */
+void *heap_calloc(size_t size) {
+    int fresh;
+    void *ptr = alloc_block(size, &fresh);
+    if (ptr == NULL)
+        return NULL;
+    if (!fresh) {
+        memset(ptr, 0, size);
+    } else {
+        blk_hdr *hdr = (blk_hdr *) ptr - 1;
+        size_t usable = BLK_SIZE(hdr) - sizeof(blk_hdr);
+        memset(LINKS(hdr), 0, usable < FREE_WORDS ? usable : FREE_WORDS);
+        memset((char *) hdr + BLK_SIZE(hdr) - sizeof(blk_hdr), 0,
+               sizeof(blk_hdr));
     }
-    return NULL;
+    return ptr;
 }
 
 /*
@@ -148,81 +949,477 @@ void *Alloc_Mem(int size) {
  * Returns -1 on failure
  * Here is what this function should accomplish
  * - Return -1 if ptr is NULL
- * - Return -1 if ptr is not 8 byte aligned or if the block is already freed
+ * - Return -1 if ptr is not 16 byte aligned or if the block is already freed
  * - Mark the block as free
- * - Coalesce if one or both of the immediate neighbours are free
+ * - Coalesce if one or both of the immediate neighbours are free, taking
+ *   the absorbed neighbours off their free lists
+ * - Put the resulting block on the free list of its size class, or in
+ *   the tree if it is large
+ * - Start the idle clock of the arena if it is now entirely free
  */
-int Free_Mem(void *ptr) {
+int heap_free(void *ptr) {
     int prev_free = 0;   // Indicate whether the previous blk is free
     int next_free = 0;   // Indicate whether the next blk is free
     if (ptr == NULL) {
         return -1;
     }
-    blk_hdr *cur_header = ptr - 4;  // Header of the current blk
+    blk_hdr *cur_header = (blk_hdr *) ptr - 1;  // Header of the current blk
     // Check if the blk is invalid or free
-    if ((int) ptr % 8 != 0 || (cur_header->size_status & 1) != 1) {
+    if ((uintptr_t) ptr % ALIGN != 0 || (cur_header->size_status & 1) != 1) {
         return -1;
     }
 
+    size_t size = BLK_SIZE(cur_header);  // The size of the cur block
+    heap_stats.in_use -= size;
     // Hdr of next blk
-    blk_hdr *next_header = cur_header + cur_header->size_status / 4;
+    blk_hdr *next_header = (blk_hdr *) ((char *) cur_header + size);
 
     if ((cur_header->size_status & 2) == 0)
         prev_free = 1;           // Indicate if previous blk is free
     if ((next_header->size_status & 1) == 0)
         next_free = 1;          // Indicate if the next blk is free
     blk_hdr cur_footer;         // Footer of current block
-    int size = cur_header->size_status / 8 * 8;  // The size of the cur block
 
     // Coalesce block and update each blks' hdr
+    // A coalesced block is never fresh, the freed block was in use
     if (!next_free && !prev_free) {     // No need to coalesce
         cur_header->size_status = size + 2;
-        next_header->size_status -= 2;  // Change the p-bit of the next blk
+        if (next_header->size_status != 1)
+            CLEAR_PBIT(next_header);  // Change the p-bit of the next blk
     }
 
     if (next_free && !prev_free) {      // Coalesce the next block
-        cur_header->size_status = size + next_header->size_status;
+        free_remove(next_header, BLK_SIZE(next_header));
+        cur_header->size_status = size + BLK_SIZE(next_header) + 2;
     }
 
     if (!next_free && prev_free) {     // Coalesce the prev blk
         blk_hdr *prev_footer = cur_header - 1;  // Footer of the prev blk
         // Prev hdr: p=1, a=0
-        blk_hdr *prev_header = cur_header - prev_footer->size_status / 4;
+        blk_hdr *prev_header = (blk_hdr *) ((char *) cur_header
+                                            - prev_footer->size_status);
 
-        prev_header->size_status += size;
+        free_remove(prev_header, prev_footer->size_status);
+        prev_header->size_status = prev_footer->size_status + size + 2;
         cur_header = prev_header;
-        next_header->size_status -= 2;  // Update the next header's p bit
+        if (next_header->size_status != 1)
+            CLEAR_PBIT(next_header);  // Update the next header's p bit
     }
 
     if (next_free && prev_free) {  // Coalesce the prev and next blks
         blk_hdr *prev_footer = cur_header - 1;  // Footer of the prev blk
-        blk_hdr *prev_header = cur_header - prev_footer->size_status / 4;
+        blk_hdr *prev_header = (blk_hdr *) ((char *) cur_header
+                                            - prev_footer->size_status);
 
-        // Next hdr: p=1, a=0
-        prev_header->size_status += (size + next_header->size_status - 2);
+        free_remove(prev_header, prev_footer->size_status);
+        free_remove(next_header, BLK_SIZE(next_header));
+        // Prev hdr: p=1, a=0
+        prev_header->size_status = prev_footer->size_status + size
+                                   + BLK_SIZE(next_header) + 2;
         cur_header = prev_header;
     }
 
-    size = cur_header->size_status / 8 * 8;
+    size = BLK_SIZE(cur_header);
     cur_footer.size_status = size;  // Create footer and put in right place
-    *(cur_header + size / 4 - 1) = cur_footer;
+    *((blk_hdr *) ((char *) cur_header + size) - 1) = cur_footer;
+    free_insert(cur_header, size);
+
+    tick();
+    if ((cur_header->size_status & 2)
+        && ((blk_hdr *) ((char *) cur_header + size))->size_status == 1) {
+        // Only the arena header precedes the block, only the end mark follows
+        arena *a = arena_of_first(cur_header);
+        if (a != NULL && !a->idle) {
+            a->idle = 1;
+            a->idle_since = heap_ticks;
+            idle_arenas++;
+            pending_arenas++;
+        }
+    }
+    if (pending_arenas)
+        trim_arenas();
     return 0;
 }
 
+/*
+ * Resizes the busy block at 'ptr' to hold 'size' bytes
+ * Returns the (possibly moved) payload pointer on success
+ * Returns NULL on failure, leaving the block untouched
+ * - NULL ptr allocates, zero size frees
+ * - Shrinking splits off the tail as a free block if it is big enough
+ * - Growing first tries to absorb the next block if it is free, and only
+ *   moves the data to a new block if that is not enough
+ */
+void *heap_realloc(void *ptr, size_t size) {
+    if (ptr == NULL)
+        return heap_alloc(size);
+    if (size == 0) {
+        heap_free(ptr);
+        return NULL;
+    }
+    size_t usable = heap_usable(ptr);
+    if (usable == 0 || size > SIZE_MAX / 2)
+        return NULL;
+
+    size_t need = size + sizeof(blk_hdr);
+    if (need % ALIGN) need = (need / ALIGN + 1) * ALIGN;
+    if (need < MIN_BLK_SIZE) need = MIN_BLK_SIZE;
+
+    blk_hdr *cur_header = (blk_hdr *) ptr - 1;
+    size_t cur_size = BLK_SIZE(cur_header);
+    blk_hdr *next_header = (blk_hdr *) ((char *) cur_header + cur_size);
+
+    if (need > cur_size && (next_header->size_status & 1) == 0
+        && cur_size + BLK_SIZE(next_header) >= need) {
+        // Grow in place over the free next block
+        size_t next_size = BLK_SIZE(next_header);
+        free_remove(next_header, next_size);
+        cur_header->size_status += next_size;
+        cur_size += next_size;
+        count_busy(next_size);
+        next_header = (blk_hdr *) ((char *) cur_header + cur_size);
+        if (next_header->size_status != 1)
+            SET_PBIT(next_header);  // Its previous blk is busy now
+    }
+
+    if (need <= cur_size) {
+        if (cur_size - need >= MIN_BLK_SIZE) {
+            // Turn the tail into a busy blk of its own and free it
+            blk_hdr *tail = (blk_hdr *) ((char *) cur_header + need);
+            cur_header->size_status -= cur_size - need;
+            tail->size_status = cur_size - need + 3;
+            heap_free(tail + 1);
+        }
+        return ptr;
+    }
+
+    void *new_ptr = heap_alloc(size);
+    if (new_ptr == NULL)
+        return NULL;
+    memcpy(new_ptr, ptr, usable);
+    heap_free(ptr);
+    return new_ptr;
+}
+
+/*
+ * Allocates 'size' bytes whose address is a multiple of 'alignment',
+ * a power of two
+ * Returns the payload pointer on success and NULL on failure
+ * Takes a block with room to spare and splits off the blocks before and
+ * after the aligned payload, which are then freed
+ */
+void *heap_memalign(size_t alignment, size_t size) {
+    if (alignment <= ALIGN)
+        return heap_alloc(size);
+    if (size == 0 || size > SIZE_MAX / 4 || alignment > SIZE_MAX / 4)
+        return NULL;
+    char *ptr = heap_alloc(size + alignment + MIN_BLK_SIZE);
+    if (ptr == NULL || (uintptr_t) ptr % alignment == 0)
+        return ptr == NULL ? NULL : heap_realloc(ptr, size);
+
+    // Leave room for a block in front of the aligned payload
+    char *aligned = (char *) (((uintptr_t) ptr + MIN_BLK_SIZE + alignment - 1)
+                              & ~(uintptr_t) (alignment - 1));
+    blk_hdr *lead = (blk_hdr *) ptr - 1;
+    blk_hdr *cur_header = (blk_hdr *) aligned - 1;
+    size_t total = BLK_SIZE(lead);
+    size_t gap = aligned - ptr;
+    cur_header->size_status = total - gap + 3;
+    lead->size_status -= total - gap;
+    heap_free(ptr);  // Also clears the p-bit of cur_header if need be
+    return heap_realloc(aligned, size);  // Gives back the tail
+}
+
+/*
+ * Returns the number of payload bytes of the busy block at 'ptr'
+ * Returns 0 if ptr is NULL, not 16 byte aligned or the block is not busy
+ * Safe to call without heap_lock on a block the caller owns: only the
+ * p-bit of its header can change under our feet.
+ */
+size_t heap_usable(void *ptr) {
+    blk_hdr *hdr = (blk_hdr *) ptr - 1;
+    if (ptr == NULL || (uintptr_t) ptr % ALIGN != 0)
+        return 0;
+    size_t size_status = __atomic_load_n(&hdr->size_status, __ATOMIC_RELAXED);
+    if ((size_status & 1) != 1)
+        return 0;
+    return (size_status & ~(size_t) (ALIGN - 1)) - sizeof(blk_hdr);
+}
+
+/*
+ * Counts a block of the block heap handed out outside concurrent mode
+ * Returns ptr
+ */
+static inline void *count_alloc(void *ptr) {
+    if (ptr != NULL)
+        heap_counts.allocs[stat_class(heap_usable(ptr))]++;
+    return ptr;
+}
+
+/*
+ * Public allocation entry point, see heap_alloc
+ * In concurrent mode the request is served by the calling thread's cache
+ * Otherwise requests of up to SLAB_MAX bytes get a slot of a slab bin
+ * (see mem_slab.c) while there is room for one
+ */
+void *Alloc_Mem(size_t size) {
+    if (mem_concurrent)
+        return tcache_alloc(size);
+    if (slab_bins && size - 1 < SLAB_MAX && first_blk != NULL) {
+        void *ptr = slab_alloc(size);
+        if (ptr != NULL) {
+            tick();
+            return ptr;
+        }
+    }
+    return count_alloc(heap_alloc(size));
+}
+
+/*
+ * Public free entry point, see heap_free
+ * In concurrent mode the block goes back to the cache of the thread
+ * that allocated it
+ */
+int Free_Mem(void *ptr) {
+    if (mem_concurrent)
+        return tcache_free(ptr);
+    if (slab_owns(ptr)) {
+        tick();
+        return slab_free(ptr);
+    }
+    size_t usable = heap_usable(ptr);
+    if (heap_free(ptr) != 0)
+        return -1;
+    heap_counts.frees[stat_class(usable)]++;
+    return 0;
+}
+
+/*
+ * Public resize entry point, see heap_realloc
+ * A slab slot is kept if it is big enough and moved otherwise
+ */
+void *Realloc_Mem(void *ptr, size_t size) {
+    if (mem_concurrent)
+        return tcache_realloc(ptr, size);
+    if (!slab_owns(ptr)) {
+        // Counted as a free of the old block and an alloc of the new one
+        size_t usable = ptr != NULL ? heap_usable(ptr) : 0;
+        void *new_ptr = heap_realloc(ptr, size);
+        if (usable != 0 && (new_ptr != NULL || size == 0))
+            heap_counts.frees[stat_class(usable)]++;
+        return count_alloc(new_ptr);
+    }
+
+    size_t usable = slab_usable(ptr);
+    if (usable == 0)
+        return NULL;
+    if (size == 0) {
+        slab_free(ptr);
+        return NULL;
+    }
+    if (size <= usable)
+        return ptr;
+    void *new_ptr = Alloc_Mem(size);
+    if (new_ptr == NULL)
+        return NULL;
+    memcpy(new_ptr, ptr, usable);
+    slab_free(ptr);
+    return new_ptr;
+}
+
+/*
+ * Function for allocating an array of 'nmemb' elements of 'size' bytes
+ * with all bytes set to zero
+ * Returns address of allocated block on success
+ * Returns NULL on failure or if the total size overflows
+ */
+void *Calloc_Mem(size_t nmemb, size_t size) {
+    if (size != 0 && nmemb > SIZE_MAX / size)
+        return NULL;
+    size *= nmemb;
+    if (mem_concurrent)
+        return tcache_calloc(size);
+    if (slab_bins && size - 1 < SLAB_MAX && first_blk != NULL) {
+        void *ptr = slab_alloc(size);
+        if (ptr != NULL) {
+            tick();
+            return memset(ptr, 0, size);
+        }
+    }
+    return count_alloc(heap_calloc(size));
+}
+
+/*
+ * Function for allocating 'size' bytes at an address that is a multiple
+ * of 'alignment'
+ * Returns address of allocated block on success
+ * Returns NULL on failure or if alignment is not a power of two
+ */
+void *Memalign_Mem(size_t alignment, size_t size) {
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+        return NULL;
+    if (mem_concurrent)
+        return tcache_memalign(alignment, size);
+    if (alignment <= ALIGN)
+        return Alloc_Mem(size);
+    return count_alloc(heap_memalign(alignment, size));
+}
+
+/*
+ * Fills in 'stats' with the allocator's statistics, see Mem_Stats in mem.h
+ * The counters are kept up to date on every call, so this is cheap, but
+ * it takes heap_lock in concurrent mode
+ * Returns 0 on success and -1 if stats is NULL
+ */
+int Stats_Mem(Mem_Stats *stats) {
+    if (stats == NULL)
+        return -1;
+    if (mem_concurrent)
+        pthread_mutex_lock(&heap_lock);
+    collect_stats(stats);
+    if (mem_concurrent)
+        pthread_mutex_unlock(&heap_lock);
+    return 0;
+}
+
+/*
+ * Returns the number of bytes that can be used at 'ptr', a block returned
+ * by one of the allocation functions, which is at least the requested size
+ * Returns 0 if ptr is NULL or not a busy block
+ */
+size_t Usable_Mem(void *ptr) {
+    if (ptr == NULL)
+        return 0;
+    if (mem_concurrent)
+        return tcache_usable(ptr);
+    if (slab_owns(ptr))
+        return slab_usable(ptr);
+    return heap_usable(ptr);
+}
+
+/*
+ * Function for adjusting the allocator's behaviour
+ * Arguments - param: one of the MEM_* parameters in mem.h
+ *             value: the new setting
+ * Returns 0 on success and -1 on failure
+ * - MEM_CONCURRENT: nonzero turns on the thread-safe mode with per-thread
+ *   caches. It changes the layout of every block, so it can only be set
+ *   before Init_Mem.
+ * - MEM_GROW: nonzero (the default) maps more arenas when the heap is full,
+ *   zero makes Alloc_Mem fail instead
+ * - MEM_TRIM_IDLE: number of allocator calls an entirely free arena is kept
+ *   before its memory is released (default 256), negative never releases
+ * - MEM_HUGEPAGES: 0 uses normal pages, 1 asks for transparent huge pages,
+ *   2 maps arenas with MAP_HUGETLB, falling back to 1 if that fails.
+ *   Arenas are then sized in multiples of 2 MiB.
+ * - MEM_SLAB: nonzero (the default) serves requests of up to SLAB_MAX
+ *   bytes from slab bins outside concurrent mode, zero sends them to the
+ *   block heap. Slots already handed out can still be freed either way.
+ * - MEM_STATS_LOG: every this many allocator calls the statistics are
+ *   written to the MEM_STATS_FD descriptor as a line of JSON, 0 (the
+ *   default) turns this off. In concurrent mode only the calls that reach
+ *   the shared heap count.
+ * - MEM_STATS_FD: descriptor for the JSON lines (default 2, stderr)
+ * - MEM_POLICY: how a free block is picked among those that fit, can only
+ *   be set before Init_Mem
+ *   MEM_FIT_BEST (default): the smallest one
+ *   MEM_FIT_FIRST: the lowest addressed one
+ *   MEM_FIT_NEXT: the next one in address order from where the last
+ *   search stopped
+ *   MEM_FIT_GOOD: the smallest of the first MEM_GOOD_FIT_K ones
+ * - MEM_GOOD_FIT_K: candidates good fit looks at, at least 1 (default 4)
+ * - MEM_TREE_MIN: free blocks of at least this many bytes, rounded up to
+ *   a power of two, are indexed by a tree instead of the size class lists
+ *   (default 1024), 0 keeps them all on lists. Can only be set before
+ *   Init_Mem, and first and next fit always use the lists.
+ * The settings other than MEM_CONCURRENT are not synchronized; change them
+ * before other threads start using the allocator.
+ */
+int Tune_Mem(int param, int value) {
+    switch (param) {
+        case MEM_CONCURRENT:
+            if (first_blk != NULL) {
+                fprintf(stderr, "Error:mem.c: MEM_CONCURRENT must be set "
+                        "before Init_Mem\n");
+                return -1;
+            }
+            mem_concurrent = value != 0;
+            return 0;
+        case MEM_GROW:
+            grow_heap = value != 0;
+            return 0;
+        case MEM_TRIM_IDLE:
+            trim_idle = value;
+            slab_next_trim = 0;  // Recomputed by the next slab_trim
+            return 0;
+        case MEM_HUGEPAGES:
+            if (value < 0 || value > 2)
+                return -1;
+            huge_pages = value;
+            return 0;
+        case MEM_SLAB:
+            slab_bins = value != 0;
+            return 0;
+        case MEM_STATS_LOG:
+            if (value < 0)
+                return -1;
+            stats_every = value;
+            next_log = heap_ticks + value;
+            return 0;
+        case MEM_STATS_FD:
+            if (value < 0)
+                return -1;
+            stats_fd = value;
+            return 0;
+        case MEM_POLICY:
+            if (first_blk != NULL) {
+                fprintf(stderr, "Error:mem.c: MEM_POLICY must be set "
+                        "before Init_Mem\n");
+                return -1;
+            }
+            if (value < MEM_FIT_BEST || value > MEM_FIT_GOOD)
+                return -1;
+            policy = value;
+            return 0;
+        case MEM_GOOD_FIT_K:
+            if (value < 1)
+                return -1;
+            good_fit_k = value;
+            return 0;
+        case MEM_TREE_MIN:
+            if (first_blk != NULL) {
+                fprintf(stderr, "Error:mem.c: MEM_TREE_MIN must be set "
+                        "before Init_Mem\n");
+                return -1;
+            }
+            if (value < 0)
+                return -1;
+            if (value == 0) {
+                tree_class = NUM_CLASSES;
+                return 0;
+            }
+            // Every block of the tree must have room for its node
+            if ((size_t) value < sizeof(tree_node) + 2 * sizeof(blk_hdr))
+                value = sizeof(tree_node) + 2 * sizeof(blk_hdr);
+            tree_class = size_class(value - 1) + 1;
+            return 0;
+        default:
+            return -1;
+    }
+}
+
 /*
  * Function used to initialize the memory allocator
  * Not intended to be called more than once by a program
  * Argument - sizeOfRegion:
- *      Specifies the size of the chunk which needs to be allocated
+ *      Specifies the size of the initial arena, the heap grows past it
+ *      on demand unless MEM_GROW is turned off
  * Returns 0 on success and -1 on failure
  */
-int Init_Mem(int sizeOfRegion) {
-    int pagesize;
-    int padsize;
-    int fd;
-    int alloc_size;
-    void *space_ptr;
-    blk_hdr *end_mark;
+int Init_Mem(size_t sizeOfRegion) {
+    size_t pagesize;
+    size_t padsize;
+    size_t alloc_size;
     static int allocated_once = 0;
 
     if (0 != allocated_once) {
@@ -231,58 +1428,35 @@ int Init_Mem(int sizeOfRegion) {
                 "during a previous call\n");
         return -1;
     }
-    if (sizeOfRegion <= 0) {
+    if (sizeOfRegion == 0) {
         fprintf(stderr, "Error:mem.c: Requested block size is not positive\n");
         return -1;
     }
 
-    // Get the pagesize
-    pagesize = getpagesize();
+    // Get the pagesize, arenas backed by huge pages use 2 MiB ones
+    pagesize = huge_pages ? 2 << 20 : getpagesize();
 
     // Calculate padsize as the padding required to round up sizeOfRegion
     // to a multiple of pagesize
     padsize = sizeOfRegion % pagesize;
     padsize = (pagesize - padsize) % pagesize;
 
-    alloc_size = sizeOfRegion + padsize;
-
-    // Using mmap to allocate memory
-    fd = open("/dev/zero", O_RDWR);
-    if (-1 == fd) {
-        fprintf(stderr, "Error:mem.c: Cannot open /dev/zero\n");
-        return -1;
-    }
-    space_ptr = mmap(NULL, alloc_size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
-                     fd, 0);
-    if (MAP_FAILED == space_ptr) {
-        fprintf(stderr, "Error:mem.c: mmap cannot allocate space\n");
-        allocated_once = 0;
+    if (sizeOfRegion > SIZE_MAX / 2 - padsize) {
+        fprintf(stderr, "Error:mem.c: Requested block size is too large\n");
         return -1;
     }
+    alloc_size = sizeOfRegion + padsize;
 
-    allocated_once = 1;
-
-    // for double word alignement and end mark
-    alloc_size -= 8;
-
-    // To begin with there is only one big free block
-    // initialize heap so that first block meets
-    // double word alignement requirement
-    first_blk = (blk_hdr *) space_ptr + 1;
-    end_mark = (blk_hdr *) ((void *) first_blk + alloc_size);
-
-    // Setting up the header
-    first_blk->size_status = alloc_size;
-
-    // Marking the previous block as busy
-    first_blk->size_status += 2;
+    // The tree only finds smallest fits, the other policies walk lists
+    if (policy == MEM_FIT_FIRST || policy == MEM_FIT_NEXT)
+        tree_class = NUM_CLASSES;
 
-    // Setting up the end mark and marking it as busy
-    end_mark->size_status = 1;
+    // The initial arena is never unmapped
+    if (map_arena(alloc_size) == NULL)
+        return -1;
 
-    // Setting up the footer
-    blk_hdr *footer = (blk_hdr *) ((char *) first_blk + alloc_size - 4);
-    footer->size_status = alloc_size;
+    allocated_once = 1;
+    first_blk = newest_arena->first;
 
     return 0;
 }
@@ -304,13 +1478,18 @@ void Dump_Mem() {
     char p_status[5];
     char *t_begin = NULL;
     char *t_end = NULL;
-    int t_size;
+    size_t t_size;
 
-    blk_hdr *current = first_blk;
+    if (mem_concurrent)
+        pthread_mutex_lock(&heap_lock);
+    arena *a = newest_arena;
+    while (a->older != NULL)  // Oldest arena first
+        a = a->older;
+    blk_hdr *current = a->first;
     counter = 1;
 
-    int busy_size = 0;
-    int free_size = 0;
+    size_t busy_size = 0;
+    size_t free_size = 0;
     int is_busy = -1;
 
     fprintf(stdout, "************************************Block list***\
@@ -327,7 +1506,6 @@ void Dump_Mem() {
             // LSB = 1 => busy block
             strcpy(status, "Busy");
             is_busy = 1;
-            t_size = t_size - 1;
         } else {
             strcpy(status, "Free");
             is_busy = 0;
@@ -335,10 +1513,10 @@ void Dump_Mem() {
 
         if (t_size & 2) {
             strcpy(p_status, "Busy");
-            t_size = t_size - 2;
         } else {
             strcpy(p_status, "Free");
         }
+        t_size = BLK_SIZE(current);
 
         if (is_busy)
             busy_size += t_size;
@@ -347,24 +1525,33 @@ void Dump_Mem() {
 
         t_end = t_begin + t_size - 1;
 
-        fprintf(stdout, "%d\t%s\t%s\t0x%08lx\t0x%08lx\t%d\n", counter, status,
+        fprintf(stdout, "%d\t%s\t%s\t0x%08lx\t0x%08lx\t%zu\n", counter, status,
                 p_status, (unsigned long int) t_begin,
                 (unsigned long int) t_end, t_size);
 
         current = (blk_hdr *) ((char *) current + t_size);
         counter = counter + 1;
+
+        if (current->size_status == 1 && a->newer != NULL) {
+            // Continue with the next arena
+            a = a->newer;
+            current = a->first;
+        }
     }
 
     fprintf(stdout, "---------------------------------------------------\
                 ------------------------------\n");
     fprintf(stdout, "***************************************************\
                 ******************************\n");
-    fprintf(stdout, "Total busy size = %d\n", busy_size);
-    fprintf(stdout, "Total free size = %d\n", free_size);
-    fprintf(stdout, "Total size = %d\n", busy_size + free_size);
+    fprintf(stdout, "Total busy size = %zu\n", busy_size);
+    fprintf(stdout, "Total free size = %zu\n", free_size);
+    fprintf(stdout, "Total size = %zu\n", busy_size + free_size);
+    slab_dump();
     fprintf(stdout, "***************************************************\
                 ******************************\n");
     fflush(stdout);
 
+    if (mem_concurrent)
+        pthread_mutex_unlock(&heap_lock);
     return;
 }
@@ -1,15 +1,79 @@
 #ifndef __mem_h__
 #define __mem_h__
 
-int Init_Mem(int sizeOfRegion);
-void* Alloc_Mem(int size);
-int Free_Mem(void *ptr);
-void Dump_Mem();
+#include <stddef.h>
 
-void* malloc(size_t size) {
-    return NULL;
-}
+/*
+ * Parameters for Tune_Mem
+ * MEM_CONCURRENT: nonzero => thread-safe mode with per-thread caches
+ *                 (must be set before Init_Mem)
+ * MEM_GROW:       nonzero => map more arenas when the heap is full
+ * MEM_TRIM_IDLE:  allocator calls an entirely free arena or slab run is
+ *                 kept around, negative => never give memory back
+ * MEM_HUGEPAGES:  0 => normal pages, 1 => transparent huge pages,
+ *                 2 => MAP_HUGETLB with fallback to 1
+ * MEM_SLAB:       nonzero => serve requests of up to 256 bytes from
+ *                 slab bins
+ * MEM_STATS_LOG:  write the statistics as a line of JSON every this
+ *                 many allocator calls, 0 => never
+ * MEM_STATS_FD:   file descriptor the JSON lines go to (default 2)
+ * MEM_POLICY:     placement policy, one of MEM_FIT_*
+ *                 (must be set before Init_Mem)
+ * MEM_GOOD_FIT_K: fitting blocks MEM_FIT_GOOD looks at before it picks
+ * MEM_TREE_MIN:   free blocks from this size up are indexed by a tree,
+ *                 0 => lists only (must be set before Init_Mem)
+ */
+#define MEM_CONCURRENT 1
+#define MEM_GROW       2
+#define MEM_TRIM_IDLE  3
+#define MEM_HUGEPAGES  4
+#define MEM_SLAB       5
+#define MEM_STATS_LOG  6
+#define MEM_STATS_FD   7
+#define MEM_POLICY     8
+#define MEM_GOOD_FIT_K 9
+#define MEM_TREE_MIN   10
 
-#endif // __mem_h__
+/* Placement policies for MEM_POLICY */
+#define MEM_FIT_BEST   0  // Smallest block that fits
+#define MEM_FIT_FIRST  1  // Lowest addressed block that fits
+#define MEM_FIT_NEXT   2  // First fit from where the last search stopped
+#define MEM_FIT_GOOD   3  // Smallest of the first MEM_GOOD_FIT_K that fit
+
+/*
+ * Statistics filled in by Stats_Mem
+ * Blocks are counted by power-of-two class: class i holds the blocks with
+ * 2^i to 2^(i+1)-1 usable bytes. In concurrent mode the blocks held in
+ * the thread caches count as in use, and the counts of other threads are
+ * only approximate while they run.
+ */
+#define MEM_STAT_CLASSES 64
 
+typedef struct Mem_Stats {
+    unsigned long allocs[MEM_STAT_CLASSES];  // Blocks handed out
+    unsigned long frees[MEM_STAT_CLASSES];   // Blocks given back
+    size_t heap_size;        // Bytes of all arenas and slab runs
+    size_t slab_released;    // Bytes of empty slab runs given back to
+                             // the kernel, still counted in heap_size
+    size_t in_use;           // Bytes of busy blocks, headers included
+    size_t peak_in_use;      // Highest in_use so far
+    size_t free_blocks;      // Free blocks of the block heap
+    size_t free_bytes;       // Bytes in those blocks
+    size_t largest_free;     // Size of the largest one
+    double fragmentation;    // 1 - largest_free / free_bytes
+    unsigned long searches;  // Free list searches
+    double avg_visited;      // Free blocks looked at per search
+} Mem_Stats;
 
+int Init_Mem(size_t sizeOfRegion);
+void* Alloc_Mem(size_t size);
+int Free_Mem(void *ptr);
+void* Realloc_Mem(void *ptr, size_t size);
+void* Calloc_Mem(size_t nmemb, size_t size);
+void* Memalign_Mem(size_t alignment, size_t size);
+size_t Usable_Mem(void *ptr);
+void Dump_Mem();
+int Tune_Mem(int param, int value);
+int Stats_Mem(Mem_Stats *stats);
+
+#endif // __mem_h__
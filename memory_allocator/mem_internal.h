@@ -0,0 +1,85 @@
+#ifndef __mem_internal_h__
+#define __mem_internal_h__
+
+#include <stddef.h>
+#include <pthread.h>
+#include "mem.h"
+
+/*
+ * Interface between mem.c and the other parts of the allocator
+ * Not to be included by users of libmem
+ */
+
+/*
+ * Counters behind Stats_Mem. The heap and the slab update them, so they
+ * are guarded by heap_lock in concurrent mode.
+ */
+typedef struct heap_counters {
+    size_t heap_size;         // Bytes of arenas and slab runs
+    size_t slab_released;     // Bytes of slab runs given back to the kernel
+    size_t in_use;            // Bytes of busy blocks and slots
+    size_t peak_in_use;       // Highest in_use so far
+    size_t free_blocks;       // Blocks on the free lists
+    size_t free_bytes;        // Bytes in those blocks
+    unsigned long searches;   // Free list searches for a block
+    unsigned long visited;    // Free blocks looked at by them
+} heap_counters;
+
+/* Blocks handed out and given back, see Mem_Stats */
+typedef struct alloc_counts {
+    unsigned long allocs[MEM_STAT_CLASSES];
+    unsigned long frees[MEM_STAT_CLASSES];
+} alloc_counts;
+
+extern heap_counters heap_stats;
+extern alloc_counts heap_counts;
+
+/* Allocator calls so far, and how many of them memory stays idle for */
+extern unsigned long heap_ticks;
+extern int trim_idle;
+
+/* Counts 'bytes' more in use */
+static inline void count_busy(size_t bytes) {
+    heap_stats.in_use += bytes;
+    if (heap_stats.in_use > heap_stats.peak_in_use)
+        heap_stats.peak_in_use = heap_stats.in_use;
+}
+
+/* Class of a block with 'usable' bytes in alloc_counts */
+static inline int stat_class(size_t usable) {
+    return usable == 0 ? 0 : 63 - __builtin_clzll(usable);
+}
+
+/* The block heap in mem.c, callers must hold heap_lock in concurrent mode */
+extern int mem_concurrent;
+extern pthread_mutex_t heap_lock;
+void *heap_alloc(size_t size);
+void *heap_calloc(size_t size);
+void *heap_realloc(void *ptr, size_t size);
+void *heap_memalign(size_t alignment, size_t size);
+int heap_free(void *ptr);
+size_t heap_usable(void *ptr);
+
+/* Per-thread caches in mem_tcache.c, only used in concurrent mode */
+void *tcache_alloc(size_t size);
+void *tcache_calloc(size_t size);
+void *tcache_realloc(void *ptr, size_t size);
+void *tcache_memalign(size_t alignment, size_t size);
+size_t tcache_usable(void *ptr);
+int tcache_free(void *ptr);
+void tcache_counts(alloc_counts *sum);
+
+/* Slab bins in mem_slab.c, only used outside concurrent mode */
+#define SLAB_MAX 256
+void *slab_alloc(size_t size);
+int slab_owns(void *ptr);
+size_t slab_usable(void *ptr);
+int slab_free(void *ptr);
+void slab_dump(void);
+
+/* heap_ticks at which slab_trim has empty runs to release, if ever */
+#define NO_TRIM ((unsigned long) -1)
+extern unsigned long slab_next_trim;
+void slab_trim(void);
+
+#endif // __mem_internal_h__
@@ -0,0 +1,167 @@
+////////////////////////////////////////////////////////////////////////////////
+// Main File:        mem.c
+// This File:        mem_malloc.c
+// Other Files:      mem.c mem.h mem_internal.h
+// Semester:         CS 354 Fall 2018
+//
+// Author:           Yuanhang Wang
+// Email:            wang2243@wisc.edu
+// CS Login:         ywang
+//
+/////////////////////////// OTHER SOURCES OF HELP //////////////////////////////
+//                   fully acknowledge and credit all sources of help,
+//                   other than Instructors and TAs.
+//
+// Persons:          Identify persons by name, relationship to you, and email.
+//                   Describe in detail the the ideas and help they provided.
+//
+// Online sources:   avoid web searches to solve your problems, but if you do
+//                   search, be sure to include Web URLs and description of
+//                   of any information you find.
+//////////////////////////// 80 columns wide ///////////////////////////////////
+
+#include <errno.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "mem.h"
+#include "mem_internal.h"
+
+/*
+ * The standard allocation functions on top of libmem, so that
+ *     LD_PRELOAD=./libmem_malloc.so program
+ * runs an unmodified program on this allocator.
+ *
+ * The heap is set up on the first call, in concurrent mode since the
+ * program may have threads, with an initial arena of INITIAL_HEAP bytes
+ * that grows on demand. Setting MEM_STATS_LOG=n in the environment writes
+ * the allocator statistics to stderr every n calls, MEM_POLICY=n picks
+ * the placement policy MEM_FIT_* with value n (see Tune_Mem).
+ *
+ * Programs using the *_Mem API directly call Init_Mem themselves, which
+ * is why these functions live in a library of their own rather than in
+ * libmem.so.
+ */
+
+#define INITIAL_HEAP ((size_t) 4 << 20)
+
+static pthread_once_t init_once = PTHREAD_ONCE_INIT;
+static int init_failed = 0;
+static int atfork_done = 0;
+
+static void lock_heap(void) {
+    pthread_mutex_lock(&heap_lock);
+}
+
+static void unlock_heap(void) {
+    pthread_mutex_unlock(&heap_lock);
+}
+
+static void init_heap(void) {
+    const char *stats_log = getenv("MEM_STATS_LOG");
+    if (stats_log != NULL)
+        Tune_Mem(MEM_STATS_LOG, atoi(stats_log));
+    const char *policy = getenv("MEM_POLICY");
+    if (policy != NULL)
+        Tune_Mem(MEM_POLICY, atoi(policy));
+    if (Tune_Mem(MEM_CONCURRENT, 1) != 0 || Init_Mem(INITIAL_HEAP) != 0)
+        init_failed = 1;
+}
+
+/*
+ * Sets up the heap on first use
+ * Returns nonzero if the heap can be used
+ * The fork handlers keep a child from inheriting a heap that another
+ * thread was changing. They are registered once the heap is up, since
+ * registering them may allocate.
+ */
+static inline int heap_ready(void) {
+    pthread_once(&init_once, init_heap);
+    if (init_failed)
+        return 0;
+    if (!__atomic_load_n(&atfork_done, __ATOMIC_ACQUIRE)
+        && !__atomic_exchange_n(&atfork_done, 1, __ATOMIC_ACQ_REL))
+        pthread_atfork(lock_heap, unlock_heap, unlock_heap);
+    return 1;
+}
+
+void *malloc(size_t size) {
+    void *ptr = heap_ready() ? Alloc_Mem(size == 0 ? 1 : size) : NULL;
+    if (ptr == NULL)
+        errno = ENOMEM;
+    return ptr;
+}
+
+void free(void *ptr) {
+    if (ptr != NULL)
+        Free_Mem(ptr);
+}
+
+void *calloc(size_t nmemb, size_t size) {
+    if (nmemb == 0 || size == 0)
+        nmemb = size = 1;
+    void *ptr = heap_ready() ? Calloc_Mem(nmemb, size) : NULL;
+    if (ptr == NULL)
+        errno = ENOMEM;
+    return ptr;
+}
+
+void *realloc(void *ptr, size_t size) {
+    if (ptr == NULL)
+        return malloc(size);
+    if (size == 0) {
+        Free_Mem(ptr);
+        return NULL;
+    }
+    void *new_ptr = Realloc_Mem(ptr, size);
+    if (new_ptr == NULL)
+        errno = ENOMEM;
+    return new_ptr;
+}
+
+int posix_memalign(void **memptr, size_t alignment, size_t size) {
+    if (alignment == 0 || alignment % sizeof(void *) != 0
+        || (alignment & (alignment - 1)) != 0)
+        return EINVAL;
+    void *ptr = heap_ready() ? Memalign_Mem(alignment, size == 0 ? 1 : size)
+                             : NULL;
+    if (ptr == NULL)
+        return ENOMEM;
+    *memptr = ptr;
+    return 0;
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    void *ptr = heap_ready() ? Memalign_Mem(alignment, size == 0 ? 1 : size)
+                             : NULL;
+    if (ptr == NULL)
+        errno = ENOMEM;
+    return ptr;
+}
+
+/*
+ * Obsolete variants, which would otherwise hand out blocks of the libc
+ * allocator that free could not tell apart from ours
+ */
+void *memalign(size_t alignment, size_t size) {
+    return aligned_alloc(alignment, size);
+}
+
+void *valloc(size_t size) {
+    return aligned_alloc(getpagesize(), size);
+}
+
+void *pvalloc(size_t size) {
+    size_t pagesize = getpagesize();
+    return aligned_alloc(pagesize, (size + pagesize - 1) / pagesize * pagesize);
+}
+
+size_t malloc_usable_size(void *ptr) {
+    return Usable_Mem(ptr);
+}
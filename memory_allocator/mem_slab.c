@@ -0,0 +1,320 @@
+////////////////////////////////////////////////////////////////////////////////
+// Main File:        mem.c
+// This File:        mem_slab.c
+// Other Files:      mem.c mem.h mem_internal.h
+// Semester:         CS 354 Fall 2018
+//
+// Author:           Yuanhang Wang
+// Email:            wang2243@wisc.edu
+// CS Login:         ywang
+//
+/////////////////////////// OTHER SOURCES OF HELP //////////////////////////////
+//                   fully acknowledge and credit all sources of help,
+//                   other than Instructors and TAs.
+//
+// Persons:          Identify persons by name, relationship to you, and email.
+//                   Describe in detail the the ideas and help they provided.
+//
+// Online sources:   avoid web searches to solve your problems, but if you do
+//                   search, be sure to include Web URLs and description of
+//                   of any information you find.
+//////////////////////////// 80 columns wide ///////////////////////////////////
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "mem.h"
+#include "mem_internal.h"
+
+/*
+ * Slab bins for small requests
+ *
+ * Requests of up to SLAB_MAX bytes are served from runs: pages carved
+ * into equal slots of one size class. A slot has no header, the run
+ * descriptor keeps a bitmap of the free slots instead. Runs of a class
+ * that have free slots are kept on the class's partial list, so an
+ * allocation is a bitmap scan of the first partial run and a free is a
+ * bit flip.
+ *
+ * All runs live in one region that is reserved (but not committed) on
+ * first use. Run descriptors are kept outside the runs in an array
+ * indexed by page number, so finding the run of a pointer is a shift and
+ * telling slab pointers from heap pointers is a range check. Pages of
+ * runs that become empty are reused by any class.
+ *
+ * Empty runs are kept newest first, and all but the SLAB_KEEP newest hand
+ * their page back to the kernel with MADV_DONTNEED once they have been
+ * empty for trim_idle allocator calls, like idle arenas (see mem.c). The
+ * page stays in the region and is reused after the empty runs.
+ */
+
+#define SLAB_PAGE     4096
+#define SLAB_REGION   ((size_t) 1 << 30)     // Bytes reserved for runs
+#define SLAB_PAGES    (SLAB_REGION / SLAB_PAGE)
+#define SLAB_CLASSES  12
+#define MAX_SLOTS     (SLAB_PAGE / 16)
+#define NO_RUN        ((uint32_t) -1)
+#define SLAB_KEEP     8       // Empty runs never released
+
+/* Slot size of each class */
+static const uint16_t slot_size[SLAB_CLASSES] = {
+    16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256
+};
+
+/* Class of a request of n bytes, indexed by (n + 15) / 16 */
+static const uint8_t class_of[SLAB_MAX / 16 + 1] = {
+    0, 0, 1, 2, 3, 4, 5, 6, 7, 8, 8, 9, 9, 10, 10, 11, 11
+};
+
+typedef struct slab_run {
+    uint64_t free_map[MAX_SLOTS / 64];  // Bit set => slot is free
+    uint32_t next;      // Neighbours on the partial or empty list
+    uint32_t prev;
+    uint16_t cls;       // Size class of the slots
+    uint16_t nslots;    // Slots in the run, 0 for the page of an empty run
+    uint16_t nfree;     // Free slots
+    unsigned long idle_since;  // heap_ticks when the run became empty
+} slab_run;
+
+static char *slab_base = NULL;     // Reserved region, SLAB_REGION bytes
+static slab_run *runs = NULL;      // Descriptor of each page of the region
+static uint32_t slab_top = 0;      // Pages handed out so far
+static uint32_t partial[SLAB_CLASSES];  // Runs with free slots
+static uint32_t empty_runs = NO_RUN;    // Pages of runs with no busy slot
+static uint32_t empty_tail = NO_RUN;    // The one empty the longest
+static uint32_t nempty = 0;
+static uint32_t released_runs = NO_RUN; // Empty pages given back
+unsigned long slab_next_trim = NO_TRIM;
+static int slab_failed = 0;        // Could not reserve the region
+
+/*
+ * Reserves the region and the descriptor array
+ * Returns 0 on success and -1 on failure
+ */
+static int slab_init(void) {
+    if (slab_failed)
+        return -1;
+    void *base = mmap(NULL, SLAB_REGION, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    void *desc = mmap(NULL, SLAB_PAGES * sizeof(slab_run),
+                      PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED || desc == MAP_FAILED) {
+        fprintf(stderr, "Error:mem_slab.c: cannot reserve the slab region\n");
+        if (base != MAP_FAILED)
+            munmap(base, SLAB_REGION);
+        if (desc != MAP_FAILED)
+            munmap(desc, SLAB_PAGES * sizeof(slab_run));
+        slab_failed = 1;
+        return -1;
+    }
+    slab_base = base;
+    runs = desc;
+    for (int cls = 0; cls < SLAB_CLASSES; cls++)
+        partial[cls] = NO_RUN;
+    return 0;
+}
+
+/*
+ * Pushes run 'idx' on the list whose head is '*head'
+ */
+static void run_push(uint32_t *head, uint32_t idx) {
+    runs[idx].prev = NO_RUN;
+    runs[idx].next = *head;
+    if (*head != NO_RUN)
+        runs[*head].prev = idx;
+    *head = idx;
+}
+
+/*
+ * Unlinks run 'idx' from the list whose head is '*head'
+ */
+static void run_unlink(uint32_t *head, uint32_t idx) {
+    slab_run *run = &runs[idx];
+    if (run->prev != NO_RUN)
+        runs[run->prev].next = run->next;
+    else
+        *head = run->next;
+    if (run->next != NO_RUN)
+        runs[run->next].prev = run->prev;
+}
+
+/*
+ * Unlinks run 'idx' from the empty runs
+ */
+static void empty_unlink(uint32_t idx) {
+    run_unlink(&empty_runs, idx);
+    if (idx == empty_tail)
+        empty_tail = runs[idx].prev;
+    nempty--;
+}
+
+/*
+ * Releases the pages of the empty runs beyond the SLAB_KEEP newest that
+ * have been empty for trim_idle allocator calls, oldest first
+ * Sets slab_next_trim to when the next one will have been
+ */
+void slab_trim(void) {
+    slab_next_trim = NO_TRIM;
+    while (nempty > SLAB_KEEP && trim_idle >= 0) {
+        uint32_t idx = empty_tail;
+        unsigned long expiry = runs[idx].idle_since + trim_idle;
+        if (heap_ticks < expiry) {
+            slab_next_trim = expiry;
+            return;
+        }
+        empty_unlink(idx);
+        madvise(slab_base + (size_t) idx * SLAB_PAGE, SLAB_PAGE,
+                MADV_DONTNEED);
+        run_push(&released_runs, idx);
+        heap_stats.slab_released += SLAB_PAGE;
+    }
+}
+
+/*
+ * Sets up a run of class 'cls', reusing the page of an empty run if any,
+ * then that of a released one
+ * Returns the run's index, or NO_RUN if the region is full
+ */
+static uint32_t new_run(int cls) {
+    uint32_t idx = empty_runs;
+    if (idx != NO_RUN) {
+        empty_unlink(idx);
+    } else if ((idx = released_runs) != NO_RUN) {
+        run_unlink(&released_runs, idx);
+        heap_stats.slab_released -= SLAB_PAGE;
+    } else if (slab_top < SLAB_PAGES) {
+        idx = slab_top++;
+        heap_stats.heap_size += SLAB_PAGE;
+    } else
+        return NO_RUN;
+
+    slab_run *run = &runs[idx];
+    int slots = SLAB_PAGE / slot_size[cls];
+    memset(run->free_map, 0, sizeof(run->free_map));
+    for (int i = 0; i < slots / 64; i++)
+        run->free_map[i] = ~(uint64_t) 0;
+    if (slots % 64)
+        run->free_map[slots / 64] = ((uint64_t) 1 << (slots % 64)) - 1;
+    run->cls = cls;
+    run->nslots = slots;
+    run->nfree = slots;
+    run_push(&partial[cls], idx);
+    return idx;
+}
+
+/*
+ * Allocates a slot for 'size' bytes, 0 < size <= SLAB_MAX
+ * Returns the slot on success and NULL if the region is full or cannot
+ * be reserved, in which case the caller should use the block heap
+ */
+void *slab_alloc(size_t size) {
+    if (slab_base == NULL && slab_init() != 0)
+        return NULL;
+    int cls = class_of[(size + 15) / 16];
+    uint32_t idx = partial[cls];
+    if (idx == NO_RUN && (idx = new_run(cls)) == NO_RUN)
+        return NULL;
+
+    slab_run *run = &runs[idx];
+    int word = 0;
+    while (run->free_map[word] == 0)
+        word++;
+    int slot = word * 64 + __builtin_ctzll(run->free_map[word]);
+    run->free_map[word] &= run->free_map[word] - 1;  // Clear lowest bit
+    if (--run->nfree == 0)
+        run_unlink(&partial[cls], idx);
+    heap_counts.allocs[stat_class(slot_size[cls])]++;
+    count_busy(slot_size[cls]);
+    return slab_base + (size_t) idx * SLAB_PAGE + slot * slot_size[cls];
+}
+
+/*
+ * Returns nonzero if 'ptr' points into the slab region
+ */
+int slab_owns(void *ptr) {
+    return slab_base != NULL && (char *) ptr >= slab_base
+           && (char *) ptr < slab_base + (size_t) slab_top * SLAB_PAGE;
+}
+
+/*
+ * Returns the slot size of the busy slot at 'ptr' owned by the slab
+ * Returns 0 if ptr is not the start of a busy slot
+ */
+size_t slab_usable(void *ptr) {
+    size_t off = (char *) ptr - slab_base;
+    slab_run *run = &runs[off / SLAB_PAGE];
+    if (run->nslots == 0)
+        return 0;  // Page of an empty run
+    size_t size = slot_size[run->cls];
+    size_t slot = off % SLAB_PAGE / size;
+    if (off % SLAB_PAGE % size != 0 || slot >= run->nslots
+        || (run->free_map[slot / 64] >> (slot % 64) & 1))
+        return 0;
+    return size;
+}
+
+/*
+ * Frees the slot at 'ptr' owned by the slab
+ * Returns 0 on success
+ * Returns -1 if ptr is not the start of a slot or the slot is free
+ * A run that becomes empty gives its page back for use by any class,
+ * unless it is the only run of its class with free slots. Past
+ * SLAB_KEEP empty runs the oldest is due for slab_trim.
+ */
+int slab_free(void *ptr) {
+    size_t off = (char *) ptr - slab_base;
+    uint32_t idx = off / SLAB_PAGE;
+    slab_run *run = &runs[idx];
+    if (slab_usable(ptr) == 0)
+        return -1;
+    size_t size = slot_size[run->cls];
+    size_t slot = off % SLAB_PAGE / size;
+    run->free_map[slot / 64] |= (uint64_t) 1 << (slot % 64);
+    run->nfree++;
+    heap_counts.frees[stat_class(size)]++;
+    heap_stats.in_use -= size;
+    if (run->nfree == 1) {
+        run_push(&partial[run->cls], idx);
+    } else if (run->nfree == run->nslots
+               && (run->prev != NO_RUN || run->next != NO_RUN)) {
+        run_unlink(&partial[run->cls], idx);
+        run->nslots = 0;
+        run->idle_since = heap_ticks;
+        run_push(&empty_runs, idx);
+        if (empty_tail == NO_RUN)
+            empty_tail = idx;
+        if (++nempty > SLAB_KEEP && trim_idle >= 0) {
+            unsigned long expiry = runs[empty_tail].idle_since + trim_idle;
+            if (expiry < slab_next_trim)
+                slab_next_trim = expiry;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Prints how much of the slab region is in use, see Dump_Mem
+ */
+void slab_dump(void) {
+    if (slab_base == NULL)
+        return;
+    size_t busy_size = 0;
+    size_t free_size = 0;
+    int nruns = 0;
+    for (uint32_t idx = 0; idx < slab_top; idx++) {
+        slab_run *run = &runs[idx];
+        if (run->nslots == 0)
+            continue;
+        nruns++;
+        size_t size = slot_size[run->cls];
+        busy_size += (size_t) (run->nslots - run->nfree) * size;
+        free_size += (size_t) run->nfree * size;
+    }
+    fprintf(stdout, "Slab runs = %d of %d bytes, %u empty, %zu released\n",
+            nruns, SLAB_PAGE, slab_top - nruns,
+            heap_stats.slab_released / SLAB_PAGE);
+    fprintf(stdout, "Slab busy size = %zu\n", busy_size);
+    fprintf(stdout, "Slab free size = %zu\n", free_size);
+}
@@ -0,0 +1,401 @@
+////////////////////////////////////////////////////////////////////////////////
+// Main File:        mem.c
+// This File:        mem_tcache.c
+// Other Files:      mem.c mem.h mem_internal.h
+// Semester:         CS 354 Fall 2018
+//
+// Author:           Yuanhang Wang
+// Email:            wang2243@wisc.edu
+// CS Login:         ywang
+//
+/////////////////////////// OTHER SOURCES OF HELP //////////////////////////////
+//                   fully acknowledge and credit all sources of help,
+//                   other than Instructors and TAs.
+//
+// Persons:          Identify persons by name, relationship to you, and email.
+//                   Describe in detail the the ideas and help they provided.
+//
+// Online sources:   avoid web searches to solve your problems, but if you do
+//                   search, be sure to include Web URLs and description of
+//                   of any information you find.
+//////////////////////////// 80 columns wide ///////////////////////////////////
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include "mem.h"
+#include "mem_internal.h"
+
+/*
+ * Per-thread caches for the concurrent mode
+ *
+ * Every thread owns a tcache with one magazine (a small stack of ready
+ * blocks) per size class. Small requests are served from and freed to the
+ * calling thread's magazines without taking heap_lock. Magazines are
+ * refilled from and drained to the shared block heap MAG_BATCH blocks at
+ * a time, so the lock is only taken once per batch.
+ *
+ * In concurrent mode every block ends with an owner tag: the tcache that
+ * hands the block out, or NULL for blocks served by the shared heap.
+ * A block freed by a thread other than its owner is pushed onto the
+ * owner's 'remote' stack with a compare-and-swap; the owner takes the
+ * whole stack at once with an atomic exchange when it runs dry, so there
+ * is no ABA problem. While a block sits in a magazine or on a remote
+ * stack its tag has the CACHED bit set, which catches double frees.
+ */
+
+#define TC_GRAIN    16                    // Requests are cached in 16B steps
+#define TC_CLASSES  16                    // => requests of up to 256 bytes
+#define TC_MAX      (TC_GRAIN * TC_CLASSES)
+#define MAG_SIZE    64                    // Blocks one magazine can hold
+#define MAG_BATCH   32                    // Blocks moved per refill/drain
+
+#define TAG_SIZE    sizeof(void *)
+#define CACHED      ((uintptr_t) 1)
+
+typedef struct tcache {
+    struct tcache *next_cache;  // List of all caches ever created
+    int live;                   // Owned by a running thread
+    void *remote;               // Blocks freed by other threads
+    alloc_counts counts;        // Blocks handed out and freed by the thread
+    int count[TC_CLASSES];
+    void *mag[TC_CLASSES][MAG_SIZE];
+} tcache;
+
+static tcache *all_caches = NULL;  // Guarded by heap_lock
+static __thread tcache *my_cache __attribute__((tls_model("initial-exec")));
+static pthread_key_t exit_key;
+static pthread_once_t exit_once = PTHREAD_ONCE_INIT;
+
+/*
+ * Returns the offset of the owner tag in a block with 'usable' payload
+ * bytes, which is also the number of bytes the program can use
+ * The tag sits in the last pointer-aligned word of the payload
+ */
+static inline size_t tag_offset(size_t usable) {
+    return (usable - TAG_SIZE) & -TAG_SIZE;
+}
+
+/*
+ * Returns the owner tag of the block at 'ptr' with 'usable' payload bytes
+ */
+static inline tcache **owner_tag(void *ptr, size_t usable) {
+    return (tcache **) ((char *) ptr + tag_offset(usable));
+}
+
+/*
+ * Returns the largest size class the block with 'usable' bytes can serve
+ */
+static inline int obj_class(size_t usable) {
+    size_t cls = tag_offset(usable) / TC_GRAIN - 1;
+    return cls < TC_CLASSES ? (int) cls : TC_CLASSES - 1;
+}
+
+/*
+ * Gives the 'n' most recently cached blocks of class 'cls' back to the heap
+ */
+static void drain(tcache *tc, int cls, int n) {
+    pthread_mutex_lock(&heap_lock);
+    while (n-- > 0 && tc->count[cls] > 0)
+        heap_free(tc->mag[cls][--tc->count[cls]]);
+    pthread_mutex_unlock(&heap_lock);
+}
+
+/*
+ * Moves up to MAG_BATCH fresh blocks of class 'cls' into the magazine
+ * Returns the number of blocks obtained
+ */
+static int refill(tcache *tc, int cls) {
+    int got = 0;
+    pthread_mutex_lock(&heap_lock);
+    while (got < MAG_BATCH) {
+        void *ptr = heap_alloc((cls + 1) * TC_GRAIN + TAG_SIZE);
+        if (ptr == NULL)
+            break;
+        tcache **tag = owner_tag(ptr, heap_usable(ptr));
+        *tag = (tcache *) ((uintptr_t) tc | CACHED);
+        tc->mag[cls][tc->count[cls]++] = ptr;
+        got++;
+    }
+    pthread_mutex_unlock(&heap_lock);
+    return got;
+}
+
+/*
+ * Puts a block back into its magazine, draining the magazine if full
+ */
+static void cache_put(tcache *tc, void *ptr, size_t usable) {
+    int cls = obj_class(usable);
+    if (tc->count[cls] == MAG_SIZE)
+        drain(tc, cls, MAG_BATCH);
+    tc->mag[cls][tc->count[cls]++] = ptr;
+}
+
+/*
+ * Takes every block other threads have freed back into the magazines
+ */
+static void reclaim_remote(tcache *tc) {
+    void *ptr = __atomic_exchange_n(&tc->remote, NULL, __ATOMIC_ACQUIRE);
+    while (ptr != NULL) {
+        void *next = *(void **) ptr;
+        cache_put(tc, ptr, heap_usable(ptr));
+        ptr = next;
+    }
+}
+
+/*
+ * pthread key destructor: returns everything the exiting thread cached to
+ * the heap. The tcache itself is kept for adoption by a later thread since
+ * blocks it handed out may still be freed to it.
+ */
+static void cache_exit(void *arg) {
+    tcache *tc = arg;
+    reclaim_remote(tc);
+    pthread_mutex_lock(&heap_lock);
+    for (int cls = 0; cls < TC_CLASSES; cls++)
+        while (tc->count[cls] > 0)
+            heap_free(tc->mag[cls][--tc->count[cls]]);
+    __atomic_store_n(&tc->live, 0, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&heap_lock);
+    my_cache = NULL;
+}
+
+static void make_exit_key(void) {
+    pthread_key_create(&exit_key, cache_exit);
+}
+
+/*
+ * Returns the calling thread's cache, setting it up on first use
+ * Returns NULL if there is no room for a new cache
+ */
+static tcache *get_cache(void) {
+    tcache *tc = my_cache;
+    if (tc != NULL)
+        return tc;
+    pthread_once(&exit_once, make_exit_key);
+
+    pthread_mutex_lock(&heap_lock);
+    // Adopt the cache of a thread that has exited before making a new one
+    for (tc = all_caches; tc != NULL; tc = tc->next_cache)
+        if (!tc->live)
+            break;
+    if (tc == NULL) {
+        tc = heap_alloc(sizeof(tcache));
+        if (tc != NULL) {
+            memset(tc, 0, sizeof(tcache));
+            tc->next_cache = all_caches;
+            all_caches = tc;
+        }
+    }
+    if (tc != NULL)
+        __atomic_store_n(&tc->live, 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&heap_lock);
+
+    if (tc != NULL) {
+        pthread_setspecific(exit_key, tc);
+        my_cache = tc;
+    }
+    return tc;
+}
+
+/*
+ * Allocates 'size' bytes from the shared heap at a multiple of
+ * 'alignment', zeroed if 'zero' is set
+ * The block gets a NULL owner tag
+ */
+static void *shared_alloc(size_t size, size_t alignment, int zero) {
+    if (size > SIZE_MAX / 4)
+        return NULL;
+    // Keep the tag, which is placed on a word boundary, off the payload
+    size = (size + TAG_SIZE - 1) & -TAG_SIZE;
+    pthread_mutex_lock(&heap_lock);
+    void *ptr;
+    if (alignment > TC_GRAIN)
+        ptr = heap_memalign(alignment, size + TAG_SIZE);
+    else
+        ptr = zero ? heap_calloc(size + TAG_SIZE) : heap_alloc(size + TAG_SIZE);
+    if (ptr != NULL) {
+        size_t usable = heap_usable(ptr);
+        *owner_tag(ptr, usable) = NULL;
+        heap_counts.allocs[stat_class(tag_offset(usable))]++;
+    }
+    pthread_mutex_unlock(&heap_lock);
+    return ptr;
+}
+
+/*
+ * Adds the counts of every thread's cache to 'sum'
+ * The caller must hold heap_lock, the counts of running threads may be
+ * slightly behind
+ */
+void tcache_counts(alloc_counts *sum) {
+    for (tcache *tc = all_caches; tc != NULL; tc = tc->next_cache) {
+        for (int cls = 0; cls < MEM_STAT_CLASSES; cls++) {
+            sum->allocs[cls] += tc->counts.allocs[cls];
+            sum->frees[cls] += tc->counts.frees[cls];
+        }
+    }
+}
+
+/*
+ * Allocates 'size' bytes for the calling thread
+ * Returns the payload pointer on success and NULL on failure
+ * - Requests of up to TC_MAX bytes are served from the thread's magazine
+ *   for the size class, refilling it from the heap when it is empty
+ * - Larger requests (or a thread without a cache) go to the shared heap
+ */
+void *tcache_alloc(size_t size) {
+    if (size == 0)
+        return NULL;
+    tcache *tc = size <= TC_MAX ? get_cache() : NULL;
+    if (tc == NULL)
+        return shared_alloc(size, 0, 0);
+
+    int cls = (size - 1) / TC_GRAIN;
+    if (tc->count[cls] == 0) {
+        if (__atomic_load_n(&tc->remote, __ATOMIC_RELAXED) != NULL)
+            reclaim_remote(tc);
+        if (tc->count[cls] == 0 && refill(tc, cls) == 0)
+            return NULL;
+    }
+    void *ptr = tc->mag[cls][--tc->count[cls]];
+    size_t usable = heap_usable(ptr);
+    *owner_tag(ptr, usable) = tc;
+    tc->counts.allocs[stat_class(tag_offset(usable))]++;
+    return ptr;
+}
+
+/*
+ * Allocates 'size' zeroed bytes for the calling thread, see tcache_alloc
+ * Cached blocks are recycled and cleared by hand, large ones are left to
+ * heap_calloc, which knows when the memory is still zero from the mapping
+ */
+void *tcache_calloc(size_t size) {
+    if (size > TC_MAX)
+        return shared_alloc(size, 0, 1);
+    void *ptr = tcache_alloc(size);
+    if (ptr != NULL)
+        memset(ptr, 0, size);
+    return ptr;
+}
+
+/*
+ * Allocates 'size' bytes at a multiple of 'alignment', a power of two
+ * Cached blocks are only 16 byte aligned, more strictly aligned ones
+ * come from the shared heap
+ */
+void *tcache_memalign(size_t alignment, size_t size) {
+    if (alignment <= TC_GRAIN)
+        return tcache_alloc(size);
+    if (size == 0)
+        return NULL;
+    return shared_alloc(size, alignment, 0);
+}
+
+/*
+ * Returns the bytes of the block at 'ptr' that precede its owner tag
+ * Returns 0 if ptr is not a busy block
+ */
+size_t tcache_usable(void *ptr) {
+    size_t usable = heap_usable(ptr);
+    if (usable < TAG_SIZE || ((uintptr_t) *owner_tag(ptr, usable) & CACHED))
+        return 0;
+    return tag_offset(usable);
+}
+
+/*
+ * Resizes a block allocated by tcache_alloc in any thread
+ * Returns the (possibly moved) payload pointer on success
+ * Returns NULL on failure, leaving the block untouched
+ * - Large blocks of the shared heap are resized in place if possible
+ * - Other blocks are kept if they are big enough, otherwise moved
+ */
+void *tcache_realloc(void *ptr, size_t size) {
+    if (ptr == NULL)
+        return tcache_alloc(size);
+    if (size == 0) {
+        tcache_free(ptr);
+        return NULL;
+    }
+    size_t usable = heap_usable(ptr);
+    if (usable < TAG_SIZE)
+        return NULL;
+    tcache **tag = owner_tag(ptr, usable);
+    if ((uintptr_t) *tag & CACHED)
+        return NULL;
+    size_t have = tag_offset(usable);  // Bytes before the tag
+
+    if (*tag == NULL && size > TC_MAX && size <= SIZE_MAX / 4) {
+        size = (size + TAG_SIZE - 1) & -TAG_SIZE;
+        pthread_mutex_lock(&heap_lock);
+        void *new_ptr = heap_realloc(ptr, size + TAG_SIZE);
+        if (new_ptr != NULL) {
+            usable = heap_usable(new_ptr);
+            *owner_tag(new_ptr, usable) = NULL;
+            heap_counts.frees[stat_class(have)]++;
+            heap_counts.allocs[stat_class(tag_offset(usable))]++;
+        }
+        pthread_mutex_unlock(&heap_lock);
+        return new_ptr;
+    }
+    if (size <= have)
+        return ptr;
+
+    void *new_ptr = tcache_alloc(size);
+    if (new_ptr == NULL)
+        return NULL;
+    memcpy(new_ptr, ptr, have);
+    tcache_free(ptr);
+    return new_ptr;
+}
+
+/*
+ * Frees a block allocated by tcache_alloc in any thread
+ * Returns 0 on success
+ * Returns -1 if ptr is NULL, not a busy block or already freed
+ */
+int tcache_free(void *ptr) {
+    if (ptr == NULL)
+        return -1;
+    size_t usable = heap_usable(ptr);
+    if (usable < TAG_SIZE)
+        return -1;
+    tcache **tag = owner_tag(ptr, usable);
+    tcache *owner = *tag;
+    if ((uintptr_t) owner & CACHED)
+        return -1;
+
+    if (owner == NULL) {  // Served by the shared heap
+        pthread_mutex_lock(&heap_lock);
+        int ret = heap_free(ptr);
+        if (ret == 0)
+            heap_counts.frees[stat_class(tag_offset(usable))]++;
+        pthread_mutex_unlock(&heap_lock);
+        return ret;
+    }
+
+    *tag = (tcache *) ((uintptr_t) owner | CACHED);
+    if (owner == my_cache) {
+        owner->counts.frees[stat_class(tag_offset(usable))]++;
+        cache_put(owner, ptr, usable);
+        return 0;
+    }
+    tcache *tc = get_cache();
+    if (tc != NULL)
+        tc->counts.frees[stat_class(tag_offset(usable))]++;
+    if (!__atomic_load_n(&owner->live, __ATOMIC_ACQUIRE)) {
+        // Nobody will reclaim it any time soon, return it directly
+        pthread_mutex_lock(&heap_lock);
+        heap_free(ptr);
+        pthread_mutex_unlock(&heap_lock);
+        return 0;
+    }
+    void *head = __atomic_load_n(&owner->remote, __ATOMIC_RELAXED);
+    do {
+        *(void **) ptr = head;
+    } while (!__atomic_compare_exchange_n(&owner->remote, &head, ptr, 1,
+                                          __ATOMIC_RELEASE,
+                                          __ATOMIC_RELAXED));
+    return 0;
+}